@@ -0,0 +1,172 @@
+#include "benchmark.hpp"
+
+#include <audiotag/byte_conversions.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+// The byte at a time conversion from_latin1_to_utf8 used before vectorization
+std::string latin1_to_utf8_scalar(std::span<const std::byte> data)
+{
+    std::string out;
+    out.reserve(data.size());
+
+    for(const auto byte : data)
+    {
+        const auto character = std::to_integer<unsigned char>(byte);
+        if(character < 0x80)
+        {
+            out.push_back(character);
+        }
+        else
+        {
+            out.push_back(0xc0 | character >> 6);
+            out.push_back(0x80 | (character & 0x3f));
+        }
+    }
+
+    return out;
+}
+
+// Text with roughly one accented character per `high_every` bytes, 0 for pure ASCII
+std::vector<std::byte> make_latin1(std::size_t size, std::size_t high_every)
+{
+    std::mt19937 generator{ 1 };
+    std::uniform_int_distribution<int> ascii{ 0x20, 0x7E };
+    std::uniform_int_distribution<int> high{ 0xC0, 0xFF };
+
+    std::vector<std::byte> data(size);
+    for(std::size_t i = 0; i < size; ++i)
+    {
+        const auto accented = high_every != 0 && i % high_every == 0;
+        data[i] = std::byte(accented ? high(generator) : ascii(generator));
+    }
+    return data;
+}
+
+void register_latin1(const char *name, std::size_t size, std::size_t high_every)
+{
+    const auto data = std::make_shared<const std::vector<std::byte>>(make_latin1(size, high_every));
+
+    bench::Registration{ std::string("latin1_to_utf8/scalar/") + name, data->size(),
+        [data] { bench::do_not_optimize(latin1_to_utf8_scalar(*data)); } };
+    bench::Registration{ std::string("latin1_to_utf8/simd/") + name, data->size(),
+        [data] { bench::do_not_optimize(from_latin1_to_utf8(*data)); } };
+}
+
+// UTF-16LE text with a BOM, one BMP non-ASCII character per `high_every` units
+std::vector<std::byte> make_utf16(std::size_t units, std::size_t high_every)
+{
+    std::mt19937 generator{ 1 };
+    std::uniform_int_distribution<int> ascii{ 0x20, 0x7E };
+    std::uniform_int_distribution<int> bmp{ 0x100, 0x7FF };
+
+    std::vector<std::byte> data{ std::byte{ 0xFF }, std::byte{ 0xFE } };
+    for(std::size_t i = 0; i < units; ++i)
+    {
+        const auto accented = high_every != 0 && i % high_every == 0;
+        const auto unit = accented ? bmp(generator) : ascii(generator);
+        data.push_back(std::byte(unit & 0xFF));
+        data.push_back(std::byte(unit >> 8));
+    }
+    return data;
+}
+
+// The previous decode path, through an intermediate std::u16string
+std::string utf16_to_utf8_two_step(std::span<const std::byte> data)
+{
+    const auto utf16 = from_bytes_to_utf16(data);
+
+    std::string out;
+    out.reserve(utf16.size());
+    for(const char32_t unit : utf16)
+    {
+        if(unit < 0x80)
+        {
+            out.push_back(static_cast<char>(unit));
+        }
+        else if(unit < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | unit >> 6));
+            out.push_back(static_cast<char>(0x80 | (unit & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xE0 | unit >> 12));
+            out.push_back(static_cast<char>(0x80 | (unit >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (unit & 0x3F)));
+        }
+    }
+    return out;
+}
+
+void register_utf16(const char *name, std::size_t units, std::size_t high_every)
+{
+    const auto data = std::make_shared<const std::vector<std::byte>>(make_utf16(units, high_every));
+
+    bench::Registration{ std::string("bytes_to_utf16/") + name, data->size(),
+        [data] { bench::do_not_optimize(from_bytes_to_utf16(*data)); } };
+    bench::Registration{ std::string("utf16_to_utf8/two_step/") + name, data->size(),
+        [data] { bench::do_not_optimize(utf16_to_utf8_two_step(*data)); } };
+    bench::Registration{ std::string("utf16_to_utf8/direct/") + name, data->size(),
+        [data] { bench::do_not_optimize(from_utf16_bom_to_utf8(*data)); } };
+}
+
+// Picture-like payload with the occasional 0xFF but nothing to remove, so the
+// in-place decode is repeatable and measures the scan
+void register_unsynchronization(const char *name, std::size_t size)
+{
+    auto data = std::make_shared<std::vector<std::byte>>(make_latin1(size, 0));
+    for(std::size_t i = 0; i < data->size(); i += 4096)
+    {
+        (*data)[i] = std::byte{ 0xFF };
+    }
+
+    bench::Registration{ std::string("remove_unsynchronization/") + name, data->size(),
+        [data] { bench::do_not_optimize(remove_unsynchronization(*data)); } };
+}
+
+// Synch safe sizes as found in ID3v2 headers, decoded back to back
+void register_synch_safe(const char *name, std::size_t count)
+{
+    std::mt19937 generator{ 1 };
+    std::uniform_int_distribution<int> septet{ 0x00, 0x7F };
+
+    auto data = std::make_shared<std::vector<std::byte>>(count * 4);
+    for(auto &byte : *data)
+    {
+        byte = std::byte(septet(generator));
+    }
+
+    const auto decode_all = [data] {
+        std::uint32_t sum{ 0 };
+        for(std::size_t i = 0; i < data->size(); i += 4)
+        {
+            sum += to_synch_uint32_t(std::span(*data).subspan(i, 4));
+        }
+        bench::do_not_optimize(sum);
+    };
+
+    bench::Registration{ std::string("to_synch_uint32_t/") + name, data->size(), decode_all };
+}
+
+const bool registered = [] {
+    register_latin1("ascii_30", 30, 0);
+    register_latin1("ascii_4k", 4096, 0);
+    register_latin1("accented_4k", 4096, 40);
+    register_latin1("high_4k", 4096, 1);
+    register_utf16("ascii_30", 30, 0);
+    register_utf16("ascii_4k", 4096, 0);
+    register_utf16("accented_4k", 4096, 40);
+    register_unsynchronization("1m", 1024 * 1024);
+    register_synch_safe("1k", 1024);
+    return true;
+}();
+} // namespace
@@ -0,0 +1,31 @@
+#include "benchmark.hpp"
+
+#include <audiotag/content_hash.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+void register_xxh64(const char *name, std::size_t size)
+{
+    auto data = std::make_shared<std::vector<std::byte>>(size);
+    for(std::size_t i = 0; i < data->size(); ++i)
+    {
+        (*data)[i] = std::byte(i * 131);
+    }
+
+    bench::Registration{ std::string("xxh64/") + name, data->size(),
+        [data] { bench::do_not_optimize(Xxh64::hash(*data)); } };
+}
+
+const bool registered = [] {
+    register_xxh64("64", 64);
+    register_xxh64("16m", 16 * 1024 * 1024);
+    return true;
+}();
+} // namespace
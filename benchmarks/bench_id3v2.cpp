@@ -0,0 +1,178 @@
+#include "benchmark.hpp"
+#include "data_builder.hpp"
+#include "id3v2_builder.hpp"
+#include "vector_reader.hpp"
+
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/track_metadata.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+using Corpus = std::vector<std::vector<std::byte>>;
+
+// A file with a leading tag of `version` holding `frames`, followed by `audio_size` bytes
+std::vector<std::byte> make_file(
+    std::uint8_t version, std::span<const std::byte> frames, std::size_t audio_size)
+{
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ version }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(static_cast<std::uint32_t>(frames.size()));
+    builder.write(frames);
+    builder.write(std::byte{ 0xAA }, audio_size);
+    return builder.build();
+}
+
+// Frames below 128 bytes have the same size field in v2.3 and v2.4, so the
+// builder's synch safe sizes serve both versions
+Corpus make_small_frames(std::uint8_t version, std::size_t files)
+{
+    constexpr const char *frame_ids[] = { "TIT2", "TPE1", "TALB", "TCON", "TRCK", "TPOS", "TCOM",
+        "TEXT", "TPUB", "TCOP", "TENC", "TSSE", "TLAN", "TKEY", "TBPM", "TIT3" };
+
+    Corpus corpus;
+    for(std::size_t file = 0; file < files; ++file)
+    {
+        auto id3v2_builder = ID3v2Builder{};
+        for(std::size_t frame = 0; frame < 100; ++frame)
+        {
+            const auto text = "Value " + std::to_string(file) + " " + std::to_string(frame);
+            id3v2_builder.add_text_information_frame(
+                { frame_ids[frame % std::size(frame_ids)], 0 }, text);
+        }
+        corpus.push_back(make_file(version, id3v2_builder.build(), 4096));
+    }
+    return corpus;
+}
+
+Corpus make_utf16_heavy(std::uint8_t version, std::size_t files)
+{
+    constexpr const char *frame_ids[] = { "TIT2", "TPE1", "TALB", "TCON", "TCOM", "TEXT" };
+
+    Corpus corpus;
+    for(std::size_t file = 0; file < files; ++file)
+    {
+        auto id3v2_builder = ID3v2Builder{};
+        for(std::size_t frame = 0; frame < 24; ++frame)
+        {
+            id3v2_builder.add_text_information_frame({ frame_ids[frame % std::size(frame_ids)], 0 },
+                u"Sigur Rós — Ágætis byrjun, 画家 Кино", Encoding::UTF16, std::endian::little);
+        }
+        corpus.push_back(make_file(version, id3v2_builder.build(), 4096));
+    }
+    return corpus;
+}
+
+// A few text frames in front of a cover art frame of `picture_size` bytes
+Corpus make_huge_apic(std::size_t files, std::size_t picture_size)
+{
+    std::mt19937 generator{ 1 };
+    std::uniform_int_distribution<int> byte{ 0x00, 0xFF };
+
+    std::vector<std::byte> picture(picture_size);
+    for(auto &value : picture)
+    {
+        value = std::byte(byte(generator));
+    }
+
+    Corpus corpus;
+    for(std::size_t file = 0; file < files; ++file)
+    {
+        auto id3v2_builder = ID3v2Builder{};
+        id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+        id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Sample artist");
+        id3v2_builder.add_frame({ "APIC", 0 }, picture);
+        id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+        corpus.push_back(make_file(4, id3v2_builder.build(), 4096));
+    }
+    return corpus;
+}
+
+std::size_t corpus_bytes(const Corpus &corpus)
+{
+    std::size_t bytes{ 0 };
+    for(const auto &file : corpus)
+    {
+        bytes += file.size();
+    }
+    return bytes;
+}
+
+// Parses every file, and with `metadata` also decodes its tags as a library scan does
+void register_corpus(const std::string &name, Corpus &&files, const ReadOptions &options = {})
+{
+    const auto corpus = std::make_shared<const Corpus>(std::move(files));
+
+    const auto parse = [corpus, options] {
+        for(const auto &data : *corpus)
+        {
+            VectorReader reader{ data };
+            const MpegFile file{ reader, options };
+            bench::do_not_optimize(file.id3v2().has_value());
+        }
+    };
+
+    const auto metadata = [corpus, options] {
+        for(const auto &data : *corpus)
+        {
+            VectorReader reader{ data };
+            const MpegFile file{ reader, options };
+            bench::do_not_optimize(to_track_metadata(file));
+        }
+    };
+
+    bench::Registration{ "corpus/" + name + "/parse", corpus_bytes(*corpus), parse,
+        corpus->size() };
+    bench::Registration{ "corpus/" + name + "/metadata", corpus_bytes(*corpus), metadata,
+        corpus->size() };
+}
+
+void register_get_string_value()
+{
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+    id3v2_builder.add_text_information_frame({ "TCON", 0 }, "Classical");
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_text_information_frame(
+        { "TPE1", 0 }, u"Sigur Rós 画家", Encoding::UTF16, std::endian::little);
+    id3v2_builder.add_text_information_frame({ "TRCK", 0 }, "3/12");
+
+    const auto data = make_file(4, id3v2_builder.build(), 0);
+    VectorReader reader{ data };
+    const auto file = std::make_shared<const MpegFile>(reader);
+
+    bench::Registration{ "getStringValue/latin1", std::string_view("Sample title").size(),
+        [file] { bench::do_not_optimize(file->id3v2()->getStringValue(Tag::TITLE)); } };
+    bench::Registration{ "getStringValue/utf16", std::u16string_view(u"Sigur Rós 画家").size() * 2,
+        [file] { bench::do_not_optimize(file->id3v2()->getStringValue(Tag::ARIST)); } };
+    bench::Registration{ "getStringValue/missing", 0,
+        [file] { bench::do_not_optimize(file->id3v2()->getStringValue(Tag::DISCNUMBER)); } };
+}
+
+const bool registered = [] {
+    register_get_string_value();
+
+    register_corpus("small_frames/v23", make_small_frames(3, 64));
+    register_corpus("small_frames/v24", make_small_frames(4, 64));
+    register_corpus("utf16/v23", make_utf16_heavy(3, 64));
+    register_corpus("utf16/v24", make_utf16_heavy(4, 64));
+
+    // the filtered parse skips the picture payload instead of reading it
+    register_corpus("huge_apic", make_huge_apic(8, 2 * 1024 * 1024));
+    register_corpus("huge_apic/filtered", make_huge_apic(8, 2 * 1024 * 1024),
+        ReadOptions{ .id3v2_filter = { Tag::TITLE, Tag::ARIST }, .audio_properties = false });
+    return true;
+}();
+} // namespace
@@ -0,0 +1,87 @@
+#include "benchmark.hpp"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+void write_json_string(std::FILE *file, std::string_view value)
+{
+    std::fputc('"', file);
+    for(const auto character : value)
+    {
+        if(character == '"' || character == '\\')
+        {
+            std::fputc('\\', file);
+        }
+        std::fputc(character, file);
+    }
+    std::fputc('"', file);
+}
+
+// One object per benchmark, for comparing runs across revisions
+bool write_json(const char *path, const std::vector<audiotag::bench::Result> &results)
+{
+    auto *file = std::fopen(path, "w");
+    if(file == nullptr)
+    {
+        return false;
+    }
+
+    std::fprintf(file, "[\n");
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto &result = results[i];
+
+        std::fprintf(file, "  {\"name\": ");
+        write_json_string(file, result.name);
+        std::fprintf(file,
+            ", \"iterations\": %zu, \"ns_per_iteration\": %.3f, \"mb_per_second\": %.3f, "
+            "\"files_per_second\": %.3f, \"allocations_per_iteration\": %.3f}%s\n",
+            result.iterations, result.ns_per_iteration, result.mb_per_second,
+            result.files_per_second, result.allocations_per_iteration,
+            i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "]\n");
+
+    return std::fclose(file) == 0;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    // benchmarks [--json FILE] [FILTER]: a filter selects benchmarks whose name
+    // contains it, --json additionally writes the results to FILE
+    const char *json_path{ nullptr };
+    std::string_view filter;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::string_view(argv[i]) == "--json" && i + 1 < argc)
+        {
+            json_path = argv[++i];
+        }
+        else
+        {
+            filter = argv[i];
+        }
+    }
+
+    std::vector<audiotag::bench::Result> results;
+    for(const auto &benchmark : audiotag::bench::registry())
+    {
+        if(benchmark.name.find(filter) != std::string::npos)
+        {
+            results.push_back(audiotag::bench::run(benchmark));
+        }
+    }
+
+    if(json_path != nullptr && !write_json(json_path, results))
+    {
+        std::fprintf(stderr, "cannot write %s\n", json_path);
+        return 1;
+    }
+
+    return 0;
+}
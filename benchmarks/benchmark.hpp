@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace audiotag::bench
+{
+// Keeps the compiler from optimizing away a computed value
+template <typename T> void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Benchmark
+{
+    std::string name;
+    std::size_t bytes_per_iteration;
+    std::function<void()> body;
+    // files parsed per iteration by the corpus benchmarks, 0 for microbenchmarks
+    std::size_t files_per_iteration{ 0 };
+};
+
+struct Result
+{
+    std::string name;
+    std::size_t iterations;
+    double ns_per_iteration;
+    double mb_per_second;
+    double files_per_second;
+    double allocations_per_iteration;
+};
+
+// Heap allocations of the process so far, counted by the replaced global operator new
+std::size_t allocation_count();
+
+inline std::vector<Benchmark> &registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Registration
+{
+    Registration(std::string name,
+        std::size_t bytes_per_iteration,
+        std::function<void()> body,
+        std::size_t files_per_iteration = 0)
+    {
+        registry().push_back(
+            { std::move(name), bytes_per_iteration, std::move(body), files_per_iteration });
+    }
+};
+
+// Repeats the body until the batch takes long enough to time reliably; the
+// allocations are those of the timed batch, averaged over its iterations
+inline Result run(const Benchmark &benchmark)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr auto min_duration = std::chrono::milliseconds(200);
+
+    std::size_t iterations{ 1 };
+    while(true)
+    {
+        const auto allocations_before = allocation_count();
+        const auto start = clock::now();
+        for(std::size_t i = 0; i < iterations; ++i)
+        {
+            benchmark.body();
+        }
+        const auto elapsed = clock::now() - start;
+        const auto allocations = allocation_count() - allocations_before;
+
+        if(elapsed >= min_duration)
+        {
+            const auto seconds = std::chrono::duration<double>(elapsed).count();
+            const auto count = static_cast<double>(iterations);
+            const Result result{
+                .name = benchmark.name,
+                .iterations = iterations,
+                .ns_per_iteration = seconds * 1e9 / count,
+                .mb_per_second =
+                    static_cast<double>(benchmark.bytes_per_iteration) * count / seconds / 1e6,
+                .files_per_second =
+                    static_cast<double>(benchmark.files_per_iteration) * count / seconds,
+                .allocations_per_iteration = static_cast<double>(allocations) / count,
+            };
+
+            std::printf("%-48s %12.1f ns/iter %10.1f MB/s %10.1f allocs/iter", result.name.c_str(),
+                result.ns_per_iteration, result.mb_per_second, result.allocations_per_iteration);
+            if(benchmark.files_per_iteration > 0)
+            {
+                std::printf(" %10.0f files/s", result.files_per_second);
+            }
+            std::printf("\n");
+
+            return result;
+        }
+
+        iterations *= 2;
+    }
+}
+} // namespace audiotag::bench
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <audiotag/tag.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace audiotag::APE
+{
+constexpr std::byte Identifier[8] = {
+    std::byte{ 'A' },
+    std::byte{ 'P' },
+    std::byte{ 'E' },
+    std::byte{ 'T' },
+    std::byte{ 'A' },
+    std::byte{ 'G' },
+    std::byte{ 'E' },
+    std::byte{ 'X' },
+};
+
+// Header and footer share this size and layout
+constexpr std::size_t FooterSize{ 32 };
+
+struct Footer
+{
+    std::uint32_t version{ 0 };
+    // items plus footer, without the optional header
+    std::uint32_t size{ 0 };
+    std::uint32_t item_count{ 0 };
+    bool has_header{ false };
+    bool read_only{ false };
+};
+
+// Decodes the footer at the start of `data`, nullopt when it is not one
+std::optional<Footer> parse_footer(std::span<const std::byte> data);
+
+enum class ItemType : std::uint8_t
+{
+    Text,
+    Binary,
+    Locator,
+};
+
+// Item borrowing key and value from the buffer of the Tags it belongs to
+struct Item
+{
+    std::string_view key;
+    std::span<const std::byte> value;
+    ItemType type{ ItemType::Text };
+    bool read_only{ false };
+};
+
+// Tag decoded from a buffer holding its item area, keys and values are views
+// into that buffer; copies share it. APEv1 text is Latin-1, such values that are
+// not plain ASCII are converted to UTF-8 into a second shared buffer
+class Tags
+{
+public:
+    // `buffer` holds the `size` bytes of items between the header and footer
+    explicit Tags(
+        const Footer &footer, std::shared_ptr<const std::byte[]> &&buffer, std::size_t size);
+
+    std::uint32_t getVersion() const;
+    const std::vector<Item> &getItems() const;
+
+    // Item keys compare case insensitively, nullptr when there is none
+    const Item *findItem(std::string_view key) const;
+
+    // UTF-8 value of a text item, valid while any copy of these tags is alive
+    std::string_view getStringValue(Tag tag_name) const;
+
+private:
+    void convert_latin1_values();
+
+    std::uint32_t version;
+    std::shared_ptr<const std::byte[]> buffer;
+    std::shared_ptr<const std::byte[]> converted;
+    std::vector<Item> items;
+};
+} // namespace audiotag::APE
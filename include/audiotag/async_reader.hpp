@@ -0,0 +1,179 @@
+#pragma once
+
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/read_planner.hpp>
+#include <audiotag/task.hpp>
+
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace audiotag
+{
+// Reader whose read_at returns an awaitable yielding the number of bytes read,
+// shorter than `buffer` only at the end of the file
+template <typename T>
+concept AsyncReader = requires(T &reader, std::size_t offset, std::span<std::byte> buffer) {
+    { reader.length() } -> std::convertible_to<std::size_t>;
+    { reader.buffer_size() } -> std::convertible_to<std::size_t>;
+    reader.read_at(offset, buffer);
+};
+
+struct IoLoopOptions
+{
+    // Submission queue size of the io_uring backend
+    unsigned queue_depth{ 256 };
+    // Workers of the thread pool backend, 0 picks the hardware concurrency
+    unsigned thread_count{ 0 };
+    bool use_io_uring{ true };
+};
+
+// Single threaded event loop for coroutines doing file I/O. Reads and opens
+// go through io_uring, or a pool of blocking workers when io_uring is
+// unavailable; either way the awaiting coroutines are resumed on the thread
+// calling poll(), so any number of them interleave on that one thread.
+class IoLoop
+{
+public:
+    explicit IoLoop(const IoLoopOptions &options = {});
+    ~IoLoop();
+
+    IoLoop(const IoLoop &) = delete;
+    IoLoop &operator=(const IoLoop &) = delete;
+
+    bool uses_io_uring() const;
+
+    // Descriptor that becomes readable with completions pending, for embedding
+    // the loop into another one
+    int file_descriptor() const;
+
+    // Starts `task`, which runs until its first suspension right away; what
+    // escapes it is rethrown by run()
+    void spawn(Task<void> task);
+
+    // Number of spawned tasks that did not finish yet
+    std::size_t active_tasks() const;
+
+    // Waits up to `timeout` for completions and resumes their coroutines;
+    // returns the number of coroutines resumed
+    std::size_t poll(std::chrono::milliseconds timeout);
+
+    // Polls until every spawned task finished, rethrowing the first exception
+    // one of them raised
+    void run();
+
+private:
+    friend class AsyncFile;
+
+    struct Impl;
+
+    // One read or open in flight, completed with the syscall's result or -errno
+    struct Operation
+    {
+        Impl &loop;
+        int file_descriptor;
+        const char *path;
+        std::span<std::byte> buffer;
+        std::size_t offset;
+        std::coroutine_handle<> handle{};
+        int result{ 0 };
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting);
+
+        int await_resume() const noexcept
+        {
+            return result;
+        }
+    };
+
+    Operation read(int file_descriptor, std::span<std::byte> buffer, std::size_t offset);
+    Operation open(const char *path);
+
+private:
+    std::unique_ptr<Impl> impl;
+};
+
+// File opened for reading through an IoLoop, satisfying AsyncReader
+class AsyncFile
+{
+public:
+    // Throws std::system_error carrying errno when the file cannot be opened
+    static Task<AsyncFile> open(IoLoop &loop, std::string path);
+
+    ~AsyncFile();
+
+    AsyncFile(AsyncFile &&other) noexcept;
+    AsyncFile &operator=(AsyncFile &&other) noexcept;
+
+    std::size_t length() const;
+    std::size_t buffer_size() const;
+
+    // Throws std::system_error carrying errno when a read fails
+    Task<std::size_t> read_at(std::size_t offset, std::span<std::byte> buffer) const;
+
+private:
+    AsyncFile(IoLoop &loop, int file_descriptor);
+
+private:
+    IoLoop *loop;
+    int file_descriptor;
+    std::size_t file_size{ 0 };
+    std::size_t block_size{ 0 };
+};
+
+// MpegFile parse over bytes the caller fetches, for readers that must not
+// block. Each attempt parses over everything fetched so far and either
+// completes or leaves the ranges it ran into in missing(); the first ranges
+// are the head and tail windows of a ReadPlanner.
+class MpegProbe
+{
+public:
+    MpegProbe(std::size_t length, std::size_t buffer_size, ReadOptions options = {});
+
+    // Ranges to read before the next attempt, each to be filled and resized to
+    // the bytes actually read
+    std::vector<ReadPlanner::Prefetched> &missing();
+
+    // Parses the file, nullopt while missing() is not empty afterwards. A range
+    // that was fetched short is not asked for again.
+    std::optional<MpegFile> attempt();
+
+private:
+    std::size_t file_length;
+    std::size_t block_size;
+    ReadOptions options;
+    std::vector<ReadPlanner::Prefetched> fetched;
+    std::vector<ReadPlanner::Prefetched> pending;
+};
+
+// Coroutine version of the MpegFile constructor: the same reads are issued,
+// each one awaited instead of blocking
+template <AsyncReader R> Task<MpegFile> read_mpeg(R &reader, ReadOptions options = {})
+{
+    MpegProbe probe{ reader.length(), reader.buffer_size(), std::move(options) };
+    while(true)
+    {
+        for(auto &range : probe.missing())
+        {
+            const std::size_t bytes_read = co_await reader.read_at(range.offset, range.data);
+            range.data.resize(bytes_read);
+        }
+
+        if(auto file = probe.attempt())
+        {
+            co_return std::move(*file);
+        }
+    }
+}
+} // namespace audiotag
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <audiotag/mpeg/mpeg_file.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+
+namespace audiotag
+{
+struct BatchOptions
+{
+    // Submission queue size of the io_uring backend, bounds the number of I/Os in flight
+    unsigned queue_depth{ 256 };
+    // Workers of the blocking fallback, 0 picks the hardware concurrency
+    unsigned thread_count{ 0 };
+    bool use_io_uring{ true };
+};
+
+struct BatchResult
+{
+    std::size_t index;
+    std::error_code error;
+    std::optional<MpegFile> file;
+};
+
+using BatchCallback = std::function<void(BatchResult &&result)>;
+
+// Reads the tags of every file in `paths` through io_uring, or a pool of
+// blocking workers when io_uring is unavailable. `callback` is invoked once
+// per path, in completion order and never concurrently; `index` refers to
+// the path's position in `paths`.
+void read_mpeg_files(std::span<const std::string> paths,
+    const BatchCallback &callback,
+    const BatchOptions &options = {});
+} // namespace audiotag
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <string>
 
@@ -40,6 +42,12 @@ constexpr std::uint32_t to_u32_be(const std::span<const std::byte> data)
            std::to_integer<std::uint32_t>(data[2]) << 8 | std::to_integer<std::uint32_t>(data[3]);
 }
 
+constexpr std::uint32_t to_u32_le(const std::span<const std::byte> data)
+{
+    return std::to_integer<std::uint32_t>(data[3]) << 24 | std::to_integer<std::uint32_t>(data[2]) << 16 |
+           std::to_integer<std::uint32_t>(data[1]) << 8 | std::to_integer<std::uint32_t>(data[0]);
+}
+
 constexpr std::uint32_t to_synch_uint32_t(const std::span<const std::byte> data)
 {
     std::uint32_t value{ 0 };
@@ -50,7 +58,37 @@ constexpr std::uint32_t to_synch_uint32_t(const std::span<const std::byte> data)
     return value;
 }
 
+// Reverts ID3v2 unsynchronization in place by dropping the 0x00 inserted after
+// every 0xFF, returns the size of the decoded data at the front of `data`
+std::size_t remove_unsynchronization(std::span<std::byte> data);
+
+// Worst case UTF-8 size of `size` bytes of UTF-16, each unit expands to at most 3 bytes
+constexpr std::size_t utf8_max_size_of_utf16(std::size_t size)
+{
+    return size / 2 * 3;
+}
+
+// Whether `data` holds only 7-bit bytes, which read the same as Latin-1 and as UTF-8
+bool is_ascii(std::span<const std::byte> data);
+
 std::string from_latin1_to_utf8(std::span<const std::byte> data);
+void append_latin1_as_utf8(std::span<const std::byte> data, std::string &out);
+
+// Byte order announced by a leading BOM, nullopt when the data does not start with one
+std::optional<std::endian> detect_bom(std::span<const std::byte> data);
+
+// Transcodes UTF-16 straight to UTF-8 in one pass; unpaired surrogates become U+FFFD
+// and a trailing odd byte is ignored. The span overload writes into `out`, which
+// must hold utf8_max_size_of_utf16(data.size()) bytes, and returns the size written.
+std::size_t from_utf16_to_utf8(
+    std::span<const std::byte> data, std::endian endianness, std::span<char> out);
+void append_utf16_as_utf8(
+    std::span<const std::byte> data, std::endian endianness, std::string &out);
+std::string from_utf16_to_utf8(std::span<const std::byte> data, std::endian endianness);
+
+// UTF-16 with an optional leading BOM, data without one is taken as little endian
+std::string from_utf16_bom_to_utf8(std::span<const std::byte> data);
+
 std::endian from_bom_to_endian(std::byte bom_0, std::byte bom_1);
 std::u16string from_bytes_to_utf16(std::span<const std::byte> data, std::endian endianness);
 std::u16string from_bytes_to_utf16(std::span<const std::byte> data);
@@ -25,4 +25,13 @@ constexpr std::uint32_t byteswap(std::uint32_t value) noexcept
     return __builtin_bswap32(value);
 #endif
 }
+
+constexpr std::uint64_t byteswap(std::uint64_t value) noexcept
+{
+#if __cpp_lib_byteswap >= 202110L
+    return std::byteswap(value);
+#else // for now rely on gcc/clang builtins
+    return __builtin_bswap64(value);
+#endif
+}
 } // namespace audiotag
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace audiotag
+{
+// Columns of an export, stored in this order
+enum class Column : std::uint32_t
+{
+    Path,
+    Title,
+    Artist,
+    Album,
+    Genre,
+    Track,
+    Disc,
+    Year,
+    DurationMs,
+};
+
+constexpr std::size_t ColumnCount{ 9 };
+
+enum class ColumnEncoding : std::uint32_t
+{
+    // one value per row
+    Fixed32,
+    // row i holds bytes offsets[i] to offsets[i + 1] of the blob
+    Blob,
+    // one code per row into a dictionary of distinct values laid out like a
+    // blob column; code 0 is the empty string
+    Dictionary,
+};
+
+// Export layout, in host byte order: a ColumnarHeader, ColumnCount
+// ColumnDescriptors in Column order, then the sections they point at, 8 byte
+// aligned. Values, codes and offsets are std::uint32_t arrays used straight
+// from the mapping.
+constexpr std::uint32_t ColumnarVersion{ 1 };
+
+struct ColumnarHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    // checked like CacheHeader::byte_order
+    std::uint32_t byte_order;
+    std::uint64_t row_count;
+    std::uint32_t column_count;
+    std::uint32_t padding;
+    std::uint64_t descriptors_offset;
+    std::uint64_t reserved[3];
+};
+
+// Byte range of the file
+struct ColumnSection
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct ColumnDescriptor
+{
+    Column column;
+    ColumnEncoding encoding;
+    // Fixed32 values or Dictionary codes, one per row
+    ColumnSection values;
+    // Blob offsets, one more than there are rows, or dictionary offsets, one
+    // more than there are dictionary entries
+    ColumnSection offsets;
+    ColumnSection bytes;
+};
+
+static_assert(sizeof(ColumnarHeader) == 64);
+static_assert(sizeof(ColumnDescriptor) == 56);
+
+// String column of a ColumnarReader, valid while the reader is alive
+class StringColumn
+{
+public:
+    std::size_t size() const;
+    std::string_view operator[](std::size_t row) const;
+
+    bool is_dictionary() const;
+
+    // Dictionary columns only: the code of every row and the values codes
+    // refer to, so rows can be grouped without comparing strings
+    std::span<const std::uint32_t> codes() const;
+    std::size_t dictionary_size() const;
+    std::string_view dictionary_value(std::uint32_t code) const;
+
+private:
+    friend class ColumnarReader;
+    StringColumn(ColumnEncoding encoding,
+        std::size_t rows,
+        std::span<const std::uint32_t> codes,
+        std::span<const std::uint32_t> offsets,
+        std::string_view bytes);
+
+    std::string_view value(std::size_t index) const;
+
+private:
+    bool dictionary;
+    std::size_t rows;
+    std::span<const std::uint32_t> row_codes;
+    std::span<const std::uint32_t> offsets;
+    std::string_view bytes;
+};
+
+// Read only view of an export mapped into memory, opening validates the
+// header and the section bounds
+class ColumnarReader
+{
+public:
+    // Throws std::runtime_error when the file cannot be mapped or is not an
+    // export of this version and byte order
+    explicit ColumnarReader(std::string_view path);
+    ~ColumnarReader();
+
+    ColumnarReader(ColumnarReader &&other) noexcept;
+    ColumnarReader &operator=(ColumnarReader &&other) noexcept;
+
+    std::size_t row_count() const;
+
+    // Throws std::invalid_argument for string columns
+    std::span<const std::uint32_t> numbers(Column column) const;
+
+    // Throws std::invalid_argument for number columns
+    StringColumn strings(Column column) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+// Builds an export row by row. Path and title are blob columns, artist, album
+// and genre dictionary columns, the numbers fixed width; values are appended
+// to the columns as the tags are decoded.
+class ColumnarWriter
+{
+public:
+    ColumnarWriter();
+    ~ColumnarWriter();
+
+    ColumnarWriter(ColumnarWriter &&other) noexcept;
+    ColumnarWriter &operator=(ColumnarWriter &&other) noexcept;
+
+    // Values are taken in the order of to_track_metadata(). Throws
+    // std::length_error when a string column would exceed 4 GiB, leaving the
+    // rows added before as they were. An entry is stored under `path`, not the
+    // path it was cached with: a renamed file or another hard link still hits
+    // the cache.
+    void add(std::string_view path, const MpegFile &file);
+    void add(std::string_view path, const MetadataCache::Entry &entry);
+
+    std::size_t size() const;
+
+    // Replaces `path` as MetadataCacheWriter::write does. Throws std::system_error.
+    void write(std::string_view path) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+} // namespace audiotag
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <audiotag/read_planner.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace audiotag
+{
+class Reader;
+
+// Streaming XXH64, the same value as hashing all updates as one buffer
+class Xxh64
+{
+public:
+    explicit Xxh64(std::uint64_t seed = 0);
+
+    void update(std::span<const std::byte> data);
+    [[nodiscard]] std::uint64_t digest() const;
+
+    [[nodiscard]] static std::uint64_t hash(
+        std::span<const std::byte> data, std::uint64_t seed = 0);
+
+private:
+    std::array<std::uint64_t, 4> accumulators;
+    std::array<std::byte, 32> stripe{};
+    std::size_t stripe_size{ 0 };
+    std::uint64_t total_length{ 0 };
+    std::uint64_t seed;
+};
+
+// Ranges longer than one chunk hash as the XXH64 of their per-chunk XXH64
+// digests, which lets chunks be hashed in parallel; shorter ranges are plain XXH64
+constexpr std::size_t HashChunkSize{ 4 * 1024 * 1024 };
+
+struct HashOptions
+{
+    // 0 uses the hardware concurrency, 1 hashes on the calling thread
+    unsigned thread_count{ 1 };
+    // bytes per read, reads are aligned to multiples of it
+    std::size_t read_size{ 1024 * 1024 };
+    std::uint64_t seed{ 0 };
+};
+
+// Hashes `range` of the reader's content, borrowing it through Reader::view when
+// possible; the value does not depend on the thread count or read size
+std::uint64_t hash_range(
+    const Reader &reader, ReadPlanner::Range range, const HashOptions &options = {});
+} // namespace audiotag
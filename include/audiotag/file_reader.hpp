@@ -21,6 +21,8 @@ public:
 
     bool seek(long offset) override;
 
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl;
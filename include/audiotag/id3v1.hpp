@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace audiotag::ID3v1
 {
@@ -11,6 +13,8 @@ constexpr std::byte Identifier[3] = {
     std::byte{ 'G' },
 };
 
+constexpr std::size_t TagSize{ 128 };
+
 struct Tags
 {
     std::string title;
@@ -21,4 +25,8 @@ struct Tags
     std::uint8_t track;
     std::uint8_t genre;
 };
+
+// Name of an ID3v1 genre number, including the Winamp extensions up to 191;
+// empty for 255, which marks no genre, and other unknown numbers
+std::string_view genre_name(std::uint8_t genre);
 } // namespace audiotag::ID3v1
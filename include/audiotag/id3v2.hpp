@@ -1,11 +1,17 @@
 #pragma once
 
+#include <audiotag/byte_conversions.hpp>
 #include <audiotag/tag.hpp>
 
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace audiotag::ID3v2
@@ -16,6 +22,45 @@ constexpr std::byte Identifier[3] = {
     std::byte{ '3' },
 };
 
+// Identifier of the footer closing a v2.4 tag, required for tags appended to the file
+constexpr std::byte FooterIdentifier[3] = {
+    std::byte{ '3' },
+    std::byte{ 'D' },
+    std::byte{ 'I' },
+};
+
+constexpr std::size_t HeaderSize{ 10 };
+
+namespace HeaderFlags
+{
+constexpr std::uint8_t Unsynchronization{ 0x80 };
+constexpr std::uint8_t ExtendedHeader{ 0x40 };
+constexpr std::uint8_t Experimental{ 0x20 };
+constexpr std::uint8_t Footer{ 0x10 };
+} // namespace HeaderFlags
+
+// Four character frame identifier packed big endian, so "TIT2" compares as one integer
+using FrameId = std::uint32_t;
+
+constexpr FrameId to_frame_id(const std::array<std::byte, 4> &id)
+{
+    return to_u32_be(id);
+}
+
+constexpr FrameId to_frame_id(std::string_view id)
+{
+    return static_cast<FrameId>(static_cast<std::uint8_t>(id[0])) << 24 |
+           static_cast<FrameId>(static_cast<std::uint8_t>(id[1])) << 16 |
+           static_cast<FrameId>(static_cast<std::uint8_t>(id[2])) << 8 |
+           static_cast<FrameId>(static_cast<std::uint8_t>(id[3]));
+}
+
+// Id of the text frame holding `tag`
+FrameId to_frame_id(Tag tag);
+
+// Size of the whole tag including its header, 0 when `header` does not start an ID3v2 tag
+std::size_t tag_size(std::span<const std::byte> header);
+
 struct Header
 {
     std::uint8_t version_major{ 0 };
@@ -23,6 +68,7 @@ struct Header
     bool unsynchronization{ false };
     bool extended_header{ false };
     bool experimental{ false };
+    bool footer{ false };
     std::uint32_t size{ 0 };
 };
 
@@ -36,6 +82,8 @@ struct TagFrame
     bool compression{ false };
     bool encryption{ false };
     bool grouping_identity{ false };
+    // group the frame belongs to, only meaningful with `grouping_identity`
+    std::uint8_t group_id{ 0 };
 };
 
 class Tags
@@ -51,4 +99,115 @@ private:
     Header header;
     std::vector<TagFrame> frames;
 };
+
+// Selects the frames a parse keeps; the parser skips the payloads of all
+// other frames and stops once each selected tag was found. An empty filter
+// keeps every frame.
+class FrameFilter
+{
+public:
+    FrameFilter() = default;
+    FrameFilter(std::initializer_list<Tag> tags);
+
+    void add(Tag tag);
+    void add(std::string_view frame_id);
+
+    bool empty() const;
+    std::size_t size() const;
+    bool contains(FrameId frame_id) const;
+
+    // Number of tags and frame ids added; a tag is satisfied by any of the
+    // frame ids it maps to, e.g. TDRC or TYER for YEAR
+    std::size_t group_count() const;
+
+    // Group `frame_id` satisfies, group_count() when it is not selected
+    std::size_t group(FrameId frame_id) const;
+
+private:
+    std::vector<FrameId> frame_ids;
+    std::vector<std::size_t> groups;
+    std::size_t groups_added{ 0 };
+};
+
+// Frame header flags, decoded for the bit positions of the tag's major version
+struct FrameFlags
+{
+    bool tag_preservation{ false };
+    bool file_preservation{ false };
+    bool read_only{ false };
+    bool grouping_identity{ false };
+    bool compression{ false };
+    bool encryption{ false };
+    bool unsynchronization{ false };
+    bool data_length_indicator{ false };
+};
+
+FrameFlags decode_frame_flags(std::uint8_t version_major, std::uint16_t flags);
+
+// Frame borrowing its data from the tag buffer of the TagsView it belongs to.
+// `data` follows the group, encryption and length fields the flags announce and
+// is still compressed for compressed frames; `data_length` is the decoded size
+// when the frame states one and `group_id` the group when the frame has one.
+struct FrameView
+{
+    std::array<std::byte, 4> id;
+    std::uint16_t flags{ 0 };
+    std::span<const std::byte> data;
+    std::uint32_t data_length{ 0 };
+    std::uint8_t group_id{ 0 };
+};
+
+// Parsed tag holding the whole tag body in a single shared buffer, frames are
+// spans into it; copies share the buffer. Frames are indexed by id once at
+// construction, lookups do not scan the frame list.
+class TagsView
+{
+public:
+    using StringVisitor = std::function<void(Tag tag, std::string_view value)>;
+
+    explicit TagsView(Header &&header,
+        std::shared_ptr<const std::byte[]> &&buffer,
+        std::vector<FrameView> &&frames);
+
+    const Header &getHeader() const;
+    const std::vector<FrameView> &getFrames() const;
+
+    // First frame with the given id, nullptr when there is none
+    const FrameView *findFrame(FrameId frame_id) const;
+
+    // Contents of `frame`, inflated when compressed. Inflated data lives in a
+    // per-thread scratch buffer valid until the next call on the same thread;
+    // encrypted frames, frames that fail to inflate and frames inflating past
+    // their `data_length` (or 256 MiB when they state none) are empty.
+    std::span<const std::byte> getFrameData(const FrameView &frame) const;
+
+    std::string getStringValue(Tag tag_name) const;
+
+    // Values of all `tags` in one pass over the tag, empty strings for missing frames
+    std::vector<std::string> getStringValues(std::span<const Tag> tags) const;
+
+    // Decodes the frames of `tags` in the order they appear in the tag, calling
+    // `visitor` once for each one present; the value is only valid during the call.
+    // UTF-8 and ASCII Latin-1 text of uncompressed frames is passed straight
+    // from the frame; other encodings and inflated frames are decoded into a
+    // per-thread buffer reused across calls, so the visitor may read other
+    // frames or visit another tag while holding the value.
+    void visitStringValues(std::span<const Tag> tags, const StringVisitor &visitor) const;
+
+    // Copies every frame into an owning Tags
+    Tags toTags() const;
+
+private:
+    struct IndexEntry
+    {
+        FrameId frame_id;
+        std::uint32_t frame_index;
+    };
+
+private:
+    Header header;
+    std::shared_ptr<const std::byte[]> buffer;
+    std::vector<FrameView> frames;
+    std::vector<IndexEntry> index;
+};
 } // namespace audiotag::ID3v2
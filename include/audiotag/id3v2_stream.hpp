@@ -0,0 +1,105 @@
+#pragma once
+
+#include <audiotag/id3v2.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace audiotag::ID3v2
+{
+struct StreamOptions
+{
+    // Frames to deliver, the payloads of all other frames pass without being buffered
+    FrameFilter filter{};
+    // Larger frames, such as embedded pictures, are skipped the same way
+    std::size_t max_frame_size{ 1 << 20 };
+};
+
+// Push parser for a leading tag arriving in chunks of any size, from a pipe, a
+// socket or a partial download; it needs neither a length nor seeking. The
+// header and each frame are handed out as soon as their last byte was fed. At
+// most one frame is buffered, frames lying within a single chunk are not
+// copied at all.
+class StreamParser
+{
+public:
+    enum class State
+    {
+        Header,
+        Body,
+        Footer,
+        // the tag ended, the following bytes are the audio
+        Done,
+        // the stream does not start with a tag
+        NoTag,
+    };
+
+    using HeaderCallback = std::function<void(const Header &header)>;
+    // The frame data is only valid during the call
+    using FrameCallback = std::function<void(const FrameView &frame)>;
+
+    StreamParser(HeaderCallback on_header, FrameCallback on_frame, StreamOptions options = {});
+
+    // Parses the next bytes of the stream and returns how many of them belong
+    // to the tag. Less than data.size() means the tag ended within `data`, or
+    // that there is no tag; the rest of the stream starts after the returned
+    // count, preceded by unconsumed() in the latter case.
+    std::size_t feed(std::span<const std::byte> data);
+
+    State state() const;
+    bool done() const;
+
+    // Bytes of the stream taken by the tag so far
+    std::size_t consumed() const;
+
+    // Bytes fed before the stream turned out not to start with a tag
+    std::span<const std::byte> unconsumed() const;
+
+    // Frames passing the filter that were skipped for exceeding max_frame_size
+    std::size_t skipped_frames() const;
+
+private:
+    enum class Step
+    {
+        ExtendedHeaderSize,
+        Skip,
+        FrameHeader,
+        FrameData,
+        Padding,
+    };
+
+    std::size_t feed_header(std::span<const std::byte> data);
+    void feed_body(std::span<const std::byte> data);
+    void feed_frames(std::span<const std::byte> data);
+    void deliver_frame(std::span<const std::byte> data);
+    void end_body();
+
+private:
+    HeaderCallback on_header;
+    FrameCallback on_frame;
+    StreamOptions options;
+
+    State current_state{ State::Header };
+    Step step{ Step::FrameHeader };
+    Header header;
+
+    // partial header, frame header or frame data, never more than one frame
+    std::vector<std::byte> buffer;
+    std::array<std::byte, 4> frame_id{};
+    std::uint32_t frame_size{ 0 };
+    std::uint16_t frame_flags{ 0 };
+
+    std::size_t skip_remaining{ 0 };
+    // raw bytes of the body or footer not yet fed
+    std::size_t raw_remaining{ 0 };
+    // the last raw byte of a tag unsynchronized as a whole was 0xFF
+    bool previous_ff{ false };
+
+    std::size_t consumed_bytes{ 0 };
+    std::size_t skipped{ 0 };
+};
+} // namespace audiotag::ID3v2
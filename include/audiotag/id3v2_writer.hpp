@@ -0,0 +1,69 @@
+#pragma once
+
+#include <audiotag/id3v2.hpp>
+#include <audiotag/tag.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace audiotag::ID3v2
+{
+struct WriteOptions
+{
+    // 3 or 4, selects how frame sizes and the text of make_text_frame are encoded
+    std::uint8_t version{ 4 };
+    // zeroed bytes reserved after the frames whenever the file is rewritten, so
+    // that later edits fit in place
+    std::size_t padding{ 4096 };
+};
+
+enum class WriteMode
+{
+    InPlace,
+    Rewritten,
+};
+
+struct WriteResult
+{
+    WriteMode mode{ WriteMode::InPlace };
+    std::size_t bytes_written{ 0 };
+};
+
+// Text information frame holding `value`, UTF-8 in v2.4 and UTF-16 with a BOM in v2.3.
+// Throws std::invalid_argument when the frame id does not have four characters or
+// `value` is not valid UTF-8.
+TagFrame make_text_frame(
+    std::string_view frame_id, std::string_view value, std::uint8_t version = 4);
+TagFrame make_text_frame(Tag tag, std::string_view value, std::uint8_t version = 4);
+
+// Whether `frame` holds its decoded contents and can be written back. Encrypted
+// frames and compressed frames that could not be inflated have no data to write.
+bool writable(const TagFrame &frame);
+
+// Size of the smallest tag holding `frames`, header included
+std::size_t serialized_size(std::span<const TagFrame> frames);
+
+// Size `frames` are written with over a tag of `existing_size` bytes: the existing
+// size when they fit, otherwise their size plus `padding`
+std::size_t target_tag_size(
+    std::span<const TagFrame> frames, std::size_t existing_size, std::size_t padding);
+
+// Serializes `frames` into a tag of exactly `tag_size` bytes, the rest is padding.
+// The preservation, read only and grouping flags are written, frame data is stored
+// as is and uncompressed. Throws std::invalid_argument when a frame is not writable.
+std::vector<std::byte> serialize_tag(
+    std::span<const TagFrame> frames, std::uint8_t version, std::size_t tag_size);
+
+// Replaces the leading tag of the file with `frames`. When they fit in the current
+// tag and its padding only the tag region is overwritten, with a single write;
+// otherwise the file is rewritten once through a temporary file renamed over it.
+// A rewritten file keeps its mode, owner and group, but not its extended
+// attributes or ACLs, and hard links to it keep the old contents.
+// Throws std::invalid_argument when a frame is not writable, before touching the
+// file, and std::runtime_error on I/O failures.
+WriteResult write_tag(
+    std::string_view path, std::span<const TagFrame> frames, const WriteOptions &options = {});
+} // namespace audiotag::ID3v2
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/watcher.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace audiotag
+{
+// Metadata cache and search index of a library held in memory and patched by
+// watch events. An event only touches the entry of its file, or of the files
+// below its directory, and the postings of their tokens; nothing else is
+// parsed or tokenized again. Writing orders the entries into cache rows and
+// renumbers the postings to match, so the documents of the index are the rows
+// of the cache written with it, as audiotag-scan writes them.
+class LibraryIndex
+{
+public:
+    LibraryIndex();
+    // Starts from the entries of `cache`
+    explicit LibraryIndex(const MetadataCache &cache);
+    ~LibraryIndex();
+
+    LibraryIndex(LibraryIndex &&other) noexcept;
+    LibraryIndex &operator=(LibraryIndex &&other) noexcept;
+
+    // An update replaces the entry of its path, or drops it when the file
+    // failed to parse; a removal drops the entry of its path and, for a
+    // directory, of every file below it
+    void apply(const WatchEvent &event);
+
+    // Entries held, one per path
+    std::size_t size() const;
+
+    // Writes the cache and the index over the files at the given paths, each
+    // replaced as MetadataCacheWriter::write does. Paths sharing a file through
+    // hard links share its row. Throws std::system_error, or std::length_error
+    // when the strings, terms or postings exceed 4 GiB.
+    void write(std::string_view cache_path, std::string_view index_path) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+} // namespace audiotag
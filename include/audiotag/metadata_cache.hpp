@@ -0,0 +1,141 @@
+#pragma once
+
+#include <audiotag/track_metadata.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audiotag
+{
+// Identifies one version of a file, any write changes the size or the mtime
+struct FileKey
+{
+    std::uint64_t device{ 0 };
+    std::uint64_t inode{ 0 };
+    std::uint64_t size{ 0 };
+    std::int64_t mtime_ns{ 0 };
+
+    bool operator==(const FileKey &) const = default;
+};
+
+// Key of the file at `path`, nullopt when it cannot be stat'ed
+std::optional<FileKey> read_file_key(std::string_view path);
+
+// Cache file layout, in host byte order: a CacheHeader, `entry_count`
+// CacheRecords sorted by device and inode, then the string blob the records
+// point into. Records are used straight from the mapping.
+constexpr std::uint32_t CacheVersion{ 2 };
+
+struct CacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    // 0x01020304 as written by the host, caches of the other byte order are rejected
+    std::uint32_t byte_order;
+    std::uint64_t entry_count;
+    std::uint64_t records_offset;
+    std::uint64_t strings_offset;
+    std::uint64_t strings_size;
+    std::uint64_t reserved[2];
+};
+
+struct CacheString
+{
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+struct CacheRecord
+{
+    FileKey key;
+    CacheString path;
+    CacheString title;
+    CacheString artist;
+    CacheString album;
+    CacheString genre;
+    std::uint32_t track;
+    std::uint32_t disc;
+    std::uint32_t year;
+    std::uint32_t duration_ms;
+};
+
+static_assert(sizeof(CacheHeader) == 64);
+static_assert(sizeof(CacheRecord) == 88);
+
+// Read only view of a cache file mapped into memory; opening validates the
+// header, lookups binary search the mapped records
+class MetadataCache
+{
+public:
+    class Entry
+    {
+    public:
+        const FileKey &key() const;
+        std::string_view path() const;
+        std::string_view title() const;
+        std::string_view artist() const;
+        std::string_view album() const;
+        std::string_view genre() const;
+        std::uint32_t track() const;
+        std::uint32_t disc() const;
+        std::uint32_t year() const;
+        std::uint32_t duration_ms() const;
+
+        TrackMetadata to_track_metadata() const;
+
+    private:
+        friend class MetadataCache;
+        Entry(const CacheRecord &record, std::string_view strings);
+
+        std::string_view string(const CacheString &value) const;
+
+    private:
+        const CacheRecord *record;
+        std::string_view strings;
+    };
+
+    // Throws std::runtime_error when the file cannot be mapped or is not a
+    // cache of this version and byte order
+    explicit MetadataCache(std::string_view path);
+    ~MetadataCache();
+
+    MetadataCache(MetadataCache &&other) noexcept;
+    MetadataCache &operator=(MetadataCache &&other) noexcept;
+
+    std::size_t size() const;
+    Entry operator[](std::size_t index) const;
+
+    // Entry of the file `key` identifies, nullopt when the file is not cached
+    // or changed since
+    std::optional<Entry> find(const FileKey &key) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+class MetadataCacheWriter
+{
+public:
+    void add(const FileKey &key, std::string_view path, const TrackMetadata &metadata);
+    void add(const MetadataCache::Entry &entry);
+
+    std::size_t size() const;
+
+    // Writes the cache next to `path` and renames it over it, readers holding
+    // the previous cache keep their mapping. Throws std::system_error.
+    void write(std::string_view path) const;
+
+private:
+    CacheString add_string(std::string_view value);
+
+private:
+    std::vector<CacheRecord> records;
+    std::string strings;
+};
+} // namespace audiotag
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <audiotag/reader.hpp>
+
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace audiotag
+{
+class MmapReader : public Reader
+{
+public:
+    explicit MmapReader(std::string_view filename);
+    ~MmapReader();
+
+    std::size_t length() const override;
+    std::size_t buffer_size() const override;
+
+    std::size_t read(std::span<std::byte> buffer) override;
+
+    bool seek(long offset) override;
+
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override;
+
+    std::span<const std::byte> view(std::size_t offset, std::size_t length) const override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+} // namespace audiotag
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace audiotag
+{
+class ReadPlanner;
+}
+
+namespace audiotag::MPEG
+{
+constexpr std::size_t FrameHeaderSize{ 4 };
+
+enum class Version : std::uint8_t
+{
+    MPEG1,
+    MPEG2,
+    MPEG25,
+};
+
+enum class ChannelMode : std::uint8_t
+{
+    Stereo,
+    JointStereo,
+    DualChannel,
+    Mono,
+};
+
+struct FrameHeader
+{
+    Version version{ Version::MPEG1 };
+    std::uint8_t layer{ 0 };
+    // kbit/s
+    std::uint32_t bitrate{ 0 };
+    std::uint32_t sample_rate{ 0 };
+    ChannelMode channel_mode{ ChannelMode::Stereo };
+    bool padding{ false };
+    std::uint32_t frame_size{ 0 };
+    std::uint32_t samples{ 0 };
+};
+
+// Decodes the audio frame header at the start of `data`, nullopt for free
+// format, reserved values or a missing sync word
+std::optional<FrameHeader> parse_frame_header(std::span<const std::byte> data);
+
+// Offset of the first 11 bit sync word in `data`, data.size() when there is none
+std::size_t find_frame_sync(std::span<const std::byte> data);
+
+// Where the frame count and duration came from
+enum class VbrHeader : std::uint8_t
+{
+    None,
+    Xing,
+    Info,
+    VBRI,
+};
+
+struct AudioProperties
+{
+    Version version{ Version::MPEG1 };
+    std::uint8_t layer{ 0 };
+    std::uint32_t sample_rate{ 0 };
+    ChannelMode channel_mode{ ChannelMode::Stereo };
+    // average kbit/s
+    std::uint32_t bitrate{ 0 };
+    // exact with a VBR header, estimated from the audio size without one
+    std::uint64_t frame_count{ 0 };
+    std::chrono::milliseconds duration{ 0 };
+    VbrHeader vbr_header{ VbrHeader::None };
+    // gapless playback samples from the LAME tag, 0 without one
+    std::uint16_t encoder_delay{ 0 };
+    std::uint16_t encoder_padding{ 0 };
+};
+
+// Reads the properties of the audio between `audio_begin` and `audio_end`.
+// Only the first frame is decoded when it carries a Xing, Info or VBRI header,
+// otherwise a bounded number of leading frames is sampled and the rest
+// estimated from the audio size.
+std::optional<AudioProperties> read_audio_properties(
+    ReadPlanner &planner, std::size_t audio_begin, std::size_t audio_end);
+} // namespace audiotag::MPEG
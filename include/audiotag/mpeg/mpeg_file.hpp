@@ -1,9 +1,13 @@
 #pragma once
 
+#include <audiotag/ape.hpp>
 #include <audiotag/id3v1.hpp>
 #include <audiotag/id3v2.hpp>
+#include <audiotag/mpeg/audio_properties.hpp>
+#include <audiotag/read_planner.hpp>
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
@@ -13,20 +17,66 @@ namespace audiotag
 {
 class Reader;
 
+// What a parse reads besides the tags
+struct ReadOptions
+{
+    ID3v2::FrameFilter id3v2_filter;
+    // locates the first audio frame and its VBR header, which costs a read when
+    // the leading tag does not fit in the head window
+    bool audio_properties{ false };
+};
+
 class MpegFile
 {
 public:
     MpegFile(Reader &reader);
+    MpegFile(Reader &reader, const ID3v2::FrameFilter &filter);
+    MpegFile(Reader &reader, const ReadOptions &options);
+    explicit MpegFile(ReadPlanner &planner);
+    MpegFile(ReadPlanner &planner, const ID3v2::FrameFilter &filter);
+    MpegFile(ReadPlanner &planner, const ReadOptions &options);
+
+    const std::optional<ID3v1::Tags> &id3v1() const;
+    const std::optional<ID3v2::TagsView> &id3v2() const;
+
+    // v2.4 tag found after the audio through its footer, or where a SEEK frame
+    // of the leading tag points to. Filtered parses keep the SEEK frame of a
+    // leading v2.4 tag whatever the filter selects, but stop walking the tag
+    // once the selected frames are found, so they miss a SEEK placed after them.
+    const std::optional<ID3v2::TagsView> &id3v2_appended() const;
+    const std::optional<APE::Tags> &ape() const;
+
+    // Bytes between the leading ID3v2 tag and the tags trailing the audio,
+    // identical for files that differ only in their tags. A tag reached through
+    // SEEK is left out only when it ends the audio; one placed between audio
+    // frames stays inside the range.
+    ReadPlanner::Range audio_range() const;
 
-    const std::optional<ID3v1::Tags> &id3v1();
-    const std::optional<ID3v2::Tags> &id3v2();
+    // Stream parameters and duration, only read with ReadOptions::audio_properties;
+    // nullopt when no audio frame was found
+    const std::optional<MPEG::AudioProperties> &audio_properties() const;
 
 private:
-    std::optional<ID3v2::Tags> read_id3v2(Reader &reader);
-    std::optional<ID3v1::Tags> read_id3v1(Reader &reader);
+    void read(ReadPlanner &planner, const ReadOptions &options);
+    std::optional<ID3v2::TagsView> read_id3v2(
+        ReadPlanner &planner, const ID3v2::FrameFilter &filter, std::size_t tag_offset);
+    std::optional<ID3v2::TagsView> read_id3v2_frames(ReadPlanner &planner,
+        ID3v2::Header &&header,
+        const ID3v2::FrameFilter &filter,
+        std::size_t tag_offset,
+        bool keep_seek);
+    std::optional<ID3v2::TagsView> read_appended_id3v2(
+        ReadPlanner &planner, const ID3v2::FrameFilter &filter);
+    std::optional<ID3v1::Tags> read_id3v1(ReadPlanner &planner);
+    std::optional<APE::Tags> read_ape(ReadPlanner &planner);
 
 private:
     std::optional<ID3v1::Tags> id3v1_tags;
-    std::optional<ID3v2::Tags> id3v2_tags;
+    std::optional<ID3v2::TagsView> id3v2_tags;
+    std::optional<ID3v2::TagsView> id3v2_appended_tags;
+    std::optional<APE::Tags> ape_tags;
+    std::optional<MPEG::AudioProperties> properties;
+    std::size_t audio_begin{ 0 };
+    std::size_t audio_end{ 0 };
 };
 } // namespace audiotag
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace audiotag
+{
+class Reader;
+
+// Fetches one window at the head and one at the tail of the file up front and
+// serves tag probes from them; only ranges extending past the windows cost a
+// follow-up read. Spans returned by read() stay valid for the planner's lifetime.
+class ReadPlanner
+{
+public:
+    struct Range
+    {
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    struct Prefetched
+    {
+        std::size_t offset;
+        std::vector<std::byte> data;
+    };
+
+    explicit ReadPlanner(const Reader &reader);
+
+    // Adopts windows fetched elsewhere, e.g. asynchronously; `reader` only serves follow-ups
+    ReadPlanner(const Reader &reader, std::vector<Prefetched> &&prefetched);
+
+    // Windows the planner fetches up front for a file of `length` bytes
+    [[nodiscard]] static std::vector<Range> plan(std::size_t length, std::size_t buffer_size);
+
+    ReadPlanner(const ReadPlanner &) = delete;
+    ReadPlanner &operator=(const ReadPlanner &) = delete;
+
+    [[nodiscard]] std::size_t length() const;
+    [[nodiscard]] std::size_t window_size() const;
+
+    // Number of reads issued against the underlying reader so far
+    [[nodiscard]] std::size_t read_count() const;
+
+    // Returns up to `length` bytes at `offset`, shorter at end of file or when
+    // the reader returns fewer bytes than asked for
+    [[nodiscard]] std::span<const std::byte> read(std::size_t offset, std::size_t length);
+
+    // Copies bytes at `offset` into `buffer`, reading whatever the windows do not
+    // cover straight into it; returns the number of bytes copied
+    [[nodiscard]] std::size_t read_into(std::size_t offset, std::span<std::byte> buffer);
+
+private:
+    struct Window
+    {
+        std::size_t offset;
+        std::span<const std::byte> data;
+    };
+
+    [[nodiscard]] const Window *find_window(std::size_t offset) const;
+    std::span<const std::byte> fetch(std::size_t offset, std::size_t length);
+
+private:
+    const Reader &reader;
+    std::size_t file_length{ 0 };
+    std::size_t window{ 0 };
+    std::size_t reads{ 0 };
+    std::vector<Window> windows;
+    std::vector<std::vector<std::byte>> storage;
+};
+} // namespace audiotag
@@ -16,5 +16,19 @@ public:
     [[nodiscard]] virtual std::size_t read(std::span<std::byte> buffer) = 0;
 
     [[nodiscard]] virtual bool seek(long offset) = 0;
+
+    // Positional read that leaves the cursor untouched, safe to call
+    // concurrently. Readers that can only seek and read get one from
+    // SeekingReaderAdapter.
+    [[nodiscard]] virtual std::size_t read_at(
+        std::size_t offset, std::span<std::byte> buffer) const = 0;
+
+    // Borrows `length` bytes at `offset` without copying; readers that cannot
+    // expose their storage return an empty span and callers fall back to read()
+    [[nodiscard]] virtual std::span<const std::byte> view(
+        std::size_t offset, std::size_t length) const
+    {
+        return {};
+    }
 };
 } // namespace audiotag
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <audiotag/id3v2.hpp>
+#include <audiotag/id3v2_writer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace audiotag
+{
+struct RetagOptions
+{
+    // Write-ahead journal of the batch, empty to write without one. Creating it
+    // fails when it exists, a previous batch has to be recovered first. Files
+    // are journaled by absolute path, recovery may run from any directory.
+    std::string journal_path;
+    // Workers per device, files are grouped by the device they live on
+    unsigned threads_per_device{ 2 };
+    // Edits journaled and flushed together, each group costs one journal sync
+    // and one syncfs instead of a sync per file
+    std::size_t group_size{ 64 };
+    // Version of new tags and of existing tags other than v2.3 and v2.4
+    std::uint8_t version{ 4 };
+    // Padding reserved when a tag has to grow
+    std::size_t padding{ 4096 };
+};
+
+struct RetagResult
+{
+    std::error_code error;
+    bool changed{ false };
+    ID3v2::WriteMode mode{ ID3v2::WriteMode::InPlace };
+};
+
+// Edits the ID3v2 frames of the file at `index`, returns false to leave it untouched;
+// `version` is the major version the tag is written with. Called concurrently.
+using RetagFunction = std::function<bool(
+    std::size_t index, std::uint8_t version, std::vector<ID3v2::TagFrame> &frames)>;
+
+// Applies `edit` to every file in `paths` on a pool of workers per device.
+// Tags that still fit are overwritten in place, the others are rewritten through
+// a temporary file and an atomic rename, with the caveats of ID3v2::write_tag
+// for extended attributes and hard links. Results are indexed like `paths`; an
+// exception thrown by `edit` stops the batch and is rethrown, leaving the journal
+// for recovery. The journal is removed once every journaled edit committed.
+std::vector<RetagResult> retag_files(std::span<const std::string> paths,
+    const RetagFunction &edit,
+    const RetagOptions &options = {});
+
+enum class RecoveryMode
+{
+    RollForward,
+    RollBack,
+};
+
+struct RecoveryReport
+{
+    // Files written to the state the mode selects
+    std::size_t replayed{ 0 };
+    // Files that already were in that state
+    std::size_t unchanged{ 0 };
+    // Files matching neither the old nor the new tag, left untouched, by the
+    // absolute path they were journaled with
+    std::vector<std::string> conflicts;
+};
+
+// Completes or undoes the edits a batch journaled but did not commit, removes
+// leftover temporary files and then the journal. Throws std::system_error when
+// the journal cannot be read or its removal cannot be synced.
+RecoveryReport recover_journal(std::string_view journal_path, RecoveryMode mode);
+} // namespace audiotag
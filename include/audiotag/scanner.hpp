@@ -0,0 +1,57 @@
+#pragma once
+
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace audiotag
+{
+struct ScanOptions
+{
+    // Workers traversing and parsing, 0 picks the hardware concurrency
+    unsigned thread_count{ 0 };
+    // File name extensions parsed, compared case insensitively
+    std::vector<std::string> extensions{ ".mp3" };
+    bool follow_symlinks{ false };
+    ReadOptions read_options{};
+    // Files whose key is found in the cache are not opened, their result
+    // carries the cached entry instead of a parsed file
+    const MetadataCache *cache{ nullptr };
+};
+
+struct ScanResult
+{
+    std::string path;
+    // set for files that failed to open and directories that failed to list
+    std::error_code error;
+    std::optional<MpegFile> file;
+    // key of the version of the file that was parsed or found in the cache
+    FileKey key{};
+    std::optional<MetadataCache::Entry> cached{};
+};
+
+// Called from the workers, concurrently; the result may be moved from
+using ScanSink = std::function<void(ScanResult &&result)>;
+
+// Whether `name` ends with one of `extensions`, compared case insensitively
+bool has_extension(std::string_view name, std::span<const std::string> extensions);
+
+// Parses the file at `path` the way a scan does, or takes it from the cache
+ScanResult scan_file(std::string path, const ScanOptions &options = {});
+
+// Walks the directory trees under `roots` on a pool of workers that steal
+// directories and batches of files from each other, parsing every file whose
+// extension matches. Entries are listed with getdents64 and only stat'ed when
+// the directory does not report their type. Rethrows the first exception the
+// sink throws once the workers stopped.
+void scan_directories(
+    std::span<const std::string> roots, const ScanSink &sink, const ScanOptions &options = {});
+} // namespace audiotag
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <audiotag/metadata_cache.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audiotag
+{
+// Search form of UTF-8 `text`: lower case with diacritics and apostrophes
+// stripped for Latin scripts, lower case for Greek and Cyrillic, and every run
+// of punctuation and spaces collapsed into one space. Tokens are separated by
+// single spaces.
+std::string fold_search_text(std::string_view text);
+
+// Index file layout, in host byte order: a SearchIndexHeader, `term_count` + 1
+// offsets of the folded terms into the term blob, sorted bytewise, then
+// `term_count` + 1 offsets into the postings, which list the sorted documents
+// of each term. Offsets and postings are std::uint32_t.
+constexpr std::uint32_t SearchIndexVersion{ 1 };
+
+struct SearchIndexHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    // checked like CacheHeader::byte_order
+    std::uint32_t byte_order;
+    std::uint64_t term_count;
+    std::uint64_t term_offsets_offset;
+    std::uint64_t terms_offset;
+    std::uint64_t terms_size;
+    std::uint64_t posting_offsets_offset;
+    std::uint64_t postings_offset;
+    std::uint64_t posting_count;
+    std::uint64_t reserved;
+};
+
+static_assert(sizeof(SearchIndexHeader) == 80);
+
+// Terms [begin, end) of an index
+struct TermRange
+{
+    std::size_t begin{ 0 };
+    std::size_t end{ 0 };
+
+    std::size_t size() const
+    {
+        return end - begin;
+    }
+};
+
+// Read only view of an index file mapped into memory. The sorted terms act as
+// a flattened trie: the terms sharing a prefix are one contiguous range found
+// by two binary searches, without any node to chase through the mapping.
+class SearchIndex
+{
+public:
+    // Throws std::runtime_error when the file cannot be mapped or is not an
+    // index of this version and byte order
+    explicit SearchIndex(std::string_view path);
+    ~SearchIndex();
+
+    SearchIndex(SearchIndex &&other) noexcept;
+    SearchIndex &operator=(SearchIndex &&other) noexcept;
+
+    std::size_t term_count() const;
+    std::string_view term(std::size_t index) const;
+    std::span<const std::uint32_t> postings(std::size_t index) const;
+
+    // Terms starting with `prefix`, which has to be folded already
+    TermRange prefix_range(std::string_view prefix) const;
+
+    // Documents holding every token of `query`, folded here, in ascending
+    // order. The last token matches as a prefix unless the query ends with a
+    // space, so the results follow a query as it is typed.
+    std::vector<std::uint32_t> search(std::string_view query,
+        std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+class SearchIndexWriter
+{
+public:
+    // Document dropped by the renumbering write
+    static constexpr std::uint32_t NoDocument{ std::numeric_limits<std::uint32_t>::max() };
+
+    SearchIndexWriter();
+    ~SearchIndexWriter();
+
+    SearchIndexWriter(SearchIndexWriter &&other) noexcept;
+    SearchIndexWriter &operator=(SearchIndexWriter &&other) noexcept;
+
+    // Indexes the tokens of `text` for `document`, an id of the caller's
+    // choosing such as the row of a MetadataCache or a columnar export
+    void add(std::uint32_t document, std::string_view text);
+
+    // Indexes the title, artist and album of a cache entry
+    void add(std::uint32_t document, const MetadataCache::Entry &entry);
+
+    // Drops `document` from the postings of every token of `text`, terms left
+    // without documents are forgotten. Meant to undo all the add() calls of a
+    // document, a token it also holds in text that stays indexed is dropped too.
+    void remove(std::uint32_t document, std::string_view text);
+
+    std::size_t term_count() const;
+
+    // Replaces `path` as MetadataCacheWriter::write does. Throws
+    // std::system_error, or std::length_error when the terms or postings
+    // exceed 4 GiB.
+    void write(std::string_view path) const;
+
+    // As above, storing each document `d` as `documents[d]`; documents outside
+    // `documents` or mapped to NoDocument are left out, and so are the terms
+    // only they held
+    void write(std::string_view path, std::span<const std::uint32_t> documents) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+} // namespace audiotag
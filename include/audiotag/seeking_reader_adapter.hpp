@@ -0,0 +1,83 @@
+#pragma once
+
+#include <audiotag/reader.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <span>
+
+namespace audiotag
+{
+// Reader over a stream that can only seek and read. `Stream` provides length(),
+// buffer_size(), read(buffer) and a seek(offset) returning true on success,
+// unlike fseek. Positional reads seek and read the stream under a lock of this
+// adapter, so they may be called concurrently but run one at a time. The
+// adapter keeps its own cursor; the stream must not be used directly while
+// it is wrapped.
+template <typename Stream> class SeekingReaderAdapter : public Reader
+{
+public:
+    explicit SeekingReaderAdapter(Stream &stream)
+    : stream{ stream }
+    {
+    }
+
+    SeekingReaderAdapter(const SeekingReaderAdapter &) = delete;
+    SeekingReaderAdapter &operator=(const SeekingReaderAdapter &) = delete;
+
+    std::size_t length() const override
+    {
+        return stream.length();
+    }
+
+    std::size_t buffer_size() const override
+    {
+        return stream.buffer_size();
+    }
+
+    std::size_t read(std::span<std::byte> buffer) override
+    {
+        const auto bytes_read = read_at(cursor, buffer);
+        cursor += bytes_read;
+        return bytes_read;
+    }
+
+    bool seek(long offset) override
+    {
+        if(offset < 0)
+        {
+            return false;
+        }
+
+        cursor = offset;
+        return true;
+    }
+
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override
+    {
+        const std::lock_guard lock{ mutex };
+
+        if(!stream.seek(static_cast<long>(offset)))
+        {
+            return 0;
+        }
+
+        std::size_t total{ 0 };
+        while(total < buffer.size())
+        {
+            const auto bytes_read = stream.read(buffer.subspan(total));
+            if(bytes_read == 0)
+            {
+                break;
+            }
+            total += bytes_read;
+        }
+        return total;
+    }
+
+private:
+    Stream &stream;
+    std::size_t cursor{ 0 };
+    mutable std::mutex mutex;
+};
+} // namespace audiotag
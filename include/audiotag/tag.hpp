@@ -9,5 +9,7 @@ enum class Tag
     ALBUM,
     DISCNUMBER,
     TRACKNUMBER,
+    GENRE,
+    YEAR,
 };
 }
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace audiotag
+{
+template <typename T> class Task;
+
+namespace detail
+{
+template <typename T> class TaskResult
+{
+public:
+    template <typename U> void return_value(U &&value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+
+    T take()
+    {
+        return std::move(*result);
+    }
+
+private:
+    std::optional<T> result;
+};
+
+template <> class TaskResult<void>
+{
+public:
+    void return_void()
+    {
+    }
+
+    void take()
+    {
+    }
+};
+} // namespace detail
+
+// Lazily started coroutine producing a T. Awaiting it runs it on the awaiting
+// thread and resumes the awaiting coroutine as soon as it finished, without
+// going back through the event loop.
+template <typename T = void> class Task
+{
+public:
+    class promise_type : public detail::TaskResult<T>
+    {
+    public:
+        Task get_return_object()
+        {
+            return Task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() noexcept
+                {
+                }
+            };
+
+            return FinalAwaiter{};
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+
+    private:
+        friend class Task;
+
+        std::coroutine_handle<> continuation{ std::noop_coroutine() };
+        std::exception_ptr exception;
+    };
+
+    Task(Task &&other) noexcept
+    : handle{ std::exchange(other.handle, {}) }
+    {
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if(this != &other)
+        {
+            if(handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if(handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    // Rethrows what escaped the coroutine
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept
+            {
+                return handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                auto &promise = handle.promise();
+                if(promise.exception)
+                {
+                    std::rethrow_exception(promise.exception);
+                }
+                return promise.take();
+            }
+        };
+
+        return Awaiter{ handle };
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+    : handle{ handle }
+    {
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+} // namespace audiotag
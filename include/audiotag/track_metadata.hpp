@@ -0,0 +1,46 @@
+#pragma once
+
+#include <audiotag/mpeg/mpeg_file.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace audiotag
+{
+// One value per field, taken from the first tag holding it in the order
+// leading ID3v2, APE, appended ID3v2, ID3v1
+struct TrackMetadata
+{
+    std::string title;
+    std::string artist;
+    std::string album;
+    std::string genre;
+    // leading number of "5/12" style values, 0 when absent
+    std::uint32_t track{ 0 };
+    std::uint32_t disc{ 0 };
+    std::uint32_t year{ 0 };
+    // 0 unless the file was read with ReadOptions::audio_properties
+    std::uint32_t duration_ms{ 0 };
+};
+
+TrackMetadata to_track_metadata(const MpegFile &file);
+
+using TrackValueVisitor = std::function<void(Tag tag, std::string_view value)>;
+
+// Calls `visitor` once for each of `tags` that `file` holds a non-empty value
+// for, taken in the order above, with genre numbers resolved to names. Values
+// are only valid during the call. They point into the tags, except for ID3v2
+// text in UTF-16 or non-ASCII Latin-1, which is decoded into a reused buffer.
+void visit_track_values(
+    const MpegFile &file, std::span<const Tag> tags, const TrackValueVisitor &visitor);
+
+// Leading decimal number of `value`, 0 when it does not start with a digit
+std::uint32_t parse_number(std::string_view value);
+
+// Genre named by a tag value: ID3v1 genre numbers, plain or in the "(17)"
+// form of ID3v2.3, resolve to their name, other values are returned as is
+std::string_view resolve_genre(std::string_view value);
+} // namespace audiotag
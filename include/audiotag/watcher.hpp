@@ -0,0 +1,84 @@
+#pragma once
+
+#include <audiotag/scanner.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+
+namespace audiotag
+{
+struct WatchOptions
+{
+    // Quiet time after the last event for a file before it is parsed, so a
+    // burst of writes to one file costs one parse
+    std::chrono::milliseconds debounce{ 200 };
+    // Directories watched at most, 0 leaves only the kernel's limit. Subtrees
+    // that cannot be watched are rescanned every `rescan_interval` instead.
+    std::size_t max_watches{ 0 };
+    std::chrono::milliseconds rescan_interval{ std::chrono::minutes(1) };
+    // Parses go through these, rescans walk the tree with the same extensions
+    // and symlink handling. Followed symlinks are watched like directories; a
+    // directory reached through several paths is watched, and its changes
+    // reported, under the first of them only.
+    ScanOptions scan_options{ .thread_count = 1 };
+};
+
+enum class WatchEventKind
+{
+    // the file was created, written or moved in and `result` holds its tags
+    Updated,
+    // the file, or for a directory every file below it, is gone
+    Removed,
+};
+
+struct WatchEvent
+{
+    WatchEventKind kind;
+    ScanResult result;
+};
+
+using WatchSink = std::function<void(WatchEvent &&event)>;
+
+// Keeps an index of the files under a set of roots up to date through inotify.
+// Closed writes and moves into the tree are debounced and parsed, directories
+// created or moved in are watched and scanned, and a lost event queue triggers
+// a rescan of every root. Rescans compare the size and mtime of the files they
+// find with the versions last seen and only report files that changed or are
+// gone. Events are delivered on the thread calling poll(); a LibraryIndex
+// applies them to a cache and search index without rebuilding either.
+class LibraryWatcher
+{
+public:
+    // Watches every directory under `roots`. The files already there are not
+    // parsed, only their versions are recorded so rescans can tell changes.
+    // Throws std::system_error when inotify is unavailable.
+    LibraryWatcher(std::span<const std::string> roots, WatchSink sink, WatchOptions options = {});
+    ~LibraryWatcher();
+
+    LibraryWatcher(const LibraryWatcher &) = delete;
+    LibraryWatcher &operator=(const LibraryWatcher &) = delete;
+
+    // Descriptor that becomes readable with pending events, for event loops
+    int file_descriptor() const;
+
+    // Number of directories watched and subtrees rescanned periodically instead
+    std::size_t watch_count() const;
+    std::size_t unwatched_count() const;
+
+    // Waits up to `timeout` for events, then delivers everything whose debounce
+    // elapsed and runs due rescans; returns the number of events delivered
+    std::size_t poll(std::chrono::milliseconds timeout);
+
+    // Polls until `stop` is requested
+    void run(std::stop_token stop);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+} // namespace audiotag
@@ -0,0 +1,181 @@
+#include <audiotag/ape.hpp>
+#include <audiotag/byte_conversions.hpp>
+#include <frozen/map.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace audiotag::APE
+{
+static const constinit frozen::map<Tag, std::string_view, 7> tag_mapping = {
+    { Tag::TITLE, "Title" },
+    { Tag::ARIST, "Artist" },
+    { Tag::ALBUM, "Album" },
+    { Tag::TRACKNUMBER, "Track" },
+    { Tag::DISCNUMBER, "Disc" },
+    { Tag::GENRE, "Genre" },
+    { Tag::YEAR, "Year" },
+};
+
+namespace
+{
+constexpr std::uint32_t header_present_flag{ 1u << 31 };
+constexpr std::uint32_t is_header_flag{ 1u << 29 };
+constexpr std::uint32_t read_only_flag{ 1u << 0 };
+constexpr std::size_t item_header_size{ 8 };
+
+ItemType item_type(std::uint32_t flags)
+{
+    // the fourth encoding is reserved, its values are treated as opaque bytes
+    switch(flags >> 1 & 0x3)
+    {
+    case 0:
+        return ItemType::Text;
+    case 2:
+        return ItemType::Locator;
+    default:
+        return ItemType::Binary;
+    }
+}
+
+bool equals_ignore_case(std::string_view lhs, std::string_view rhs)
+{
+    return std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend(), [](char a, char b) {
+        const auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; };
+        return lower(a) == lower(b);
+    });
+}
+} // namespace
+
+std::optional<Footer> parse_footer(std::span<const std::byte> data)
+{
+    if(data.size() < FooterSize || std::memcmp(Identifier, data.data(), sizeof(Identifier)) != 0)
+    {
+        return std::nullopt;
+    }
+
+    const auto flags = to_u32_le(data.subspan(20, 4));
+    const auto size = to_u32_le(data.subspan(12, 4));
+    if((flags & is_header_flag) != 0 || size < FooterSize)
+    {
+        return std::nullopt;
+    }
+
+    return Footer{
+        .version = to_u32_le(data.subspan(8, 4)),
+        .size = size,
+        .item_count = to_u32_le(data.subspan(16, 4)),
+        .has_header = (flags & header_present_flag) != 0,
+        .read_only = (flags & read_only_flag) != 0,
+    };
+}
+
+Tags::Tags(const Footer &footer, std::shared_ptr<const std::byte[]> &&buffer, std::size_t size)
+: version{ footer.version }
+, buffer{ std::move(buffer) }
+{
+    const auto data = std::span<const std::byte>(this->buffer.get(), size);
+
+    // the item count comes from the file, cap the reservation by what could fit
+    items.reserve(std::min<std::size_t>(footer.item_count, size / (item_header_size + 2)));
+
+    std::size_t offset{ 0 };
+    while(items.size() < footer.item_count && offset + item_header_size < size)
+    {
+        const auto value_size = to_u32_le(data.subspan(offset, 4));
+        const auto flags = to_u32_le(data.subspan(offset + 4, 4));
+
+        const auto key_begin = offset + item_header_size;
+        const auto key_end = std::find(data.begin() + key_begin, data.end(), std::byte{ 0 });
+        const auto key_size = static_cast<std::size_t>(key_end - (data.begin() + key_begin));
+        const auto value_offset = key_begin + key_size + 1;
+
+        if(key_end == data.end() || value_size > size - value_offset)
+        {
+            break;
+        }
+
+        items.push_back(Item{
+            .key = { reinterpret_cast<const char *>(data.data() + key_begin), key_size },
+            .value = data.subspan(value_offset, value_size),
+            .type = item_type(flags),
+            .read_only = (flags & read_only_flag) != 0,
+        });
+
+        offset = value_offset + value_size;
+    }
+
+    if(version < 2000)
+    {
+        convert_latin1_values();
+    }
+}
+
+void Tags::convert_latin1_values()
+{
+    std::string text;
+    std::vector<std::pair<Item *, std::size_t>> converted_items;
+    for(auto &item : items)
+    {
+        if(item.type == ItemType::Text && !is_ascii(item.value))
+        {
+            converted_items.emplace_back(&item, text.size());
+            append_latin1_as_utf8(item.value, text);
+        }
+    }
+
+    if(converted_items.empty())
+    {
+        return;
+    }
+
+    auto utf8 = std::make_shared_for_overwrite<std::byte[]>(text.size());
+    std::memcpy(utf8.get(), text.data(), text.size());
+    const auto data = std::span<const std::byte>(utf8.get(), text.size());
+
+    for(std::size_t i = 0; i < converted_items.size(); ++i)
+    {
+        const auto [item, begin] = converted_items[i];
+        const auto end =
+            i + 1 < converted_items.size() ? converted_items[i + 1].second : data.size();
+        item->value = data.subspan(begin, end - begin);
+    }
+
+    converted = std::move(utf8);
+}
+
+std::uint32_t Tags::getVersion() const
+{
+    return version;
+}
+
+const std::vector<Item> &Tags::getItems() const
+{
+    return items;
+}
+
+const Item *Tags::findItem(std::string_view key) const
+{
+    const auto item = std::find_if(items.cbegin(), items.cend(),
+        [key](const auto &item) { return equals_ignore_case(item.key, key); });
+
+    return item != items.cend() ? &*item : nullptr;
+}
+
+std::string_view Tags::getStringValue(Tag tag) const
+{
+    const auto *item = findItem(tag_mapping.at(tag));
+
+    if(item == nullptr || item->type != ItemType::Text)
+    {
+        return {};
+    }
+
+    return { reinterpret_cast<const char *>(item->value.data()), item->value.size() };
+}
+} // namespace audiotag::APE
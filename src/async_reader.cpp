@@ -0,0 +1,612 @@
+#include "audiotag/async_reader.hpp"
+
+#include "audiotag/reader.hpp"
+#include "file_io.hpp"
+#include "io_uring.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace audiotag
+{
+namespace
+{
+// reads are split so that their result always fits the int of a completion
+constexpr std::size_t max_read_size{ 1 << 30 };
+
+// Coroutine started right away and destroying itself once it finished
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+// Serves reads from the ranges fetched so far and notes the ones it could not
+// serve. Those reads come back short, which ReadPlanner::read clamps its spans
+// to, so an attempt parses whatever is fetched and the next one fills the gaps.
+class ProbeReader : public Reader
+{
+public:
+    ProbeReader(std::size_t file_length,
+        std::size_t block_size,
+        const std::vector<ReadPlanner::Prefetched> &fetched,
+        std::vector<ReadPlanner::Prefetched> &missing)
+    : file_length{ file_length }
+    , block_size{ block_size }
+    , fetched{ fetched }
+    , missing{ missing }
+    {
+    }
+
+    std::size_t length() const override
+    {
+        return file_length;
+    }
+
+    std::size_t buffer_size() const override
+    {
+        return block_size;
+    }
+
+    std::size_t read(std::span<std::byte> buffer) override
+    {
+        const auto bytes_read = read_at(cursor, buffer);
+        cursor += bytes_read;
+        return bytes_read;
+    }
+
+    bool seek(long offset) override
+    {
+        cursor = offset;
+        return offset >= 0;
+    }
+
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override
+    {
+        std::size_t copied{ 0 };
+        while(copied < buffer.size())
+        {
+            const auto *covering = find_range(offset + copied);
+            if(covering == nullptr)
+            {
+                break;
+            }
+
+            const auto range_offset = offset + copied - covering->offset;
+            const auto chunk =
+                std::min(buffer.size() - copied, covering->data.size() - range_offset);
+            std::memcpy(buffer.data() + copied, covering->data.data() + range_offset, chunk);
+            copied += chunk;
+        }
+
+        if(copied < buffer.size())
+        {
+            note_missing(offset + copied, buffer.size() - copied);
+        }
+
+        return copied;
+    }
+
+private:
+    const ReadPlanner::Prefetched *find_range(std::size_t offset) const
+    {
+        const ReadPlanner::Prefetched *covering{ nullptr };
+        for(const auto &range : fetched)
+        {
+            const auto end = range.offset + range.data.size();
+            if(offset >= range.offset && offset < end &&
+                (covering == nullptr || end > covering->offset + covering->data.size()))
+            {
+                covering = &range;
+            }
+        }
+
+        return covering;
+    }
+
+    void note_missing(std::size_t offset, std::size_t length) const
+    {
+        // a range read short already ended at the end of the file
+        const auto same_offset = [offset](const auto &range) { return range.offset == offset; };
+        if(offset >= file_length || std::ranges::any_of(fetched, same_offset))
+        {
+            return;
+        }
+
+        length = std::min(length, file_length - offset);
+        if(const auto found = std::ranges::find_if(missing, same_offset); found != missing.end())
+        {
+            found->data.resize(std::max(found->data.size(), length));
+            return;
+        }
+
+        missing.push_back({ offset, std::vector<std::byte>(length) });
+    }
+
+private:
+    std::size_t file_length;
+    std::size_t block_size;
+    std::size_t cursor{ 0 };
+    const std::vector<ReadPlanner::Prefetched> &fetched;
+    std::vector<ReadPlanner::Prefetched> &missing;
+};
+
+int perform(const char *path, int file_descriptor, std::span<std::byte> buffer, std::size_t offset)
+{
+    if(path != nullptr)
+    {
+        const auto opened = ::open(path, O_RDONLY | O_CLOEXEC);
+        return opened < 0 ? -errno : opened;
+    }
+
+    while(true)
+    {
+        const auto bytes_read =
+            pread(file_descriptor, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+        if(bytes_read >= 0)
+        {
+            return static_cast<int>(bytes_read);
+        }
+
+        if(errno != EINTR)
+        {
+            return -errno;
+        }
+    }
+}
+} // namespace
+
+struct IoLoop::Impl
+{
+    explicit Impl(const IoLoopOptions &options)
+    {
+        if(options.use_io_uring)
+        {
+            try
+            {
+                ring.emplace(std::max(options.queue_depth, 2u));
+                return;
+            }
+            catch(const std::runtime_error &)
+            {
+                // kernel without (usable) io_uring, fall through to blocking workers
+            }
+        }
+
+        event = FileDescriptor{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
+        if(event.get() < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+
+        const auto thread_count = options.thread_count == 0
+                                      ? std::max(std::thread::hardware_concurrency(), 1u)
+                                      : options.thread_count;
+        for(unsigned i = 0; i < thread_count; ++i)
+        {
+            workers.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    int file_descriptor() const
+    {
+        return ring ? ring->file_descriptor() : event.get();
+    }
+
+    void submit(Operation &operation)
+    {
+        ++in_flight;
+
+        if(!ring)
+        {
+            const std::lock_guard lock{ mutex };
+            queued.push_back(&operation);
+            wake.notify_one();
+            return;
+        }
+
+        // more operations than the ring holds would overflow its completion queue
+        if(in_ring == ring->entries())
+        {
+            queued.push_back(&operation);
+            return;
+        }
+
+        submit_to_ring(operation);
+    }
+
+    void submit_to_ring(Operation &operation)
+    {
+        ++in_ring;
+
+        auto *sqe = ring->get_sqe();
+        while(sqe == nullptr)
+        {
+            ring->submit(0);
+            sqe = ring->get_sqe();
+        }
+
+        if(operation.path != nullptr)
+        {
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uint64_t>(operation.path);
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        }
+        else
+        {
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = operation.file_descriptor;
+            sqe->addr = reinterpret_cast<std::uint64_t>(operation.buffer.data());
+            sqe->len = static_cast<std::uint32_t>(operation.buffer.size());
+            sqe->off = operation.offset;
+        }
+        sqe->user_data = reinterpret_cast<std::uint64_t>(&operation);
+    }
+
+    // Runs on the pool workers, the only code not on the polling thread
+    void work(std::stop_token stop)
+    {
+        while(true)
+        {
+            Operation *operation{ nullptr };
+            {
+                std::unique_lock lock{ mutex };
+                if(!wake.wait(lock, stop, [this] { return !queued.empty(); }))
+                {
+                    return;
+                }
+                operation = queued.front();
+                queued.pop_front();
+            }
+
+            operation->result = perform(operation->path, operation->file_descriptor,
+                operation->buffer, operation->offset);
+
+            {
+                const std::lock_guard lock{ mutex };
+                completed.push_back(operation);
+            }
+
+            const std::uint64_t signal{ 1 };
+            [[maybe_unused]] const auto written = ::write(event.get(), &signal, sizeof(signal));
+        }
+    }
+
+    std::size_t resume_completed()
+    {
+        std::size_t resumed{ 0 };
+
+        if(ring)
+        {
+            io_uring_cqe cqe{};
+            while(ring->pop(cqe))
+            {
+                --in_ring;
+                if(!queued.empty())
+                {
+                    submit_to_ring(*queued.front());
+                    queued.pop_front();
+                }
+
+                auto *operation = reinterpret_cast<Operation *>(cqe.user_data);
+                operation->result = cqe.res;
+                --in_flight;
+                ++resumed;
+                operation->handle.resume();
+            }
+            return resumed;
+        }
+
+        std::uint64_t signals{ 0 };
+        [[maybe_unused]] const auto drained = ::read(event.get(), &signals, sizeof(signals));
+
+        std::vector<Operation *> ready;
+        {
+            const std::lock_guard lock{ mutex };
+            ready.swap(completed);
+        }
+
+        for(auto *operation : ready)
+        {
+            --in_flight;
+            ++resumed;
+            operation->handle.resume();
+        }
+        return resumed;
+    }
+
+    Detached run_detached(Task<void> task)
+    {
+        try
+        {
+            co_await std::move(task);
+        }
+        catch(...)
+        {
+            if(failure == nullptr)
+            {
+                failure = std::current_exception();
+            }
+        }
+
+        --active;
+    }
+
+    std::optional<IoUring> ring;
+    FileDescriptor event;
+
+    std::mutex mutex;
+    std::condition_variable_any wake;
+    // waiting for a pool worker, or for room in the ring
+    std::deque<Operation *> queued;
+    std::vector<Operation *> completed;
+
+    std::size_t in_flight{ 0 };
+    std::size_t in_ring{ 0 };
+    std::size_t active{ 0 };
+    std::exception_ptr failure;
+
+    // stopped and joined first on destruction
+    std::vector<std::jthread> workers;
+};
+
+void IoLoop::Operation::await_suspend(std::coroutine_handle<> awaiting)
+{
+    handle = awaiting;
+    loop.submit(*this);
+}
+
+IoLoop::IoLoop(const IoLoopOptions &options)
+: impl{ std::make_unique<Impl>(options) }
+{
+}
+
+IoLoop::~IoLoop() = default;
+
+bool IoLoop::uses_io_uring() const
+{
+    return impl->ring.has_value();
+}
+
+int IoLoop::file_descriptor() const
+{
+    return impl->file_descriptor();
+}
+
+void IoLoop::spawn(Task<void> task)
+{
+    ++impl->active;
+    impl->run_detached(std::move(task));
+}
+
+std::size_t IoLoop::active_tasks() const
+{
+    return impl->active;
+}
+
+std::size_t IoLoop::poll(std::chrono::milliseconds timeout)
+{
+    if(impl->ring)
+    {
+        impl->ring->submit(0);
+    }
+
+    auto resumed = impl->resume_completed();
+    if(resumed == 0 && impl->in_flight > 0)
+    {
+        pollfd descriptor{ .fd = impl->file_descriptor(), .events = POLLIN, .revents = 0 };
+        if(::poll(&descriptor, 1, static_cast<int>(timeout.count())) > 0)
+        {
+            resumed = impl->resume_completed();
+        }
+    }
+
+    return resumed;
+}
+
+void IoLoop::run()
+{
+    while(impl->active > 0)
+    {
+        poll(std::chrono::milliseconds(100));
+    }
+
+    if(impl->failure != nullptr)
+    {
+        std::rethrow_exception(std::exchange(impl->failure, nullptr));
+    }
+}
+
+IoLoop::Operation IoLoop::read(
+    int file_descriptor, std::span<std::byte> buffer, std::size_t offset)
+{
+    return Operation{
+        .loop = *impl,
+        .file_descriptor = file_descriptor,
+        .path = nullptr,
+        .buffer = buffer.first(std::min(buffer.size(), max_read_size)),
+        .offset = offset,
+        .handle = {},
+        .result = 0,
+    };
+}
+
+IoLoop::Operation IoLoop::open(const char *path)
+{
+    return Operation{
+        .loop = *impl,
+        .file_descriptor = -1,
+        .path = path,
+        .buffer = {},
+        .offset = 0,
+        .handle = {},
+        .result = 0,
+    };
+}
+
+Task<AsyncFile> AsyncFile::open(IoLoop &loop, std::string path)
+{
+    const auto result = co_await loop.open(path.c_str());
+    if(result < 0)
+    {
+        throw std::system_error(-result, std::generic_category(), path);
+    }
+
+    co_return AsyncFile{ loop, result };
+}
+
+AsyncFile::AsyncFile(IoLoop &loop, int file_descriptor)
+: loop{ &loop }
+, file_descriptor{ file_descriptor }
+{
+    struct stat file_stat = {};
+    if(fstat(file_descriptor, &file_stat) != 0)
+    {
+        const auto error = errno;
+        close(file_descriptor);
+        throw std::system_error(error, std::generic_category(), "fstat");
+    }
+
+    file_size = static_cast<std::size_t>(file_stat.st_size);
+    block_size = static_cast<std::size_t>(file_stat.st_blksize);
+}
+
+AsyncFile::~AsyncFile()
+{
+    if(file_descriptor >= 0)
+    {
+        close(file_descriptor);
+    }
+}
+
+AsyncFile::AsyncFile(AsyncFile &&other) noexcept
+: loop{ other.loop }
+, file_descriptor{ std::exchange(other.file_descriptor, -1) }
+, file_size{ other.file_size }
+, block_size{ other.block_size }
+{
+}
+
+AsyncFile &AsyncFile::operator=(AsyncFile &&other) noexcept
+{
+    if(this != &other)
+    {
+        if(file_descriptor >= 0)
+        {
+            close(file_descriptor);
+        }
+
+        loop = other.loop;
+        file_descriptor = std::exchange(other.file_descriptor, -1);
+        file_size = other.file_size;
+        block_size = other.block_size;
+    }
+    return *this;
+}
+
+std::size_t AsyncFile::length() const
+{
+    return file_size;
+}
+
+std::size_t AsyncFile::buffer_size() const
+{
+    return block_size;
+}
+
+Task<std::size_t> AsyncFile::read_at(std::size_t offset, std::span<std::byte> buffer) const
+{
+    std::size_t total{ 0 };
+    while(total < buffer.size())
+    {
+        const auto result =
+            co_await loop->read(file_descriptor, buffer.subspan(total), offset + total);
+        if(result < 0)
+        {
+            throw std::system_error(-result, std::generic_category(), "read");
+        }
+
+        if(result == 0)
+        {
+            break;
+        }
+        total += static_cast<std::size_t>(result);
+    }
+
+    co_return total;
+}
+
+MpegProbe::MpegProbe(std::size_t length, std::size_t buffer_size, ReadOptions options)
+: file_length{ length }
+, block_size{ buffer_size }
+, options{ std::move(options) }
+{
+    for(const auto &range : ReadPlanner::plan(file_length, block_size))
+    {
+        pending.push_back({ range.offset, std::vector<std::byte>(range.length) });
+    }
+}
+
+std::vector<ReadPlanner::Prefetched> &MpegProbe::missing()
+{
+    return pending;
+}
+
+std::optional<MpegFile> MpegProbe::attempt()
+{
+    std::ranges::move(pending, std::back_inserter(fetched));
+    pending.clear();
+
+    // the planner fetches the same windows it planned, served from `fetched`
+    const ProbeReader reader{ file_length, block_size, fetched, pending };
+    ReadPlanner planner{ reader };
+    MpegFile file{ planner, options };
+
+    if(!pending.empty())
+    {
+        return std::nullopt;
+    }
+    return file;
+}
+} // namespace audiotag
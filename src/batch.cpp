@@ -0,0 +1,444 @@
+#include "audiotag/batch.hpp"
+
+#include "audiotag/read_planner.hpp"
+#include "audiotag/reader.hpp"
+#include "file_io.hpp"
+#include "io_uring.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+// Head and tail windows issued for a file
+std::vector<ReadPlanner::Prefetched> plan_windows(std::size_t file_size, std::size_t block_size)
+{
+    std::vector<ReadPlanner::Prefetched> windows;
+    for(const auto &range : ReadPlanner::plan(file_size, block_size))
+    {
+        windows.push_back({ range.offset, std::vector<std::byte>(range.length) });
+    }
+
+    return windows;
+}
+
+// Bytes of a leading ID3v2 tag that run past the head window
+std::size_t id3v2_overhang(
+    const std::vector<ReadPlanner::Prefetched> &windows, std::size_t file_size)
+{
+    const auto &head = windows.front().data;
+    const auto tag_end = std::min(ID3v2::tag_size(head), file_size);
+    return tag_end > head.size() ? tag_end - head.size() : 0;
+}
+
+class UringBatch
+{
+public:
+    UringBatch(
+        std::span<const std::string> paths, const BatchCallback &callback, unsigned queue_depth)
+    : ring{ std::max(queue_depth, 2u) }
+    , paths{ paths }
+    , callback{ callback }
+    , slots(std::max(ring.entries() / 2, 1u))
+    {
+        for(std::size_t i = 0; i < slots.size(); ++i)
+        {
+            free_slots.push_back(i);
+        }
+    }
+
+    void run()
+    {
+        while((next_path < paths.size() && failure == nullptr) || active_files > 0)
+        {
+            while(next_path < paths.size() && failure == nullptr && !free_slots.empty())
+            {
+                start(next_path++);
+            }
+
+            ring.submit(1);
+
+            io_uring_cqe cqe{};
+            while(ring.pop(cqe))
+            {
+                complete(cqe);
+            }
+        }
+
+        if(failure != nullptr)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+
+private:
+    enum class Operation : std::uint64_t
+    {
+        Open,
+        Stat,
+        Read,
+        Close,
+    };
+
+    struct Slot
+    {
+        std::size_t index{ 0 };
+        int file_descriptor{ -1 };
+        std::error_code error;
+        unsigned pending{ 0 };
+        bool extended{ false };
+        struct statx stat
+        {
+        };
+        std::vector<ReadPlanner::Prefetched> windows;
+    };
+
+    // user_data packs the operation, the window a read fills and the slot index
+    static constexpr std::uint64_t operation_bits{ 2 };
+    static constexpr std::uint64_t window_bits{ 2 };
+
+    io_uring_sqe *next_sqe()
+    {
+        auto *sqe = ring.get_sqe();
+        while(sqe == nullptr)
+        {
+            ring.submit(0);
+            sqe = ring.get_sqe();
+        }
+
+        return sqe;
+    }
+
+    void queue(
+        std::size_t slot_index, Operation operation, io_uring_sqe *sqe, std::size_t window = 0)
+    {
+        sqe->user_data = (slot_index << window_bits | window) << operation_bits |
+                         static_cast<std::uint64_t>(operation);
+        ++slots[slot_index].pending;
+    }
+
+    void start(std::size_t path_index)
+    {
+        const auto slot_index = free_slots.back();
+        free_slots.pop_back();
+        ++active_files;
+
+        auto &slot = slots[slot_index];
+        slot = Slot{};
+        slot.index = path_index;
+
+        const auto *path = paths[path_index].c_str();
+
+        // open and statx both go by path, so they are submitted together
+        auto *open_sqe = next_sqe();
+        open_sqe->opcode = IORING_OP_OPENAT;
+        open_sqe->fd = AT_FDCWD;
+        open_sqe->addr = reinterpret_cast<std::uint64_t>(path);
+        open_sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        queue(slot_index, Operation::Open, open_sqe);
+
+        auto *stat_sqe = next_sqe();
+        stat_sqe->opcode = IORING_OP_STATX;
+        stat_sqe->fd = AT_FDCWD;
+        stat_sqe->addr = reinterpret_cast<std::uint64_t>(path);
+        stat_sqe->len = STATX_SIZE;
+        stat_sqe->off = reinterpret_cast<std::uint64_t>(&slot.stat);
+        queue(slot_index, Operation::Stat, stat_sqe);
+    }
+
+    void read(std::size_t slot_index, std::size_t window_index)
+    {
+        auto &window = slots[slot_index].windows[window_index];
+
+        auto *sqe = next_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = slots[slot_index].file_descriptor;
+        sqe->addr = reinterpret_cast<std::uint64_t>(window.data.data());
+        sqe->len = static_cast<std::uint32_t>(window.data.size());
+        sqe->off = window.offset;
+        queue(slot_index, Operation::Read, sqe, window_index);
+    }
+
+    void complete(const io_uring_cqe &cqe)
+    {
+        const auto operation = static_cast<Operation>(cqe.user_data & ((1u << operation_bits) - 1));
+        const auto window_index = cqe.user_data >> operation_bits & ((1u << window_bits) - 1);
+        const auto slot_index = cqe.user_data >> (operation_bits + window_bits);
+
+        auto &slot = slots[slot_index];
+        --slot.pending;
+
+        if(operation == Operation::Close)
+        {
+            // a close the kernel never saw still has to happen
+            if((cqe.flags & IoUring::RefusedFlag) != 0)
+            {
+                close(slot.file_descriptor);
+            }
+            release(slot_index);
+            return;
+        }
+
+        if(cqe.res < 0)
+        {
+            slot.error = std::error_code(-cqe.res, std::generic_category());
+        }
+        else if(operation == Operation::Open)
+        {
+            slot.file_descriptor = cqe.res;
+        }
+        else if(operation == Operation::Read)
+        {
+            slot.windows[window_index].data.resize(cqe.res);
+        }
+
+        if(slot.pending == 0)
+        {
+            advance(slot_index);
+        }
+    }
+
+    // Moves a file whose outstanding operations all completed to its next stage
+    void advance(std::size_t slot_index)
+    {
+        auto &slot = slots[slot_index];
+
+        if(slot.error)
+        {
+            finish(slot_index, std::nullopt);
+            return;
+        }
+
+        // a throwing parse only fails this file; reads it already queued still
+        // complete into its buffers, so the slot is only finished after them
+        std::optional<MpegFile> file;
+        try
+        {
+            if(!parse(slot_index, file))
+            {
+                return;
+            }
+        }
+        catch(...)
+        {
+            slot.error = current_parse_error();
+            if(slot.pending > 0)
+            {
+                return;
+            }
+        }
+        finish(slot_index, std::move(file));
+    }
+
+    // Issues the slot's next reads and returns false, or parses the file once all are in
+    bool parse(std::size_t slot_index, std::optional<MpegFile> &file)
+    {
+        auto &slot = slots[slot_index];
+
+        const auto file_size = static_cast<std::size_t>(slot.stat.stx_size);
+        const auto block_size = static_cast<std::size_t>(slot.stat.stx_blksize);
+
+        if(slot.windows.empty() && file_size > 0)
+        {
+            slot.windows = plan_windows(file_size, block_size);
+            for(std::size_t i = 0; i < slot.windows.size(); ++i)
+            {
+                read(slot_index, i);
+            }
+            return false;
+        }
+
+        if(!slot.extended && !slot.windows.empty())
+        {
+            slot.extended = true;
+
+            const auto &head = slot.windows.front().data;
+            if(const auto overhang = id3v2_overhang(slot.windows, file_size); overhang > 0)
+            {
+                slot.windows.push_back({ head.size(), std::vector<std::byte>(overhang) });
+                read(slot_index, slot.windows.size() - 1);
+                return false;
+            }
+        }
+
+        const DescriptorReader reader{ slot.file_descriptor, file_size, block_size };
+        ReadPlanner planner{ reader, std::move(slot.windows) };
+        file.emplace(planner);
+        return true;
+    }
+
+    void finish(std::size_t slot_index, std::optional<MpegFile> &&file)
+    {
+        auto &slot = slots[slot_index];
+
+        if(failure == nullptr)
+        {
+            try
+            {
+                callback(BatchResult{
+                    .index = slot.index,
+                    .error = slot.error,
+                    .file = std::move(file),
+                });
+            }
+            catch(...)
+            {
+                // stop taking new paths but drain what the kernel still writes into
+                failure = std::current_exception();
+            }
+        }
+
+        if(slot.file_descriptor < 0)
+        {
+            release(slot_index);
+            return;
+        }
+
+        auto *sqe = next_sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = slot.file_descriptor;
+        queue(slot_index, Operation::Close, sqe);
+    }
+
+    void release(std::size_t slot_index)
+    {
+        slots[slot_index].windows.clear();
+        free_slots.push_back(slot_index);
+        --active_files;
+    }
+
+private:
+    IoUring ring;
+    std::span<const std::string> paths;
+    const BatchCallback &callback;
+    std::vector<Slot> slots;
+    std::vector<std::size_t> free_slots;
+    std::size_t next_path{ 0 };
+    std::size_t active_files{ 0 };
+    std::exception_ptr failure;
+};
+
+BatchResult read_blocking(const std::string &path, std::size_t index)
+{
+    BatchResult result{ .index = index, .error = {}, .file = std::nullopt };
+
+    const auto file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(file_descriptor < 0)
+    {
+        result.error = std::error_code(errno, std::generic_category());
+        return result;
+    }
+
+    struct stat file_stat = {};
+    if(fstat(file_descriptor, &file_stat) != 0)
+    {
+        result.error = std::error_code(errno, std::generic_category());
+    }
+    else
+    {
+        DescriptorReader reader{ file_descriptor, static_cast<std::size_t>(file_stat.st_size),
+            static_cast<std::size_t>(file_stat.st_blksize) };
+        try
+        {
+            result.file.emplace(reader);
+        }
+        catch(...)
+        {
+            // escaping the worker thread would terminate the process
+            result.file.reset();
+            result.error = current_parse_error();
+        }
+    }
+
+    close(file_descriptor);
+    return result;
+}
+
+void read_with_threads(
+    std::span<const std::string> paths, const BatchCallback &callback, unsigned thread_count)
+{
+    if(thread_count == 0)
+    {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    std::atomic<std::size_t> next_path{ 0 };
+    std::mutex callback_mutex;
+    std::exception_ptr failure;
+
+    const auto worker = [&] {
+        for(auto index = next_path++; index < paths.size(); index = next_path++)
+        {
+            auto result = read_blocking(paths[index], index);
+
+            const std::lock_guard lock{ callback_mutex };
+            if(failure != nullptr)
+            {
+                return;
+            }
+
+            try
+            {
+                callback(std::move(result));
+            }
+            catch(...)
+            {
+                failure = std::current_exception();
+                next_path = paths.size();
+            }
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    for(unsigned i = 0; i < std::min<std::size_t>(thread_count, paths.size()); ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    workers.clear();
+
+    if(failure != nullptr)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+} // namespace
+
+void read_mpeg_files(
+    std::span<const std::string> paths, const BatchCallback &callback, const BatchOptions &options)
+{
+    if(options.use_io_uring)
+    {
+        std::optional<UringBatch> batch;
+        try
+        {
+            batch.emplace(paths, callback, options.queue_depth);
+        }
+        catch(const std::runtime_error &)
+        {
+            // kernel without (usable) io_uring, fall through to blocking workers
+        }
+
+        if(batch)
+        {
+            batch->run();
+            return;
+        }
+    }
+
+    read_with_threads(paths, callback, options.thread_count);
+}
+} // namespace audiotag
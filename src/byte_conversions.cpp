@@ -1,32 +1,565 @@
 #include <audiotag/byte_conversions.hpp>
 #include <audiotag/byte_swap.hpp>
 
+#include <bit>
+#include <cstdint>
+#include <optional>
 #include <stdexcept>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// AVX2 is not part of the x86 baseline, its kernels are compiled for it
+// separately and picked at runtime on CPUs that have it
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define AUDIOTAG_AVX2_DISPATCH
+#endif
+
 namespace audiotag
 {
-std::string from_latin1_to_utf8(const std::span<const std::byte> data)
+namespace
 {
-    std::string out;
-    out.reserve(data.size());
+#if defined(AUDIOTAG_AVX2_DISPATCH)
+struct Avx2Blocks
+{
+    static constexpr std::size_t block_size{ 32 };
+
+    [[gnu::target("avx2")]] static std::size_t count_high_bytes(const unsigned char *src)
+    {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        return std::popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(block)));
+    }
+
+    [[gnu::target("avx2")]] static void copy(const unsigned char *src, unsigned char *dst)
+    {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), block);
+    }
+
+    [[gnu::target("avx2")]] static bool has_ff(const unsigned char *src)
+    {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(-1))) != 0;
+    }
+
+    // Every byte of the block is >= 0x80 and becomes a two byte sequence
+    [[gnu::target("avx2")]] static void expand(const unsigned char *src, unsigned char *dst)
+    {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        const auto lead = _mm256_or_si256(
+            _mm256_and_si256(_mm256_srli_epi16(block, 6), _mm256_set1_epi8(0x03)),
+            _mm256_set1_epi8(static_cast<char>(0xC0)));
+        const auto trail = _mm256_or_si256(_mm256_and_si256(block, _mm256_set1_epi8(0x3F)),
+            _mm256_set1_epi8(static_cast<char>(0x80)));
+
+        // unpack interleaves within 128-bit lanes, the permutes restore byte order
+        const auto low = _mm256_unpacklo_epi8(lead, trail);
+        const auto high = _mm256_unpackhi_epi8(lead, trail);
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(dst + 32), _mm256_permute2x128_si256(low, high, 0x31));
+    }
+};
+#endif
+
+#if defined(__SSE2__)
+struct BaselineBlocks
+{
+    static constexpr std::size_t block_size{ 16 };
+
+    static std::size_t count_high_bytes(const unsigned char *src)
+    {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        return std::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(block)));
+    }
+
+    static void copy(const unsigned char *src, unsigned char *dst)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+    }
+
+    static bool has_ff(const unsigned char *src)
+    {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(-1))) != 0;
+    }
+
+    // Every byte of the block is >= 0x80 and becomes a two byte sequence
+    static void expand(const unsigned char *src, unsigned char *dst)
+    {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        const auto lead = _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi16(block, 6), _mm_set1_epi8(0x03)),
+            _mm_set1_epi8(static_cast<char>(0xC0)));
+        const auto trail = _mm_or_si128(
+            _mm_and_si128(block, _mm_set1_epi8(0x3F)), _mm_set1_epi8(static_cast<char>(0x80)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi8(lead, trail));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_unpackhi_epi8(lead, trail));
+    }
+};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct BaselineBlocks
+{
+    static constexpr std::size_t block_size{ 16 };
+
+    static std::size_t count_high_bytes(const unsigned char *src)
+    {
+        return vaddvq_u8(vshrq_n_u8(vld1q_u8(src), 7));
+    }
+
+    static void copy(const unsigned char *src, unsigned char *dst)
+    {
+        vst1q_u8(dst, vld1q_u8(src));
+    }
+
+    static bool has_ff(const unsigned char *src)
+    {
+        return vmaxvq_u8(vld1q_u8(src)) == 0xFF;
+    }
+
+    // Every byte of the block is >= 0x80 and becomes a two byte sequence
+    static void expand(const unsigned char *src, unsigned char *dst)
+    {
+        const auto block = vld1q_u8(src);
+        const uint8x16x2_t expanded = { {
+            vorrq_u8(vshrq_n_u8(block, 6), vdupq_n_u8(0xC0)),
+            vorrq_u8(vandq_u8(block, vdupq_n_u8(0x3F)), vdupq_n_u8(0x80)),
+        } };
+        vst2q_u8(dst, expanded);
+    }
+};
+#else
+// No vector unit, every loop below runs its scalar tail only
+struct BaselineBlocks
+{
+    static constexpr std::size_t block_size{ 0 };
+};
+#endif
+
+// The loops are inlined into per instruction set entry points, so the block
+// functions inline into code compiled for the same target
+template <typename Blocks>
+[[gnu::always_inline]] inline std::size_t count_high_bytes(
+    const unsigned char *src, std::size_t size)
+{
+    std::size_t count{ 0 };
+    std::size_t i{ 0 };
+
+    if constexpr(Blocks::block_size > 0)
+    {
+        for(; i + Blocks::block_size <= size; i += Blocks::block_size)
+        {
+            count += Blocks::count_high_bytes(src + i);
+        }
+    }
 
-    for(const auto byte : data)
+    for(; i < size; ++i)
     {
-        const auto character = std::to_integer<unsigned char>(byte);
+        count += src[i] >> 7;
+    }
+
+    return count;
+}
+
+unsigned char *convert_scalar(const unsigned char *src, std::size_t size, unsigned char *dst)
+{
+    for(std::size_t i = 0; i < size; ++i)
+    {
+        const auto character = src[i];
         if(character < 0x80)
         {
-            out.push_back(character);
+            *dst++ = character;
         }
         else
         {
-            out.push_back(0xc0 | character >> 6);
-            out.push_back(0x80 | (character & 0x3f));
+            *dst++ = 0xc0 | character >> 6;
+            *dst++ = 0x80 | (character & 0x3f);
+        }
+    }
+
+    return dst;
+}
+
+template <typename Blocks>
+[[gnu::always_inline]] inline void convert(
+    const unsigned char *src, std::size_t size, unsigned char *dst)
+{
+    std::size_t i{ 0 };
+
+    if constexpr(Blocks::block_size > 0)
+    {
+        for(; i + Blocks::block_size <= size; i += Blocks::block_size)
+        {
+            const auto high_bytes = Blocks::count_high_bytes(src + i);
+            if(high_bytes == 0)
+            {
+                Blocks::copy(src + i, dst);
+                dst += Blocks::block_size;
+            }
+            else if(high_bytes == Blocks::block_size)
+            {
+                Blocks::expand(src + i, dst);
+                dst += 2 * Blocks::block_size;
+            }
+            else
+            {
+                dst = convert_scalar(src + i, Blocks::block_size, dst);
+            }
+        }
+    }
+
+    convert_scalar(src + i, size - i, dst);
+}
+
+template <typename Blocks>
+[[gnu::always_inline]] inline unsigned char *remove_unsynchronization(
+    unsigned char *data, std::size_t size)
+{
+    std::size_t read{ 0 };
+    std::size_t write{ 0 };
+    std::size_t scalar_end{ 0 };
+    bool previous_ff{ false };
+
+    while(read < size)
+    {
+        if constexpr(Blocks::block_size > 0)
+        {
+            // blocks without 0xFF move as a whole, and stay in place until the first removal
+            if(!previous_ff && read >= scalar_end && read + Blocks::block_size <= size)
+            {
+                if(!Blocks::has_ff(data + read))
+                {
+                    if(write != read)
+                    {
+                        Blocks::copy(data + read, data + write);
+                    }
+                    read += Blocks::block_size;
+                    write += Blocks::block_size;
+                    continue;
+                }
+
+                scalar_end = read + Blocks::block_size;
+            }
+        }
+
+        const auto byte = data[read++];
+        if(previous_ff && byte == 0x00)
+        {
+            previous_ff = false;
+            continue;
         }
+
+        data[write++] = byte;
+        previous_ff = byte == 0xFF;
     }
 
+    return data + write;
+}
+
+#if defined(AUDIOTAG_AVX2_DISPATCH)
+[[gnu::target("avx2")]] std::size_t count_high_bytes_avx2(
+    const unsigned char *src, std::size_t size)
+{
+    return count_high_bytes<Avx2Blocks>(src, size);
+}
+
+[[gnu::target("avx2")]] void convert_avx2(
+    const unsigned char *src, std::size_t size, unsigned char *dst)
+{
+    convert<Avx2Blocks>(src, size, dst);
+}
+
+[[gnu::target("avx2")]] unsigned char *remove_unsynchronization_avx2(
+    unsigned char *data, std::size_t size)
+{
+    return remove_unsynchronization<Avx2Blocks>(data, size);
+}
+
+bool has_avx2()
+{
+    // may run during static initialization, before the CPU model is set up
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+}
+#endif
+
+std::size_t count_high_bytes(const unsigned char *src, std::size_t size)
+{
+#if defined(AUDIOTAG_AVX2_DISPATCH)
+    if(has_avx2())
+    {
+        return count_high_bytes_avx2(src, size);
+    }
+#endif
+    return count_high_bytes<BaselineBlocks>(src, size);
+}
+
+void convert(const unsigned char *src, std::size_t size, unsigned char *dst)
+{
+#if defined(AUDIOTAG_AVX2_DISPATCH)
+    if(has_avx2())
+    {
+        convert_avx2(src, size, dst);
+        return;
+    }
+#endif
+    convert<BaselineBlocks>(src, size, dst);
+}
+
+unsigned char *remove_unsynchronization(unsigned char *data, std::size_t size)
+{
+#if defined(AUDIOTAG_AVX2_DISPATCH)
+    if(has_avx2())
+    {
+        return remove_unsynchronization_avx2(data, size);
+    }
+#endif
+    return remove_unsynchronization<BaselineBlocks>(data, size);
+}
+
+template <std::endian endianness> char16_t load_unit(const unsigned char *src)
+{
+    if constexpr(endianness == std::endian::big)
+    {
+        return static_cast<char16_t>(src[0] << 8 | src[1]);
+    }
+    else
+    {
+        return static_cast<char16_t>(src[1] << 8 | src[0]);
+    }
+}
+
+#if defined(__SSE2__)
+constexpr std::size_t utf16_block_units{ 16 };
+
+// Narrows a block of UTF-16 units to bytes when every unit is ASCII
+template <std::endian endianness>
+bool utf16_ascii_block(const unsigned char *src, unsigned char *dst)
+{
+    auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+
+    if constexpr(endianness == std::endian::big)
+    {
+        first = _mm_or_si128(_mm_slli_epi16(first, 8), _mm_srli_epi16(first, 8));
+        second = _mm_or_si128(_mm_slli_epi16(second, 8), _mm_srli_epi16(second, 8));
+    }
+
+    const auto non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const auto any_non_ascii =
+        _mm_or_si128(_mm_and_si128(first, non_ascii), _mm_and_si128(second, non_ascii));
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(any_non_ascii, _mm_setzero_si128())) != 0xFFFF)
+    {
+        return false;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(first, second));
+    return true;
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+constexpr std::size_t utf16_block_units{ 8 };
+
+// Narrows a block of UTF-16 units to bytes when every unit is ASCII
+template <std::endian endianness>
+bool utf16_ascii_block(const unsigned char *src, unsigned char *dst)
+{
+    auto bytes = vld1q_u8(src);
+    if constexpr(endianness == std::endian::big)
+    {
+        bytes = vrev16q_u8(bytes);
+    }
+
+    const auto units = vreinterpretq_u16_u8(bytes);
+    if(vmaxvq_u16(units) >= 0x80)
+    {
+        return false;
+    }
+
+    vst1_u8(dst, vmovn_u16(units));
+    return true;
+}
+#else
+#define AUDIOTAG_SCALAR_UTF16
+#endif
+
+template <std::endian endianness>
+unsigned char *utf16_to_utf8(const unsigned char *src, std::size_t units, unsigned char *dst)
+{
+    std::size_t i{ 0 };
+    std::size_t scalar_end{ 0 };
+
+    while(i < units)
+    {
+#ifndef AUDIOTAG_SCALAR_UTF16
+        // once past the previous non-ASCII block try the vector path again
+        if(i >= scalar_end && i + utf16_block_units <= units)
+        {
+            if(utf16_ascii_block<endianness>(src + 2 * i, dst))
+            {
+                i += utf16_block_units;
+                dst += utf16_block_units;
+                continue;
+            }
+
+            scalar_end = i + utf16_block_units;
+        }
+#endif
+
+        const char32_t unit = load_unit<endianness>(src + 2 * i);
+        ++i;
+
+        if(unit < 0x80)
+        {
+            *dst++ = static_cast<unsigned char>(unit);
+        }
+        else if(unit < 0x800)
+        {
+            *dst++ = 0xC0 | unit >> 6;
+            *dst++ = 0x80 | (unit & 0x3F);
+        }
+        else if(unit >= 0xD800 && unit < 0xE000)
+        {
+            const char32_t low = i < units ? load_unit<endianness>(src + 2 * i) : 0;
+            if(unit < 0xDC00 && low >= 0xDC00 && low < 0xE000)
+            {
+                ++i;
+                const char32_t code_point = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                *dst++ = 0xF0 | code_point >> 18;
+                *dst++ = 0x80 | (code_point >> 12 & 0x3F);
+                *dst++ = 0x80 | (code_point >> 6 & 0x3F);
+                *dst++ = 0x80 | (code_point & 0x3F);
+            }
+            else
+            {
+                // unpaired surrogate, emit U+FFFD instead of failing the whole string
+                *dst++ = 0xEF;
+                *dst++ = 0xBF;
+                *dst++ = 0xBD;
+            }
+        }
+        else
+        {
+            *dst++ = 0xE0 | unit >> 12;
+            *dst++ = 0x80 | (unit >> 6 & 0x3F);
+            *dst++ = 0x80 | (unit & 0x3F);
+        }
+    }
+
+    return dst;
+}
+} // namespace
+
+bool is_ascii(const std::span<const std::byte> data)
+{
+    return count_high_bytes(reinterpret_cast<const unsigned char *>(data.data()), data.size()) == 0;
+}
+
+std::string from_latin1_to_utf8(const std::span<const std::byte> data)
+{
+    std::string out;
+    append_latin1_as_utf8(data, out);
     return out;
 }
 
+void append_latin1_as_utf8(const std::span<const std::byte> data, std::string &out)
+{
+    const auto *src = reinterpret_cast<const unsigned char *>(data.data());
+
+    // pure ASCII, the common case for tag text, is a single copy
+    const auto high_bytes = count_high_bytes(src, data.size());
+    if(high_bytes == 0)
+    {
+        out.append(reinterpret_cast<const char *>(src), data.size());
+        return;
+    }
+
+    const auto offset = out.size();
+    out.resize(offset + data.size() + high_bytes);
+    convert(src, data.size(), reinterpret_cast<unsigned char *>(out.data() + offset));
+}
+
+std::size_t remove_unsynchronization(const std::span<std::byte> data)
+{
+    auto *bytes = reinterpret_cast<unsigned char *>(data.data());
+    return remove_unsynchronization(bytes, data.size()) - bytes;
+}
+
+std::optional<std::endian> detect_bom(const std::span<const std::byte> data)
+{
+    if(data.size() < 2)
+    {
+        return std::nullopt;
+    }
+
+    if(data[0] == std::byte{ 0xFF } && data[1] == std::byte{ 0xFE })
+    {
+        return std::endian::little;
+    }
+    else if(data[0] == std::byte{ 0xFE } && data[1] == std::byte{ 0xFF })
+    {
+        return std::endian::big;
+    }
+
+    return std::nullopt;
+}
+
+std::size_t from_utf16_to_utf8(
+    const std::span<const std::byte> data, std::endian endianness, const std::span<char> out)
+{
+    const auto units = data.size() / 2;
+    if(out.size() < utf8_max_size_of_utf16(data.size()))
+    {
+        return 0;
+    }
+
+    const auto *src = reinterpret_cast<const unsigned char *>(data.data());
+    auto *dst = reinterpret_cast<unsigned char *>(out.data());
+
+    if(endianness == std::endian::big)
+    {
+        return utf16_to_utf8<std::endian::big>(src, units, dst) - dst;
+    }
+
+    return utf16_to_utf8<std::endian::little>(src, units, dst) - dst;
+}
+
+void append_utf16_as_utf8(
+    const std::span<const std::byte> data, std::endian endianness, std::string &out)
+{
+    const auto offset = out.size();
+    out.resize(offset + utf8_max_size_of_utf16(data.size()));
+
+    const auto written = from_utf16_to_utf8(data, endianness, std::span(out).subspan(offset));
+    out.resize(offset + written);
+}
+
+std::string from_utf16_to_utf8(const std::span<const std::byte> data, std::endian endianness)
+{
+    std::string out;
+    append_utf16_as_utf8(data, endianness, out);
+    return out;
+}
+
+std::string from_utf16_bom_to_utf8(const std::span<const std::byte> data)
+{
+    // strings without a BOM are taken as little endian, the common writer default
+    if(const auto endianness = detect_bom(data))
+    {
+        return from_utf16_to_utf8(data.subspan(2), *endianness);
+    }
+
+    return from_utf16_to_utf8(data, std::endian::little);
+}
+
 std::endian from_bom_to_endian(std::byte bom_0, std::byte bom_1)
 {
     if(bom_0 == std::byte{ 0xFF } && bom_1 == std::byte{ 0xFE })
@@ -0,0 +1,544 @@
+#include "audiotag/columnar.hpp"
+
+#include "audiotag/mmap_reader.hpp"
+#include "audiotag/track_metadata.hpp"
+#include "file_format.hpp"
+#include "file_io.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+constexpr char ColumnarMagic[8] = { 'A', 'T', 'C', 'O', 'L', 'S', '\0', '\0' };
+constexpr std::uint64_t SectionAlignment{ 8 };
+
+constexpr Tag ExportTags[] = {
+    Tag::TITLE,
+    Tag::ARIST,
+    Tag::ALBUM,
+    Tag::GENRE,
+    Tag::TRACKNUMBER,
+    Tag::DISCNUMBER,
+    Tag::YEAR,
+};
+
+std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+}
+
+ColumnEncoding encoding_of(Column column)
+{
+    switch(column)
+    {
+    case Column::Path:
+    case Column::Title:
+        return ColumnEncoding::Blob;
+    case Column::Artist:
+    case Column::Album:
+    case Column::Genre:
+        return ColumnEncoding::Dictionary;
+    case Column::Track:
+    case Column::Disc:
+    case Column::Year:
+    case Column::DurationMs:
+        break;
+    }
+    return ColumnEncoding::Fixed32;
+}
+
+class BlobColumn
+{
+public:
+    std::size_t size() const
+    {
+        return offsets.size() - 1;
+    }
+
+    void add(std::string_view value)
+    {
+        if(bytes.size() + value.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("Column exceeds 4 GiB");
+        }
+
+        bytes.append(value);
+        offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+    }
+
+    // Rows added without a value hold empty strings
+    void fill(std::size_t rows)
+    {
+        offsets.resize(rows + 1, offsets.back());
+    }
+
+    // Drops the values past the first `rows`
+    void truncate(std::size_t rows)
+    {
+        offsets.resize(std::min(offsets.size(), rows + 1));
+        bytes.resize(offsets.back());
+    }
+
+    std::span<const std::uint32_t> offset_section() const
+    {
+        return offsets;
+    }
+
+    std::string_view byte_section() const
+    {
+        return bytes;
+    }
+
+private:
+    std::vector<std::uint32_t> offsets{ 0 };
+    std::string bytes;
+};
+
+class DictionaryColumn
+{
+public:
+    DictionaryColumn()
+    {
+        values.add("");
+    }
+
+    std::size_t size() const
+    {
+        return codes.size();
+    }
+
+    void add(std::string_view value)
+    {
+        if(value.empty())
+        {
+            codes.push_back(0);
+            return;
+        }
+
+        // repeated values, the common case, are looked up without allocating
+        auto it = index.find(value);
+        if(it == index.end())
+        {
+            values.add(value);
+            it = index.emplace(value, static_cast<std::uint32_t>(values.size() - 1)).first;
+        }
+        codes.push_back(it->second);
+    }
+
+    void fill(std::size_t rows)
+    {
+        codes.resize(rows, 0);
+    }
+
+    // Values the dropped rows added stay in the dictionary for later rows
+    void truncate(std::size_t rows)
+    {
+        codes.resize(std::min(codes.size(), rows));
+    }
+
+    std::span<const std::uint32_t> code_section() const
+    {
+        return codes;
+    }
+
+    const BlobColumn &dictionary() const
+    {
+        return values;
+    }
+
+private:
+    std::vector<std::uint32_t> codes;
+    BlobColumn values;
+    std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>> index;
+};
+} // namespace
+
+StringColumn::StringColumn(ColumnEncoding encoding,
+    std::size_t rows,
+    std::span<const std::uint32_t> codes,
+    std::span<const std::uint32_t> offsets,
+    std::string_view bytes)
+: dictionary{ encoding == ColumnEncoding::Dictionary }
+, rows{ rows }
+, row_codes{ codes }
+, offsets{ offsets }
+, bytes{ bytes }
+{
+}
+
+std::size_t StringColumn::size() const
+{
+    return rows;
+}
+
+std::string_view StringColumn::operator[](std::size_t row) const
+{
+    return is_dictionary() ? dictionary_value(row_codes[row]) : value(row);
+}
+
+bool StringColumn::is_dictionary() const
+{
+    return dictionary;
+}
+
+std::span<const std::uint32_t> StringColumn::codes() const
+{
+    return row_codes;
+}
+
+std::size_t StringColumn::dictionary_size() const
+{
+    return is_dictionary() ? offsets.size() - 1 : 0;
+}
+
+std::string_view StringColumn::dictionary_value(std::uint32_t code) const
+{
+    return value(code);
+}
+
+std::string_view StringColumn::value(std::size_t index) const
+{
+    // a damaged export is only noticed here, out of range offsets give an empty value
+    if(index + 1 >= offsets.size() || offsets[index] > offsets[index + 1] ||
+        offsets[index + 1] > bytes.size())
+    {
+        return {};
+    }
+
+    return bytes.substr(offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+struct ColumnarReader::Impl
+{
+    MmapReader file;
+    std::span<const std::byte> data;
+    std::uint64_t row_count{ 0 };
+    std::array<ColumnDescriptor, ColumnCount> descriptors{};
+
+    explicit Impl(std::string_view path)
+    : file{ path }
+    , data{ file.view(0, file.length()) }
+    {
+        const auto header = read_file_header<ColumnarHeader>(
+            data, ColumnarMagic, ColumnarVersion, "columnar export");
+        if(header.column_count != ColumnCount)
+        {
+            throw std::runtime_error("Unsupported columnar export version");
+        }
+
+        if(header.descriptors_offset > data.size() ||
+            data.size() - header.descriptors_offset < sizeof(descriptors))
+        {
+            throw std::runtime_error("Corrupted columnar export");
+        }
+        std::memcpy(descriptors.data(), data.data() + header.descriptors_offset,
+            sizeof(descriptors));
+
+        row_count = header.row_count;
+        for(std::size_t i = 0; i < descriptors.size(); ++i)
+        {
+            if(!valid(descriptors[i], static_cast<Column>(i)))
+            {
+                throw std::runtime_error("Corrupted columnar export");
+            }
+        }
+    }
+
+    bool valid(const ColumnDescriptor &descriptor, Column column) const
+    {
+        const auto in_bounds = [this](const ColumnSection &section) {
+            return section.offset % SectionAlignment == 0 && section.offset <= data.size() &&
+                   section.size <= data.size() - section.offset;
+        };
+
+        if(descriptor.column != column || descriptor.encoding != encoding_of(column) ||
+            !in_bounds(descriptor.values) || !in_bounds(descriptor.offsets) ||
+            !in_bounds(descriptor.bytes) || row_count > data.size() / sizeof(std::uint32_t))
+        {
+            return false;
+        }
+
+        const auto row_values = row_count * sizeof(std::uint32_t);
+        switch(descriptor.encoding)
+        {
+        case ColumnEncoding::Fixed32:
+            return descriptor.values.size == row_values;
+        case ColumnEncoding::Blob:
+            return descriptor.offsets.size == row_values + sizeof(std::uint32_t);
+        case ColumnEncoding::Dictionary:
+            return descriptor.values.size == row_values &&
+                   descriptor.offsets.size >= 2 * sizeof(std::uint32_t) &&
+                   descriptor.offsets.size % sizeof(std::uint32_t) == 0;
+        }
+        return false;
+    }
+
+    std::span<const std::uint32_t> numbers(const ColumnSection &section) const
+    {
+        // the mapping is page aligned and sections 8 byte aligned, so the
+        // arrays can be used in place
+        return std::span(reinterpret_cast<const std::uint32_t *>(data.data() + section.offset),
+            section.size / sizeof(std::uint32_t));
+    }
+
+    std::string_view bytes(const ColumnSection &section) const
+    {
+        return std::string_view(
+            reinterpret_cast<const char *>(data.data() + section.offset), section.size);
+    }
+};
+
+ColumnarReader::ColumnarReader(std::string_view path)
+: impl(std::make_unique<Impl>(path))
+{
+}
+
+ColumnarReader::~ColumnarReader() = default;
+ColumnarReader::ColumnarReader(ColumnarReader &&other) noexcept = default;
+ColumnarReader &ColumnarReader::operator=(ColumnarReader &&other) noexcept = default;
+
+std::size_t ColumnarReader::row_count() const
+{
+    return impl->row_count;
+}
+
+std::span<const std::uint32_t> ColumnarReader::numbers(Column column) const
+{
+    const auto &descriptor = impl->descriptors[static_cast<std::size_t>(column)];
+    if(descriptor.encoding != ColumnEncoding::Fixed32)
+    {
+        throw std::invalid_argument("Not a number column");
+    }
+
+    return impl->numbers(descriptor.values);
+}
+
+StringColumn ColumnarReader::strings(Column column) const
+{
+    const auto &descriptor = impl->descriptors[static_cast<std::size_t>(column)];
+    if(descriptor.encoding == ColumnEncoding::Fixed32)
+    {
+        throw std::invalid_argument("Not a string column");
+    }
+
+    return StringColumn{ descriptor.encoding, impl->row_count, impl->numbers(descriptor.values),
+        impl->numbers(descriptor.offsets), impl->bytes(descriptor.bytes) };
+}
+
+struct ColumnarWriter::Impl
+{
+    std::size_t rows{ 0 };
+    BlobColumn path;
+    BlobColumn title;
+    DictionaryColumn artist;
+    DictionaryColumn album;
+    DictionaryColumn genre;
+    std::vector<std::uint32_t> track;
+    std::vector<std::uint32_t> disc;
+    std::vector<std::uint32_t> year;
+    std::vector<std::uint32_t> duration_ms;
+
+    // Pads the string columns a row left out and counts the row
+    void finish_row()
+    {
+        ++rows;
+        title.fill(rows);
+        artist.fill(rows);
+        album.fill(rows);
+        genre.fill(rows);
+    }
+
+    // Drops what a row that threw partway added, so all columns keep one
+    // value per counted row
+    void discard_row()
+    {
+        path.truncate(rows);
+        title.truncate(rows);
+        artist.truncate(rows);
+        album.truncate(rows);
+        genre.truncate(rows);
+        for(auto *numbers : { &track, &disc, &year, &duration_ms })
+        {
+            numbers->resize(std::min(numbers->size(), rows));
+        }
+    }
+};
+
+ColumnarWriter::ColumnarWriter()
+: impl(std::make_unique<Impl>())
+{
+}
+
+ColumnarWriter::~ColumnarWriter() = default;
+ColumnarWriter::ColumnarWriter(ColumnarWriter &&other) noexcept = default;
+ColumnarWriter &ColumnarWriter::operator=(ColumnarWriter &&other) noexcept = default;
+
+void ColumnarWriter::add(std::string_view path, const MpegFile &file)
+{
+    auto &columns = *impl;
+    try
+    {
+        columns.path.add(path);
+        columns.track.push_back(0);
+        columns.disc.push_back(0);
+        columns.year.push_back(0);
+
+        visit_track_values(file, ExportTags, [&columns](Tag tag, std::string_view value) {
+            switch(tag)
+            {
+            case Tag::TITLE:
+                columns.title.add(value);
+                break;
+            case Tag::ARIST:
+                columns.artist.add(value);
+                break;
+            case Tag::ALBUM:
+                columns.album.add(value);
+                break;
+            case Tag::GENRE:
+                columns.genre.add(value);
+                break;
+            case Tag::TRACKNUMBER:
+                columns.track.back() = parse_number(value);
+                break;
+            case Tag::DISCNUMBER:
+                columns.disc.back() = parse_number(value);
+                break;
+            case Tag::YEAR:
+                columns.year.back() = parse_number(value);
+                break;
+            }
+        });
+
+        const auto &properties = file.audio_properties();
+        columns.duration_ms.push_back(
+            properties ? static_cast<std::uint32_t>(properties->duration.count()) : 0);
+    }
+    catch(...)
+    {
+        columns.discard_row();
+        throw;
+    }
+
+    columns.finish_row();
+}
+
+void ColumnarWriter::add(std::string_view path, const MetadataCache::Entry &entry)
+{
+    auto &columns = *impl;
+    try
+    {
+        columns.path.add(path);
+        columns.title.add(entry.title());
+        columns.artist.add(entry.artist());
+        columns.album.add(entry.album());
+        columns.genre.add(entry.genre());
+        columns.track.push_back(entry.track());
+        columns.disc.push_back(entry.disc());
+        columns.year.push_back(entry.year());
+        columns.duration_ms.push_back(entry.duration_ms());
+    }
+    catch(...)
+    {
+        columns.discard_row();
+        throw;
+    }
+
+    columns.finish_row();
+}
+
+std::size_t ColumnarWriter::size() const
+{
+    return impl->rows;
+}
+
+void ColumnarWriter::write(std::string_view path) const
+{
+    const auto &columns = *impl;
+
+    auto header = make_file_header<ColumnarHeader>(ColumnarMagic, ColumnarVersion);
+    header.row_count = columns.rows;
+    header.column_count = ColumnCount;
+    header.descriptors_offset = sizeof(ColumnarHeader);
+
+    std::array<ColumnDescriptor, ColumnCount> descriptors{};
+    std::vector<std::pair<std::uint64_t, std::span<const std::byte>>> sections;
+    auto end = align(header.descriptors_offset + sizeof(descriptors));
+
+    const auto place = [&](std::span<const std::byte> data) {
+        const ColumnSection section{ .offset = end, .size = data.size() };
+        sections.emplace_back(end, data);
+        end = align(end + data.size());
+        return section;
+    };
+    const auto place_blob = [&](ColumnDescriptor &descriptor, const BlobColumn &blob) {
+        descriptor.offsets = place(std::as_bytes(blob.offset_section()));
+        descriptor.bytes = place(std::as_bytes(std::span(blob.byte_section())));
+    };
+    const auto place_dictionary = [&](ColumnDescriptor &descriptor,
+                                      const DictionaryColumn &dictionary) {
+        descriptor.values = place(std::as_bytes(dictionary.code_section()));
+        place_blob(descriptor, dictionary.dictionary());
+    };
+
+    for(std::size_t i = 0; i < ColumnCount; ++i)
+    {
+        auto &descriptor = descriptors[i];
+        descriptor.column = static_cast<Column>(i);
+        descriptor.encoding = encoding_of(descriptor.column);
+
+        switch(descriptor.column)
+        {
+        case Column::Path:
+            place_blob(descriptor, columns.path);
+            break;
+        case Column::Title:
+            place_blob(descriptor, columns.title);
+            break;
+        case Column::Artist:
+            place_dictionary(descriptor, columns.artist);
+            break;
+        case Column::Album:
+            place_dictionary(descriptor, columns.album);
+            break;
+        case Column::Genre:
+            place_dictionary(descriptor, columns.genre);
+            break;
+        case Column::Track:
+            descriptor.values = place(std::as_bytes(std::span(columns.track)));
+            break;
+        case Column::Disc:
+            descriptor.values = place(std::as_bytes(std::span(columns.disc)));
+            break;
+        case Column::Year:
+            descriptor.values = place(std::as_bytes(std::span(columns.year)));
+            break;
+        case Column::DurationMs:
+            descriptor.values = place(std::as_bytes(std::span(columns.duration_ms)));
+            break;
+        }
+    }
+
+    replace_file(path, 0644, [&](int file) {
+        write_fully(file, std::as_bytes(std::span(&header, 1)), 0);
+        write_fully(file, std::as_bytes(std::span(descriptors)),
+            static_cast<off_t>(header.descriptors_offset));
+        for(const auto &[offset, data] : sections)
+        {
+            write_fully(file, data, static_cast<off_t>(offset));
+        }
+    });
+}
+} // namespace audiotag
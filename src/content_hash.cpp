@@ -0,0 +1,293 @@
+#include <audiotag/byte_swap.hpp>
+#include <audiotag/content_hash.hpp>
+#include <audiotag/reader.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+constexpr std::uint64_t prime_1{ 0x9E3779B185EBCA87 };
+constexpr std::uint64_t prime_2{ 0xC2B2AE3D27D4EB4F };
+constexpr std::uint64_t prime_3{ 0x165667B19E3779F9 };
+constexpr std::uint64_t prime_4{ 0x85EBCA77C2B2AE63 };
+constexpr std::uint64_t prime_5{ 0x27D4EB2F165667C5 };
+
+constexpr std::size_t read_alignment{ 4096 };
+
+template <typename T> T load_le(const std::byte *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+
+    if constexpr(std::endian::native == std::endian::big)
+    {
+        value = byteswap(value);
+    }
+    return value;
+}
+
+std::uint64_t round(std::uint64_t accumulator, std::uint64_t input)
+{
+    accumulator += input * prime_2;
+    accumulator = std::rotl(accumulator, 31);
+    return accumulator * prime_1;
+}
+
+std::uint64_t merge_round(std::uint64_t hash, std::uint64_t accumulator)
+{
+    hash ^= round(0, accumulator);
+    return hash * prime_1 + prime_4;
+}
+
+void consume_stripes(
+    std::array<std::uint64_t, 4> &accumulators, const std::byte *data, std::size_t count)
+{
+    for(std::size_t i = 0; i < count; ++i, data += 32)
+    {
+        accumulators[0] = round(accumulators[0], load_le<std::uint64_t>(data));
+        accumulators[1] = round(accumulators[1], load_le<std::uint64_t>(data + 8));
+        accumulators[2] = round(accumulators[2], load_le<std::uint64_t>(data + 16));
+        accumulators[3] = round(accumulators[3], load_le<std::uint64_t>(data + 24));
+    }
+}
+
+struct AlignedDelete
+{
+    void operator()(std::byte *data) const
+    {
+        ::operator delete[](data, std::align_val_t{ read_alignment });
+    }
+};
+
+using AlignedBuffer = std::unique_ptr<std::byte[], AlignedDelete>;
+
+AlignedBuffer make_read_buffer(std::size_t size)
+{
+    return AlignedBuffer{ static_cast<std::byte *>(
+        ::operator new[](size, std::align_val_t{ read_alignment })) };
+}
+
+std::uint64_t hash_chunk(const Reader &reader,
+    ReadPlanner::Range range,
+    const HashOptions &options,
+    std::span<std::byte> buffer)
+{
+    if(const auto view = reader.view(range.offset, range.length); view.size() == range.length)
+    {
+        return Xxh64::hash(view, options.seed);
+    }
+
+    Xxh64 state{ options.seed };
+
+    auto offset = range.offset;
+    const auto end = range.offset + range.length;
+    while(offset < end)
+    {
+        // after the first read every read starts on a read size boundary
+        const auto boundary = (offset / buffer.size() + 1) * buffer.size();
+        const auto size = std::min(boundary, end) - offset;
+
+        const auto read = reader.read_at(offset, buffer.first(size));
+        if(read == 0)
+        {
+            throw std::runtime_error("Unexpected end of file while hashing");
+        }
+
+        state.update(buffer.first(read));
+        offset += read;
+    }
+
+    return state.digest();
+}
+} // namespace
+
+Xxh64::Xxh64(std::uint64_t seed)
+: accumulators{ seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1 }
+, seed{ seed }
+{
+}
+
+void Xxh64::update(std::span<const std::byte> data)
+{
+    total_length += data.size();
+
+    // top up a partial stripe left by the previous update first
+    if(stripe_size != 0)
+    {
+        const auto fill = std::min(data.size(), stripe.size() - stripe_size);
+        std::memcpy(stripe.data() + stripe_size, data.data(), fill);
+        stripe_size += fill;
+        data = data.subspan(fill);
+
+        if(stripe_size < stripe.size())
+        {
+            return;
+        }
+
+        consume_stripes(accumulators, stripe.data(), 1);
+        stripe_size = 0;
+    }
+
+    const auto stripes = data.size() / 32;
+    consume_stripes(accumulators, data.data(), stripes);
+
+    const auto rest = data.subspan(stripes * 32);
+    std::memcpy(stripe.data(), rest.data(), rest.size());
+    stripe_size = rest.size();
+}
+
+std::uint64_t Xxh64::digest() const
+{
+    std::uint64_t hash;
+    if(total_length >= 32)
+    {
+        hash = std::rotl(accumulators[0], 1) + std::rotl(accumulators[1], 7) +
+               std::rotl(accumulators[2], 12) + std::rotl(accumulators[3], 18);
+        for(const auto accumulator : accumulators)
+        {
+            hash = merge_round(hash, accumulator);
+        }
+    }
+    else
+    {
+        hash = seed + prime_5;
+    }
+
+    hash += total_length;
+
+    const auto *data = stripe.data();
+    auto remaining = stripe_size;
+
+    for(; remaining >= 8; remaining -= 8, data += 8)
+    {
+        hash ^= round(0, load_le<std::uint64_t>(data));
+        hash = std::rotl(hash, 27) * prime_1 + prime_4;
+    }
+
+    if(remaining >= 4)
+    {
+        hash ^= load_le<std::uint32_t>(data) * prime_1;
+        hash = std::rotl(hash, 23) * prime_2 + prime_3;
+        remaining -= 4;
+        data += 4;
+    }
+
+    for(; remaining > 0; --remaining, ++data)
+    {
+        hash ^= std::to_integer<std::uint64_t>(*data) * prime_5;
+        hash = std::rotl(hash, 11) * prime_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime_2;
+    hash ^= hash >> 29;
+    hash *= prime_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+std::uint64_t Xxh64::hash(std::span<const std::byte> data, std::uint64_t seed)
+{
+    Xxh64 state{ seed };
+    state.update(data);
+    return state.digest();
+}
+
+std::uint64_t hash_range(
+    const Reader &reader, ReadPlanner::Range range, const HashOptions &options)
+{
+    const auto read_size = std::max(
+        (options.read_size + read_alignment - 1) / read_alignment * read_alignment, read_alignment);
+
+    if(range.length <= HashChunkSize)
+    {
+        // small ranges do not need a full read size buffer, only an aligned one
+        const auto buffer_size = std::min(read_size,
+            std::max((range.length + read_alignment - 1) / read_alignment * read_alignment,
+                read_alignment));
+        const auto buffer = make_read_buffer(buffer_size);
+        return hash_chunk(reader, range, options, { buffer.get(), buffer_size });
+    }
+
+    const auto chunk_count = (range.length + HashChunkSize - 1) / HashChunkSize;
+    std::vector<std::uint64_t> digests(chunk_count);
+
+    std::atomic<std::size_t> next_chunk{ 0 };
+    std::mutex failure_mutex;
+    std::exception_ptr failure;
+
+    // nothing may escape a worker thread, the first failure stops every worker
+    // and is rethrown on the calling thread
+    const auto worker = [&] {
+        try
+        {
+            const auto buffer = make_read_buffer(read_size);
+
+            for(auto index = next_chunk++; index < chunk_count; index = next_chunk++)
+            {
+                const auto offset = index * HashChunkSize;
+                const auto length = std::min(HashChunkSize, range.length - offset);
+
+                digests[index] = hash_chunk(reader, { range.offset + offset, length }, options,
+                    { buffer.get(), read_size });
+            }
+        }
+        catch(...)
+        {
+            const std::lock_guard lock{ failure_mutex };
+            failure = failure != nullptr ? failure : std::current_exception();
+            next_chunk = chunk_count;
+        }
+    };
+
+    auto thread_count = options.thread_count;
+    if(thread_count == 0)
+    {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    if(thread_count == 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::jthread> workers;
+        for(unsigned i = 0; i < std::min<std::size_t>(thread_count, chunk_count); ++i)
+        {
+            workers.emplace_back(worker);
+        }
+    }
+
+    if(failure != nullptr)
+    {
+        std::rethrow_exception(failure);
+    }
+
+    // digests are combined in chunk order as little endian bytes
+    Xxh64 combined{ options.seed };
+    for(auto digest : digests)
+    {
+        if constexpr(std::endian::native == std::endian::big)
+        {
+            digest = byteswap(digest);
+        }
+        combined.update(std::as_bytes(std::span(&digest, 1)));
+    }
+
+    return combined.digest();
+}
+} // namespace audiotag
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "audiotag/metadata_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Pieces shared by the mapped file formats: the metadata cache, the columnar
+// export and the search index
+namespace audiotag
+{
+// Stored in the byte_order field of every header. The files are used straight
+// from the mapping in host byte order, so a reader seeing any other value was
+// handed a file written by a host of the other endianness and rejects it.
+constexpr std::uint32_t ByteOrderMark{ 0x01020304 };
+
+// Header with the given magic and version for a file written by this host
+template <typename Header> Header make_file_header(const char (&magic)[8], std::uint32_t version)
+{
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = ByteOrderMark;
+    return header;
+}
+
+// Header at the start of `data`, copied out of the mapping. Throws
+// std::runtime_error naming `format` when the magic or byte order do not match,
+// or when the file is of another version.
+template <typename Header>
+Header read_file_header(std::span<const std::byte> data,
+    const char (&magic)[8],
+    std::uint32_t version,
+    std::string_view format)
+{
+    Header header{};
+    if(data.size() < sizeof(header))
+    {
+        throw std::runtime_error("Not a " + std::string(format));
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if(std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.byte_order != ByteOrderMark)
+    {
+        throw std::runtime_error("Not a " + std::string(format));
+    }
+
+    if(header.version != version)
+    {
+        throw std::runtime_error("Unsupported " + std::string(format) + " version");
+    }
+
+    return header;
+}
+
+// Transparent hash so maps keyed by std::string are looked up with a
+// std::string_view without allocating
+struct StringHash
+{
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view value) const
+    {
+        return std::hash<std::string_view>{}(value);
+    }
+};
+
+// Order of the records of a cache file
+inline bool key_less(const FileKey &a, const FileKey &b)
+{
+    return a.device != b.device ? a.device < b.device : a.inode < b.inode;
+}
+} // namespace audiotag
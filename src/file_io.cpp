@@ -0,0 +1,331 @@
+#include "file_io.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+constexpr std::size_t CopyBufferSize{ 1024 * 1024 };
+
+[[noreturn]] void throw_errno(const char *what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+} // namespace
+
+FileDescriptor::FileDescriptor(int file_descriptor)
+: file_descriptor{ file_descriptor }
+{
+}
+
+FileDescriptor::~FileDescriptor()
+{
+    if(file_descriptor >= 0)
+    {
+        close(file_descriptor);
+    }
+}
+
+FileDescriptor::FileDescriptor(FileDescriptor &&other) noexcept
+: file_descriptor{ other.release() }
+{
+}
+
+FileDescriptor &FileDescriptor::operator=(FileDescriptor &&other) noexcept
+{
+    if(this != &other)
+    {
+        if(file_descriptor >= 0)
+        {
+            close(file_descriptor);
+        }
+        file_descriptor = other.release();
+    }
+    return *this;
+}
+
+int FileDescriptor::get() const
+{
+    return file_descriptor;
+}
+
+int FileDescriptor::release()
+{
+    return std::exchange(file_descriptor, -1);
+}
+
+DescriptorReader::DescriptorReader(
+    int file_descriptor, std::size_t file_size, std::size_t block_size)
+: file_descriptor{ file_descriptor }
+, file_size{ file_size }
+, block_size{ block_size }
+{
+}
+
+std::size_t DescriptorReader::length() const
+{
+    return file_size;
+}
+
+std::size_t DescriptorReader::buffer_size() const
+{
+    return block_size;
+}
+
+std::size_t DescriptorReader::read(std::span<std::byte> buffer)
+{
+    const auto bytes_read = read_at(cursor, buffer);
+    cursor += bytes_read;
+    return bytes_read;
+}
+
+bool DescriptorReader::seek(long offset)
+{
+    cursor = offset;
+    return offset >= 0;
+}
+
+std::size_t DescriptorReader::read_at(std::size_t offset, std::span<std::byte> buffer) const
+{
+    return read_fully(file_descriptor, buffer, static_cast<off_t>(offset));
+}
+
+std::error_code current_parse_error()
+{
+    try
+    {
+        throw;
+    }
+    catch(const std::system_error &error)
+    {
+        return error.code();
+    }
+    catch(const std::bad_alloc &)
+    {
+        return std::make_error_code(std::errc::not_enough_memory);
+    }
+    catch(...)
+    {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+}
+
+std::size_t read_fully(int file_descriptor, std::span<std::byte> buffer, off_t offset)
+{
+    std::size_t total{ 0 };
+    while(total < buffer.size())
+    {
+        const auto bytes_read = pread(
+            file_descriptor, buffer.data() + total, buffer.size() - total, offset + total);
+
+        if(bytes_read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(bytes_read <= 0)
+        {
+            break;
+        }
+
+        total += bytes_read;
+    }
+
+    return total;
+}
+
+void write_fully(int file_descriptor, std::span<const std::byte> data, off_t offset)
+{
+    while(!data.empty())
+    {
+        const auto written = pwrite(file_descriptor, data.data(), data.size(), offset);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            throw_errno("Couldn't write file");
+        }
+
+        data = data.subspan(static_cast<std::size_t>(written));
+        offset += written;
+    }
+}
+
+void copy_fully(int from, off_t from_offset, int to, off_t to_offset, std::size_t size)
+{
+    while(size > 0)
+    {
+        const auto copied = copy_file_range(from, &from_offset, to, &to_offset, size, 0);
+        if(copied > 0)
+        {
+            size -= static_cast<std::size_t>(copied);
+            continue;
+        }
+        if(copied < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(copied == 0)
+        {
+            throw std::system_error(
+                std::make_error_code(std::errc::io_error), "File shrank while copying");
+        }
+        if(errno != EXDEV && errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL)
+        {
+            throw_errno("Couldn't copy file");
+        }
+        break;
+    }
+
+    // filesystems without copy_file_range support fall back to a buffered copy
+    std::vector<std::byte> buffer(std::min(size, CopyBufferSize));
+    while(size > 0)
+    {
+        const auto bytes_read =
+            read_fully(from, std::span(buffer).first(std::min(size, buffer.size())), from_offset);
+        if(bytes_read == 0)
+        {
+            throw std::system_error(
+                std::make_error_code(std::errc::io_error), "File shrank while copying");
+        }
+
+        write_fully(to, std::span(buffer).first(bytes_read), to_offset);
+        from_offset += bytes_read;
+        to_offset += bytes_read;
+        size -= bytes_read;
+    }
+}
+
+TemporaryFile::TemporaryFile(std::string target)
+: target{ std::move(target) }
+, temporary_path{ this->target }
+{
+    temporary_path.append(TemporarySuffix).append("XXXXXX");
+    file = FileDescriptor{ mkostemp(temporary_path.data(), O_CLOEXEC) };
+    if(file.get() < 0)
+    {
+        throw_errno("Couldn't create temporary file");
+    }
+}
+
+TemporaryFile::~TemporaryFile()
+{
+    if(!temporary_path.empty())
+    {
+        unlink(temporary_path.c_str());
+    }
+}
+
+TemporaryFile::TemporaryFile(TemporaryFile &&other) noexcept
+: target{ std::move(other.target) }
+, temporary_path{ std::exchange(other.temporary_path, {}) }
+, file{ std::move(other.file) }
+{
+}
+
+const std::string &TemporaryFile::path() const
+{
+    return temporary_path;
+}
+
+int TemporaryFile::get() const
+{
+    return file.get();
+}
+
+void TemporaryFile::replace_target()
+{
+    if(fsync(file.get()) != 0 || close(file.release()) != 0)
+    {
+        throw_errno("Couldn't write file");
+    }
+
+    if(rename(temporary_path.c_str(), target.c_str()) != 0)
+    {
+        throw_errno("Couldn't replace file");
+    }
+    temporary_path.clear();
+
+    sync_parent_directory(target);
+}
+
+void sync_parent_directory(const std::string &path)
+{
+    // the root directory keeps its slash
+    const auto slash = path.rfind('/');
+    const auto directory = slash == std::string::npos
+                               ? std::string(".")
+                               : path.substr(0, std::max<std::size_t>(slash, 1));
+
+    const FileDescriptor file{ open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+    if(file.get() < 0 || fsync(file.get()) != 0)
+    {
+        throw_errno("Couldn't sync directory");
+    }
+}
+
+void replace_head(const std::string &path,
+    int file_descriptor,
+    const struct stat &file_stat,
+    std::span<const std::byte> head,
+    std::size_t data_offset)
+{
+    replace_head(TemporaryFile{ path }, file_descriptor, file_stat, head, data_offset);
+}
+
+void replace_head(TemporaryFile &&temporary,
+    int file_descriptor,
+    const struct stat &file_stat,
+    std::span<const std::byte> head,
+    std::size_t data_offset)
+{
+    // only a privileged process may hand the file to another owner, others keep theirs
+    if(fchown(temporary.get(), file_stat.st_uid, file_stat.st_gid) != 0 && errno != EPERM)
+    {
+        throw_errno("Couldn't set file owner");
+    }
+
+    // after fchown, which may clear the set-user-ID and set-group-ID bits
+    if(fchmod(temporary.get(), file_stat.st_mode & 07777) != 0)
+    {
+        throw_errno("Couldn't set file mode");
+    }
+
+    write_fully(temporary.get(), head, 0);
+
+    const auto file_size = static_cast<std::size_t>(file_stat.st_size);
+    if(file_size > data_offset)
+    {
+        copy_fully(file_descriptor, static_cast<off_t>(data_offset), temporary.get(),
+            static_cast<off_t>(head.size()), file_size - data_offset);
+    }
+
+    temporary.replace_target();
+}
+
+void replace_file(std::string_view path,
+    mode_t mode,
+    const std::function<void(int file_descriptor)> &write)
+{
+    TemporaryFile temporary{ std::string(path) };
+
+    if(fchmod(temporary.get(), mode) != 0)
+    {
+        throw_errno("Couldn't set file mode");
+    }
+
+    write(temporary.get());
+    temporary.replace_target();
+}
+} // namespace audiotag
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "audiotag/reader.hpp"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace audiotag
+{
+struct FileKey;
+
+// Owns a file descriptor, closing it on destruction
+class FileDescriptor
+{
+public:
+    explicit FileDescriptor(int file_descriptor = -1);
+    ~FileDescriptor();
+
+    FileDescriptor(FileDescriptor &&other) noexcept;
+    FileDescriptor &operator=(FileDescriptor &&other) noexcept;
+
+    [[nodiscard]] int get() const;
+    [[nodiscard]] int release();
+
+private:
+    int file_descriptor;
+};
+
+// Reader over a descriptor opened by the caller, reads are positional
+class DescriptorReader : public Reader
+{
+public:
+    DescriptorReader(int file_descriptor, std::size_t file_size, std::size_t block_size);
+
+    std::size_t length() const override;
+    std::size_t buffer_size() const override;
+    std::size_t read(std::span<std::byte> buffer) override;
+    bool seek(long offset) override;
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override;
+
+private:
+    int file_descriptor;
+    std::size_t file_size;
+    std::size_t block_size;
+    std::size_t cursor{ 0 };
+};
+
+FileKey to_file_key(const struct stat &file_stat);
+
+// Error reported for a file whose parse threw, so one bad file does not stop a
+// batch or a scan: the code of a std::system_error, not_enough_memory for
+// std::bad_alloc and invalid_argument for anything else. Only call it from
+// a catch block.
+std::error_code current_parse_error();
+
+// Reads until `buffer` is full or the file ends, returns the bytes read
+std::size_t read_fully(int file_descriptor, std::span<std::byte> buffer, off_t offset);
+
+// The functions below throw std::system_error carrying errno
+
+void write_fully(int file_descriptor, std::span<const std::byte> data, off_t offset);
+
+// Copies `size` bytes between descriptors, through copy_file_range (which
+// reflinks on filesystems that share extents) with a buffered fallback
+void copy_fully(int from, off_t from_offset, int to, off_t to_offset, std::size_t size);
+
+// Suffix of the temporary files replace_head writes, followed by six random characters
+constexpr std::string_view TemporarySuffix{ ".audiotag-" };
+
+// File created next to `target`, named after it with TemporarySuffix, that is
+// removed again on destruction unless it replaced `target`
+class TemporaryFile
+{
+public:
+    explicit TemporaryFile(std::string target);
+    ~TemporaryFile();
+
+    TemporaryFile(TemporaryFile &&other) noexcept;
+    TemporaryFile &operator=(TemporaryFile &&other) = delete;
+
+    [[nodiscard]] const std::string &path() const;
+    [[nodiscard]] int get() const;
+
+    // Syncs and closes the file, renames it over the target and syncs the
+    // directory, so the new file is durable under the target's name
+    void replace_target();
+
+private:
+    std::string target;
+    std::string temporary_path;
+    FileDescriptor file;
+};
+
+// Makes renames and unlinks of entries in the directory holding `path` durable
+void sync_parent_directory(const std::string &path);
+
+// Atomically replaces the file at `path`, open as `file_descriptor`, with `head`
+// followed by its contents from `data_offset` on. The new file is written next
+// to it, synced and renamed over it; it keeps the original's mode, and its owner
+// and group when the process may set them. Being a new inode it does not keep
+// extended attributes or ACLs, and other hard links keep the old contents.
+void replace_head(const std::string &path,
+    int file_descriptor,
+    const struct stat &file_stat,
+    std::span<const std::byte> head,
+    std::size_t data_offset);
+
+// As above, writing the new file into `temporary`, which was created for `path`
+void replace_head(TemporaryFile &&temporary,
+    int file_descriptor,
+    const struct stat &file_stat,
+    std::span<const std::byte> head,
+    std::size_t data_offset);
+
+// Atomically replaces the file at `path` with one `write` fills through the
+// descriptor it is given. The new file is written next to it with `mode`,
+// synced and renamed over it; readers of the old file keep their mapping.
+void replace_file(std::string_view path,
+    mode_t mode,
+    const std::function<void(int file_descriptor)> &write);
+} // namespace audiotag
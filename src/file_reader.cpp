@@ -1,24 +1,28 @@
 #include "audiotag/file_reader.hpp"
 
+#include "file_io.hpp"
+
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
-#include <cstdio>
-#include <cstdlib>
 #include <stdexcept>
+#include <string>
 
 namespace audiotag
 {
 struct FileReader::Impl
 {
-    std::FILE *file{ nullptr };
+    int file_descriptor{ -1 };
     std::size_t file_size{ 0 };
     std::size_t buffer_size{ 0 };
+    std::size_t cursor{ 0 };
 
     ~Impl()
     {
-        if(file != nullptr)
+        if(file_descriptor >= 0)
         {
-            std::fclose(file);
+            close(file_descriptor);
         }
     }
 };
@@ -26,16 +30,16 @@ struct FileReader::Impl
 FileReader::FileReader(std::string_view filename)
 : impl(std::make_unique<Impl>())
 {
-    impl->file = std::fopen(filename.data(), "rb");
-    if(impl->file == nullptr)
+    const std::string path{ filename };
+
+    impl->file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(impl->file_descriptor < 0)
     {
         throw std::runtime_error("File not opened");
     }
 
-    auto file_descriptor = fileno(impl->file);
-
     struct stat file_stat = {};
-    if(const auto stat_result = fstat(file_descriptor, &file_stat); stat_result != 0)
+    if(const auto stat_result = fstat(impl->file_descriptor, &file_stat); stat_result != 0)
     {
         throw std::runtime_error("Couldn't read file stat");
     }
@@ -58,11 +62,24 @@ std::size_t FileReader::buffer_size() const
 
 std::size_t FileReader::read(std::span<std::byte> buffer)
 {
-    return std::fread(buffer.data(), sizeof(std::byte), buffer.size(), impl->file);
+    const auto bytes_read = read_at(impl->cursor, buffer);
+    impl->cursor += bytes_read;
+    return bytes_read;
 }
 
 bool FileReader::seek(long offset)
 {
-    return std::fseek(impl->file, offset, SEEK_SET) != 0;
+    if(offset < 0)
+    {
+        return false;
+    }
+
+    impl->cursor = offset;
+    return true;
+}
+
+std::size_t FileReader::read_at(std::size_t offset, std::span<std::byte> buffer) const
+{
+    return read_fully(impl->file_descriptor, buffer, static_cast<off_t>(offset));
 }
 } // namespace audiotag
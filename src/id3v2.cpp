@@ -1,98 +1,517 @@
+#include "id3v2_frames.hpp"
+
 #include <audiotag/byte_conversions.hpp>
 #include <audiotag/byte_swap.hpp>
 #include <audiotag/id3v2.hpp>
 #include <frozen/map.h>
-#include <utf8/cpp17.h>
 
 #include <algorithm>
 #include <bit>
 #include <span>
+#include <stdexcept>
+#include <vector>
+
+#ifdef AUDIOTAG_HAS_ZLIB
+#include <zlib.h>
+#endif
 
 namespace audiotag::ID3v2
 {
-Tags::Tags(Header &&header, std::vector<TagFrame> &&frames)
-: header{ header }
-, frames{ frames }
+static const constinit frozen::map<Tag, FrameId, 7> tag_mapping = {
+    { Tag::TITLE, to_frame_id("TIT2") },
+    { Tag::ARIST, to_frame_id("TPE1") },
+    { Tag::ALBUM, to_frame_id("TALB") },
+    { Tag::TRACKNUMBER, to_frame_id("TRCK") },
+    { Tag::DISCNUMBER, to_frame_id("TPOS") },
+    { Tag::GENRE, to_frame_id("TCON") },
+    { Tag::YEAR, to_frame_id("TDRC") },
+};
+
+// v2.3 tags hold the year in TYER, which v2.4 replaced with TDRC
+constexpr FrameId LegacyYearFrameId{ to_frame_id("TYER") };
+
+FrameId to_frame_id(Tag tag)
 {
+    return tag_mapping.at(tag);
 }
 
-const std::vector<TagFrame> &Tags::getFrames() const
+std::size_t tag_size(std::span<const std::byte> header)
 {
-    return frames;
+    if(header.size() < HeaderSize)
+    {
+        return 0;
+    }
+
+    const auto parsed = parse_header(header.first(HeaderSize), Identifier);
+    return parsed ? tag_extent(*parsed) : 0;
 }
 
-static const constinit frozen::map<Tag, std::array<std::byte, 4>, 5> tag_mapping = {
+#ifdef AUDIOTAG_HAS_ZLIB
+namespace
+{
+// Streaming inflater reused for every compressed frame decoded on a thread
+class Inflater
+{
+public:
+    Inflater()
     {
-        Tag::TITLE,
+        initialized = inflateInit(&stream) == Z_OK;
+    }
+
+    ~Inflater()
+    {
+        if(initialized)
         {
-            std::byte{ 'T' },
-            std::byte{ 'I' },
-            std::byte{ 'T' },
-            std::byte{ '2' },
-        },
-    },
-    {
-        Tag::ARIST,
+            inflateEnd(&stream);
+        }
+    }
+
+    Inflater(const Inflater &) = delete;
+    Inflater &operator=(const Inflater &) = delete;
+
+    // Inflates `data`, empty when the stream is invalid or decodes to more than
+    // `declared_size` bytes, or to more than MaximumOutput when no size is declared
+    std::span<const std::byte> inflate(std::span<const std::byte> data, std::size_t declared_size)
+    {
+        if(!initialized || inflateReset(&stream) != Z_OK)
         {
-            std::byte{ 'T' },
-            std::byte{ 'P' },
-            std::byte{ 'E' },
-            std::byte{ '1' },
-        },
-    },
-    {
-        Tag::ALBUM,
+            return {};
+        }
+
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+
+        const auto limit =
+            declared_size != 0 ? std::min(declared_size, MaximumOutput) : MaximumOutput;
+
+        // the declared size is untrusted, it bounds the output but only hints the first
+        // allocation; one byte past the limit tells a stream that overruns it from one
+        // that fills it exactly
+        const auto expansion = std::max(data.size() * MaximumExpansion, MinimumCapacity);
+        const auto capacity =
+            std::min(std::clamp(declared_size, MinimumCapacity, expansion), limit + 1);
+
+        // buffers grown by an oversized frame are given back rather than kept per thread
+        if(scratch.size() > RetainedCapacity && capacity <= RetainedCapacity)
         {
-            std::byte{ 'T' },
-            std::byte{ 'A' },
-            std::byte{ 'L' },
-            std::byte{ 'B' },
-        },
-    },
-    {
-        Tag::TRACKNUMBER,
+            scratch.clear();
+            scratch.shrink_to_fit();
+        }
+
+        if(scratch.size() < capacity)
         {
-            std::byte{ 'T' },
-            std::byte{ 'R' },
-            std::byte{ 'C' },
-            std::byte{ 'K' },
-        },
-    },
-    {
-        Tag::DISCNUMBER,
+            scratch.resize(capacity);
+        }
+
+        while(true)
         {
-            std::byte{ 'T' },
-            std::byte{ 'P' },
-            std::byte{ 'O' },
-            std::byte{ 'S' },
-        },
-    },
+            stream.next_out = reinterpret_cast<Bytef *>(scratch.data() + stream.total_out);
+            stream.avail_out = static_cast<uInt>(scratch.size() - stream.total_out);
+
+            const auto result = ::inflate(&stream, Z_NO_FLUSH);
+            if(result == Z_STREAM_END)
+            {
+                if(stream.total_out > limit)
+                {
+                    return {};
+                }
+                return std::span(scratch).first(stream.total_out);
+            }
+
+            if(stream.avail_out == 0)
+            {
+                if(stream.total_out > limit)
+                {
+                    return {};
+                }
+                scratch.resize(std::min(scratch.size() * 2, limit + 1));
+                continue;
+            }
+
+            // with room left in the output, running out of input means a truncated stream
+            if((result != Z_OK && result != Z_BUF_ERROR) || stream.avail_in == 0)
+            {
+                return {};
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t MinimumCapacity{ 256 };
+    static constexpr std::size_t MaximumExpansion{ 16 };
+    static constexpr std::size_t RetainedCapacity{ 64 * 1024 };
+    // largest body a tag can declare, no frame of it inflates to more
+    static constexpr std::size_t MaximumOutput{ std::size_t{ 1 } << 28 };
+
+    z_stream stream{};
+    bool initialized{ false };
+    std::vector<std::byte> scratch;
 };
+} // namespace
+#endif
 
-std::string Tags::getStringValue(Tag tag) const
+FrameFlags decode_frame_flags(std::uint8_t version_major, std::uint16_t flags)
 {
-    const auto frame_tag = tag_mapping.at(tag);
-    const auto frameIt = std::find_if(frames.cbegin(), frames.cend(),
-        [&frame_tag](const auto &frame) { return frame.id == frame_tag; });
+    if(version_major < 4)
+    {
+        return FrameFlags{
+            .tag_preservation = (flags & 0x8000) != 0,
+            .file_preservation = (flags & 0x4000) != 0,
+            .read_only = (flags & 0x2000) != 0,
+            .grouping_identity = (flags & 0x0020) != 0,
+            .compression = (flags & 0x0080) != 0,
+            .encryption = (flags & 0x0040) != 0,
+            .unsynchronization = false,
+            .data_length_indicator = false,
+        };
+    }
+
+    return FrameFlags{
+        .tag_preservation = (flags & 0x4000) != 0,
+        .file_preservation = (flags & 0x2000) != 0,
+        .read_only = (flags & 0x1000) != 0,
+        .grouping_identity = (flags & 0x0040) != 0,
+        .compression = (flags & 0x0008) != 0,
+        .encryption = (flags & 0x0004) != 0,
+        .unsynchronization = (flags & 0x0002) != 0,
+        .data_length_indicator = (flags & 0x0001) != 0,
+    };
+}
+
+static std::string decode_text(std::span<const std::byte> data)
+{
+    if(data.empty())
+    {
+        return "";
+    }
 
-    if(frameIt != frames.cend() && !frameIt->data.empty())
+    const auto encoding{ std::to_integer<std::uint8_t>(data[0]) };
+    const auto text = data.subspan(1);
+
+    if(encoding == 0)
+    {
+        return from_latin1_to_utf8(text);
+    }
+    else if(encoding == 1)
     {
-        const auto encoding{ std::to_integer<std::uint8_t>(frameIt->data[0]) };
-        if(encoding == 0)
+        return from_utf16_bom_to_utf8(text);
+    }
+    else if(encoding == 2)
+    {
+        return from_utf16_to_utf8(text, std::endian::big);
+    }
+    else if(encoding == 3)
+    {
+        return std::string(reinterpret_cast<const char *>(text.data()), text.size());
+    }
+
+    return "";
+}
+
+// Text of a frame as UTF-8 without copying when it is stored as UTF-8 or as
+// ASCII Latin-1 and `borrow` is set, otherwise decoded or copied into `buffer`
+static std::string_view decode_text(
+    std::span<const std::byte> data, std::string &buffer, bool borrow)
+{
+    if(data.empty())
+    {
+        return {};
+    }
+
+    const auto encoding{ std::to_integer<std::uint8_t>(data[0]) };
+    const auto text = data.subspan(1);
+
+    if(encoding == 3 || (encoding == 0 && is_ascii(text)))
+    {
+        const std::string_view value{ reinterpret_cast<const char *>(text.data()), text.size() };
+        if(borrow)
         {
-            return from_latin1_to_utf8(std::span<const std::byte>(frameIt->data).subspan(1));
+            return value;
         }
-        else if(encoding == 1)
+
+        buffer.assign(value);
+        return buffer;
+    }
+
+    buffer.clear();
+    if(encoding == 0)
+    {
+        append_latin1_as_utf8(text, buffer);
+    }
+    else if(encoding == 1)
+    {
+        const auto endianness = detect_bom(text);
+        append_utf16_as_utf8(
+            endianness ? text.subspan(2) : text, endianness.value_or(std::endian::little), buffer);
+    }
+    else if(encoding == 2)
+    {
+        append_utf16_as_utf8(text, std::endian::big, buffer);
+    }
+    return buffer;
+}
+
+Tags::Tags(Header &&header, std::vector<TagFrame> &&frames)
+: header{ std::move(header) }
+, frames{ std::move(frames) }
+{
+}
+
+const std::vector<TagFrame> &Tags::getFrames() const
+{
+    return frames;
+}
+
+std::string Tags::getStringValue(Tag tag) const
+{
+    const auto frame_tag = tag_mapping.at(tag);
+    const auto frameIt =
+        std::find_if(frames.cbegin(), frames.cend(), [&frame_tag, tag](const auto &frame) {
+            const auto frame_id = to_frame_id(frame.id);
+            return frame_id == frame_tag || (tag == Tag::YEAR && frame_id == LegacyYearFrameId);
+        });
+
+    if(frameIt != frames.cend())
+    {
+        return decode_text(frameIt->data);
+    }
+
+    return "";
+}
+
+FrameFilter::FrameFilter(std::initializer_list<Tag> tags)
+{
+    for(const auto tag : tags)
+    {
+        add(tag);
+    }
+}
+
+void FrameFilter::add(Tag tag)
+{
+    const auto group = groups_added;
+    if(const auto frame_id = tag_mapping.at(tag); !contains(frame_id))
+    {
+        frame_ids.push_back(frame_id);
+        groups.push_back(group);
+    }
+
+    if(tag == Tag::YEAR && !contains(LegacyYearFrameId))
+    {
+        frame_ids.push_back(LegacyYearFrameId);
+        groups.push_back(group);
+    }
+
+    if(!groups.empty() && groups.back() == group)
+    {
+        ++groups_added;
+    }
+}
+
+void FrameFilter::add(std::string_view frame_id)
+{
+    if(frame_id.size() != 4)
+    {
+        throw std::invalid_argument("Frame id must have 4 characters");
+    }
+
+    if(const auto id = to_frame_id(frame_id); !contains(id))
+    {
+        frame_ids.push_back(id);
+        groups.push_back(groups_added++);
+    }
+}
+
+bool FrameFilter::empty() const
+{
+    return frame_ids.empty();
+}
+
+std::size_t FrameFilter::size() const
+{
+    return frame_ids.size();
+}
+
+bool FrameFilter::contains(FrameId frame_id) const
+{
+    return std::find(frame_ids.cbegin(), frame_ids.cend(), frame_id) != frame_ids.cend();
+}
+
+std::size_t FrameFilter::group_count() const
+{
+    return groups_added;
+}
+
+std::size_t FrameFilter::group(FrameId frame_id) const
+{
+    const auto it = std::find(frame_ids.cbegin(), frame_ids.cend(), frame_id);
+    return it != frame_ids.cend() ? groups[static_cast<std::size_t>(it - frame_ids.cbegin())]
+                                  : groups_added;
+}
+
+static const FrameView *find_tag_frame(const TagsView &tags, Tag tag)
+{
+    const auto *frame = tags.findFrame(tag_mapping.at(tag));
+    if(frame == nullptr && tag == Tag::YEAR)
+    {
+        frame = tags.findFrame(LegacyYearFrameId);
+    }
+    return frame;
+}
+
+TagsView::TagsView(
+    Header &&header, std::shared_ptr<const std::byte[]> &&buffer, std::vector<FrameView> &&frames)
+: header{ std::move(header) }
+, buffer{ std::move(buffer) }
+, frames{ std::move(frames) }
+{
+    index.reserve(this->frames.size());
+    for(std::size_t i = 0; i < this->frames.size(); ++i)
+    {
+        index.push_back({ to_frame_id(this->frames[i].id), static_cast<std::uint32_t>(i) });
+    }
+
+    // stable so that the first of several frames sharing an id is found first
+    std::stable_sort(index.begin(), index.end(),
+        [](const auto &lhs, const auto &rhs) { return lhs.frame_id < rhs.frame_id; });
+}
+
+const Header &TagsView::getHeader() const
+{
+    return header;
+}
+
+const std::vector<FrameView> &TagsView::getFrames() const
+{
+    return frames;
+}
+
+const FrameView *TagsView::findFrame(FrameId frame_id) const
+{
+    const auto entry = std::lower_bound(index.cbegin(), index.cend(), frame_id,
+        [](const auto &entry, FrameId id) { return entry.frame_id < id; });
+
+    if(entry == index.cend() || entry->frame_id != frame_id)
+    {
+        return nullptr;
+    }
+
+    return &frames[entry->frame_index];
+}
+
+std::span<const std::byte> TagsView::getFrameData(const FrameView &frame) const
+{
+    const auto flags = decode_frame_flags(header.version_major, frame.flags);
+    if(flags.encryption)
+    {
+        return {};
+    }
+
+    if(flags.compression)
+    {
+#ifdef AUDIOTAG_HAS_ZLIB
+        thread_local Inflater inflater;
+        return inflater.inflate(frame.data, frame.data_length);
+#else
+        return {};
+#endif
+    }
+
+    return frame.data;
+}
+
+std::string TagsView::getStringValue(Tag tag) const
+{
+    if(const auto *frame = find_tag_frame(*this, tag); frame != nullptr)
+    {
+        return decode_text(getFrameData(*frame));
+    }
+
+    return "";
+}
+
+std::vector<std::string> TagsView::getStringValues(std::span<const Tag> tags) const
+{
+    std::vector<std::string> values(tags.size());
+
+    visitStringValues(tags, [&tags, &values](Tag tag, std::string_view value) {
+        for(std::size_t i = 0; i < tags.size(); ++i)
         {
-            return utf8::utf16to8(from_bytes_to_utf16(std::span<const std::byte>(frameIt->data).subspan(1)));
+            if(tags[i] == tag)
+            {
+                values[i] = value;
+            }
         }
-        else if(encoding == 2)
+    });
+
+    return values;
+}
+
+void TagsView::visitStringValues(std::span<const Tag> tags, const StringVisitor &visitor) const
+{
+    struct Request
+    {
+        Tag tag;
+        const FrameView *frame;
+    };
+
+    std::vector<Request> requests;
+    requests.reserve(tags.size());
+
+    for(const auto tag : tags)
+    {
+        const auto duplicate = std::any_of(requests.cbegin(), requests.cend(),
+            [tag](const auto &request) { return request.tag == tag; });
+
+        if(const auto *frame = find_tag_frame(*this, tag); frame != nullptr && !duplicate)
         {
-            return utf8::utf16to8(from_bytes_to_utf16(
-                std::span<const std::byte>(frameIt->data).subspan(1), std::endian::big));
+            requests.push_back({ tag, frame });
         }
     }
 
-    return "";
+    // decode in buffer order, walking the tag once front to back
+    std::sort(requests.begin(), requests.end(),
+        [](const auto &lhs, const auto &rhs) { return lhs.frame < rhs.frame; });
+
+    // the buffer is taken out of the thread's spare while in use, so a visitor
+    // that visits another tag gets a buffer of its own
+    thread_local std::string spare;
+    auto buffer = std::move(spare);
+    for(const auto &request : requests)
+    {
+        // inflated data lives in the thread's inflate scratch, which a visitor
+        // reading another compressed frame overwrites, so it is never borrowed
+        const auto data = getFrameData(*request.frame);
+        const auto borrow = data.data() == request.frame->data.data();
+        visitor(request.tag, decode_text(data, buffer, borrow));
+    }
+    spare = std::move(buffer);
+}
+
+Tags TagsView::toTags() const
+{
+    std::vector<TagFrame> tag_frames;
+    tag_frames.reserve(frames.size());
+
+    // owning frames hold the decoded contents, the flags describe the stored frame
+    for(const auto &frame : frames)
+    {
+        const auto flags = decode_frame_flags(header.version_major, frame.flags);
+        const auto data = getFrameData(frame);
+
+        tag_frames.emplace_back(TagFrame{
+            .id = frame.id,
+            .data = { data.begin(), data.end() },
+            .tag_preservation = flags.tag_preservation,
+            .file_preservation = flags.file_preservation,
+            .read_only = flags.read_only,
+            .compression = flags.compression,
+            .encryption = flags.encryption,
+            .grouping_identity = flags.grouping_identity,
+            .group_id = frame.group_id,
+        });
+    }
+
+    return Tags{ Header{ header }, std::move(tag_frames) };
 }
 } // namespace audiotag::ID3v2
@@ -0,0 +1,143 @@
+#include "id3v2_frames.hpp"
+
+#include <audiotag/byte_conversions.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace audiotag::ID3v2
+{
+std::optional<FrameHeader> parse_frame_header(
+    std::span<const std::byte> data, bool synch_safe_size, std::size_t remaining)
+{
+    if(data.size() < FrameHeaderSize || remaining < FrameHeaderSize ||
+        data[0] == std::byte{ '\0' })
+    {
+        return std::nullopt;
+    }
+
+    const auto frame_size_span = data.subspan(4, 4);
+    const auto frame_size =
+        synch_safe_size ? to_synch_uint32_t(frame_size_span) : to_u32_be(frame_size_span);
+
+    if(frame_size > remaining - FrameHeaderSize)
+    {
+        return std::nullopt;
+    }
+
+    return FrameHeader{
+        .id = { data[0], data[1], data[2], data[3] },
+        .size = frame_size,
+        .flags = to_u16_be(data.subspan(8, 2)),
+    };
+}
+
+std::optional<Header> parse_header(
+    std::span<const std::byte> data, const std::byte (&identifier)[3])
+{
+    if(data.size() != HeaderSize ||
+        std::memcmp(identifier, data.data(), sizeof(identifier)) != 0)
+    {
+        return std::nullopt;
+    }
+
+    const auto version_major = std::to_integer<std::uint8_t>(data[3]);
+    const auto flags = std::to_integer<std::uint8_t>(data[5]);
+
+    return Header{
+        .version_major = version_major,
+        .version_revision = std::to_integer<std::uint8_t>(data[4]),
+        .unsynchronization = (flags & HeaderFlags::Unsynchronization) != 0,
+        .extended_header = (flags & HeaderFlags::ExtendedHeader) != 0,
+        .experimental = (flags & HeaderFlags::Experimental) != 0,
+        .footer = version_major >= 4 && (flags & HeaderFlags::Footer) != 0,
+        .size = to_synch_uint32_t(data.subspan(6, 4)),
+    };
+}
+
+std::size_t tag_extent(const Header &header)
+{
+    return HeaderSize + header.size + (header.footer ? HeaderSize : 0);
+}
+
+std::size_t extended_header_size(std::span<const std::byte> data, const Header &header)
+{
+    if(!header.extended_header || data.size() < 4)
+    {
+        return 0;
+    }
+
+    // v2.3 does not count the size field itself and does not use synch safe integers
+    if(header.version_major < 4)
+    {
+        return 4 + std::size_t{ to_u32_be(data.first(4)) };
+    }
+
+    return to_synch_uint32_t(data.first(4));
+}
+
+bool tag_unsynchronized(const Header &header)
+{
+    return header.unsynchronization && header.version_major < 4;
+}
+
+std::span<std::byte> decode_unsynchronized(std::span<std::byte> data)
+{
+    return data.first(remove_unsynchronization(data));
+}
+
+bool frame_unsynchronized(const Header &header, const FrameHeader &frame_header)
+{
+    return header.version_major >= 4 &&
+           (header.unsynchronization ||
+               decode_frame_flags(header.version_major, frame_header.flags).unsynchronization);
+}
+
+FrameView make_frame_view(
+    const Header &header, const FrameHeader &frame_header, std::span<const std::byte> data)
+{
+    const auto flags = decode_frame_flags(header.version_major, frame_header.flags);
+    const auto v24 = header.version_major >= 4;
+
+    std::uint32_t data_length{ 0 };
+    std::uint8_t group_id{ 0 };
+    const auto skip = [&data](std::size_t count) {
+        const auto field = data.first(std::min(count, data.size()));
+        data = data.subspan(field.size());
+        return field;
+    };
+
+    if(!v24)
+    {
+        if(const auto field = skip(flags.compression ? 4 : 0); field.size() == 4)
+        {
+            data_length = to_u32_be(field);
+        }
+        skip(flags.encryption ? 1 : 0);
+        if(const auto field = skip(flags.grouping_identity ? 1 : 0); field.size() == 1)
+        {
+            group_id = std::to_integer<std::uint8_t>(field[0]);
+        }
+    }
+    else
+    {
+        if(const auto field = skip(flags.grouping_identity ? 1 : 0); field.size() == 1)
+        {
+            group_id = std::to_integer<std::uint8_t>(field[0]);
+        }
+        skip(flags.encryption ? 1 : 0);
+        if(const auto field = skip(flags.data_length_indicator ? 4 : 0); field.size() == 4)
+        {
+            data_length = to_synch_uint32_t(field);
+        }
+    }
+
+    return FrameView{
+        .id = frame_header.id,
+        .flags = frame_header.flags,
+        .data = data,
+        .data_length = data_length,
+        .group_id = group_id,
+    };
+}
+} // namespace audiotag::ID3v2
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "audiotag/id3v2.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+// Pieces of the ID3v2 layout shared by the random access and the streaming parser
+namespace audiotag::ID3v2
+{
+constexpr std::size_t FrameHeaderSize{ 10 };
+
+struct FrameHeader
+{
+    std::array<std::byte, 4> id;
+    std::uint32_t size;
+    std::uint16_t flags;
+};
+
+// Decodes the frame header at the start of `data`, nullopt on padding or when
+// the frame would overrun the `remaining` bytes of the tag
+std::optional<FrameHeader> parse_frame_header(
+    std::span<const std::byte> data, bool synch_safe_size, std::size_t remaining);
+
+// Decodes a tag header, or a footer which shares its layout
+std::optional<Header> parse_header(
+    std::span<const std::byte> data, const std::byte (&identifier)[3]);
+
+// Bytes the tag takes in the file, header and footer included
+std::size_t tag_extent(const Header &header);
+
+// Bytes taken by the extended header whose size field starts `data`
+std::size_t extended_header_size(std::span<const std::byte> data, const Header &header);
+
+// v2.3 unsynchronizes the tag as a whole, v2.4 every frame on its own
+bool tag_unsynchronized(const Header &header);
+
+// Whether the data of a v2.4 frame has to be decoded before make_frame_view
+bool frame_unsynchronized(const Header &header, const FrameHeader &frame_header);
+
+std::span<std::byte> decode_unsynchronized(std::span<std::byte> data);
+
+// Splits off the fields the format flags put in front of the frame contents;
+// compressed data is left as is
+FrameView make_frame_view(
+    const Header &header, const FrameHeader &frame_header, std::span<const std::byte> data);
+} // namespace audiotag::ID3v2
@@ -0,0 +1,306 @@
+#include "audiotag/id3v2_stream.hpp"
+
+#include "id3v2_frames.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+namespace audiotag::ID3v2
+{
+namespace
+{
+// bytes of a tag unsynchronized as a whole decoded at a time, whatever the chunk size
+constexpr std::size_t decode_block_size{ 4096 };
+
+// Appends up to `size` - buffer.size() bytes from the front of `data` to `buffer`
+// and drops them from `data`, true once the buffer holds `size` bytes
+bool fill(std::vector<std::byte> &buffer, std::span<const std::byte> &data, std::size_t size)
+{
+    const auto count = std::min(size - buffer.size(), data.size());
+    buffer.insert(buffer.end(), data.begin(), data.begin() + count);
+    data = data.subspan(count);
+    return buffer.size() == size;
+}
+} // namespace
+
+StreamParser::StreamParser(HeaderCallback on_header, FrameCallback on_frame, StreamOptions options)
+: on_header(std::move(on_header))
+, on_frame(std::move(on_frame))
+, options(std::move(options))
+{
+}
+
+std::size_t StreamParser::feed(std::span<const std::byte> data)
+{
+    std::size_t taken{ 0 };
+    if(current_state == State::Header)
+    {
+        taken = feed_header(data);
+    }
+
+    if(current_state == State::Body)
+    {
+        const auto body = data.subspan(taken, std::min(raw_remaining, data.size() - taken));
+        taken += body.size();
+        feed_body(body);
+    }
+
+    if(current_state == State::Footer)
+    {
+        const auto footer = std::min(raw_remaining, data.size() - taken);
+        taken += footer;
+        raw_remaining -= footer;
+        if(raw_remaining == 0)
+        {
+            current_state = State::Done;
+        }
+    }
+
+    consumed_bytes += taken;
+    return taken;
+}
+
+StreamParser::State StreamParser::state() const
+{
+    return current_state;
+}
+
+bool StreamParser::done() const
+{
+    return current_state == State::Done || current_state == State::NoTag;
+}
+
+std::size_t StreamParser::consumed() const
+{
+    return consumed_bytes;
+}
+
+std::span<const std::byte> StreamParser::unconsumed() const
+{
+    return current_state == State::NoTag ? std::span<const std::byte>(buffer)
+                                         : std::span<const std::byte>();
+}
+
+std::size_t StreamParser::skipped_frames() const
+{
+    return skipped;
+}
+
+std::size_t StreamParser::feed_header(std::span<const std::byte> data)
+{
+    const auto held = buffer.size();
+    auto rest = data;
+    const auto complete = fill(buffer, rest, HeaderSize);
+
+    // audio is told apart from a tag as soon as the identifier stops matching
+    if(std::memcmp(buffer.data(), Identifier, std::min(buffer.size(), sizeof(Identifier))) != 0)
+    {
+        buffer.resize(held);
+        current_state = State::NoTag;
+        consumed_bytes = 0;
+        return 0;
+    }
+
+    if(complete)
+    {
+        header = *parse_header(buffer, Identifier);
+        buffer.clear();
+
+        current_state = State::Body;
+        step = header.extended_header ? Step::ExtendedHeaderSize : Step::FrameHeader;
+        raw_remaining = header.size;
+
+        if(on_header)
+        {
+            on_header(header);
+        }
+
+        if(raw_remaining == 0)
+        {
+            end_body();
+        }
+    }
+
+    return data.size() - rest.size();
+}
+
+void StreamParser::feed_body(std::span<const std::byte> data)
+{
+    if(!tag_unsynchronized(header))
+    {
+        raw_remaining -= data.size();
+        feed_frames(data);
+    }
+    else
+    {
+        std::array<std::byte, decode_block_size> scratch;
+        while(!data.empty())
+        {
+            const auto block = data.first(std::min(data.size(), scratch.size()));
+            data = data.subspan(block.size());
+            raw_remaining -= block.size();
+
+            // the 0x00 following a 0xFF at the end of the previous block
+            auto raw = block;
+            if(previous_ff && raw.front() == std::byte{ 0x00 })
+            {
+                raw = raw.subspan(1);
+            }
+            previous_ff = block.back() == std::byte{ 0xFF };
+
+            std::ranges::copy(raw, scratch.begin());
+            feed_frames(decode_unsynchronized(std::span(scratch).first(raw.size())));
+        }
+    }
+
+    if(raw_remaining == 0)
+    {
+        end_body();
+    }
+}
+
+void StreamParser::feed_frames(std::span<const std::byte> data)
+{
+    while(!data.empty())
+    {
+        switch(step)
+        {
+        case Step::ExtendedHeaderSize:
+            if(fill(buffer, data, 4))
+            {
+                // both versions count the size field in extended_header_size
+                const auto size = extended_header_size(buffer, header);
+                skip_remaining = size - std::min<std::size_t>(size, 4);
+                buffer.clear();
+                step = Step::Skip;
+            }
+            break;
+
+        case Step::Skip:
+        {
+            const auto count = std::min(skip_remaining, data.size());
+            data = data.subspan(count);
+            skip_remaining -= count;
+            if(skip_remaining == 0)
+            {
+                step = Step::FrameHeader;
+            }
+            break;
+        }
+
+        case Step::FrameHeader:
+        {
+            // upper bound of the decoded bytes left from the start of this frame
+            const auto remaining = buffer.size() + data.size() + raw_remaining;
+
+            std::optional<FrameHeader> frame_header;
+            if(buffer.empty() && data.size() >= FrameHeaderSize)
+            {
+                frame_header =
+                    parse_frame_header(data, header.version_major >= 4, remaining);
+                data = data.subspan(FrameHeaderSize);
+            }
+            else if(fill(buffer, data, FrameHeaderSize))
+            {
+                frame_header =
+                    parse_frame_header(buffer, header.version_major >= 4, remaining);
+                buffer.clear();
+            }
+            else
+            {
+                break;
+            }
+
+            if(!frame_header)
+            {
+                step = Step::Padding;
+                break;
+            }
+
+            frame_id = frame_header->id;
+            frame_size = frame_header->size;
+            frame_flags = frame_header->flags;
+
+            auto keep = options.filter.empty() || options.filter.contains(to_frame_id(frame_id));
+            if(keep && frame_size > options.max_frame_size)
+            {
+                ++skipped;
+                keep = false;
+            }
+
+            if(!keep)
+            {
+                skip_remaining = frame_size;
+                step = Step::Skip;
+            }
+            else if(frame_size == 0)
+            {
+                deliver_frame({});
+            }
+            else
+            {
+                step = Step::FrameData;
+            }
+            break;
+        }
+
+        case Step::FrameData:
+            // a frame lying within the chunk is handed out in place
+            if(buffer.empty() && data.size() >= frame_size)
+            {
+                const auto frame_data = data.first(frame_size);
+                data = data.subspan(frame_size);
+                deliver_frame(frame_data);
+            }
+            else if(fill(buffer, data, frame_size))
+            {
+                deliver_frame(buffer);
+            }
+            break;
+
+        case Step::Padding:
+            data = {};
+            break;
+        }
+    }
+}
+
+void StreamParser::deliver_frame(std::span<const std::byte> data)
+{
+    const FrameHeader frame_header{ .id = frame_id, .size = frame_size, .flags = frame_flags };
+    if(frame_unsynchronized(header, frame_header))
+    {
+        if(data.data() != buffer.data())
+        {
+            buffer.assign(data.begin(), data.end());
+        }
+        data = decode_unsynchronized(buffer);
+    }
+
+    if(on_frame)
+    {
+        on_frame(make_frame_view(header, frame_header, data));
+    }
+
+    buffer.clear();
+    step = Step::FrameHeader;
+}
+
+void StreamParser::end_body()
+{
+    // a frame cut off by the end of the tag is dropped
+    buffer.clear();
+    if(header.footer)
+    {
+        current_state = State::Footer;
+        raw_remaining = HeaderSize;
+    }
+    else
+    {
+        current_state = State::Done;
+    }
+}
+} // namespace audiotag::ID3v2
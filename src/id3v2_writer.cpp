@@ -0,0 +1,227 @@
+#include "audiotag/id3v2_writer.hpp"
+
+#include "file_io.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utf8/cpp17.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace audiotag::ID3v2
+{
+namespace
+{
+constexpr std::size_t FrameHeaderSize{ 10 };
+constexpr std::uint32_t MaxSynchSafe{ (1u << 28) - 1 };
+
+void append_u32_be(std::vector<std::byte> &out, std::uint32_t value)
+{
+    out.push_back(std::byte(value >> 24));
+    out.push_back(std::byte(value >> 16));
+    out.push_back(std::byte(value >> 8));
+    out.push_back(std::byte(value));
+}
+
+void append_synch_safe(std::vector<std::byte> &out, std::uint32_t value)
+{
+    out.push_back(std::byte((value >> 21) & 0x7F));
+    out.push_back(std::byte((value >> 14) & 0x7F));
+    out.push_back(std::byte((value >> 7) & 0x7F));
+    out.push_back(std::byte(value & 0x7F));
+}
+
+std::uint16_t encode_frame_flags(std::uint8_t version, const TagFrame &frame)
+{
+    const auto shift = version < 4 ? 1 : 0;
+
+    std::uint16_t flags{ 0 };
+    flags |= frame.tag_preservation ? 0x4000 << shift : 0;
+    flags |= frame.file_preservation ? 0x2000 << shift : 0;
+    flags |= frame.read_only ? 0x1000 << shift : 0;
+    flags |= frame.grouping_identity ? (version < 4 ? 0x0020 : 0x0040) : 0;
+    return flags;
+}
+
+} // namespace
+
+TagFrame make_text_frame(std::string_view frame_id, std::string_view value, std::uint8_t version)
+{
+    if(frame_id.size() != 4)
+    {
+        throw std::invalid_argument("Frame id must have four characters");
+    }
+
+    // checked once so both encodings reject the same input
+    if(!utf8::is_valid(value))
+    {
+        throw std::invalid_argument("Frame text must be valid UTF-8");
+    }
+
+    TagFrame frame{};
+    std::transform(frame_id.begin(), frame_id.end(), frame.id.begin(),
+        [](const char c) { return std::byte(c); });
+
+    if(version >= 4)
+    {
+        frame.data.reserve(value.size() + 1);
+        frame.data.push_back(std::byte{ 3 }); // utf-8
+        const auto bytes = std::as_bytes(std::span(value.data(), value.size()));
+        frame.data.insert(frame.data.end(), bytes.begin(), bytes.end());
+        return frame;
+    }
+
+    const auto text = utf8::utf8to16(value);
+    frame.data.reserve(text.size() * 2 + 3);
+    frame.data.push_back(std::byte{ 1 }); // utf-16 with bom
+    frame.data.push_back(std::byte{ 0xFF });
+    frame.data.push_back(std::byte{ 0xFE });
+    for(const auto unit : text)
+    {
+        frame.data.push_back(std::byte(unit & 0xFF));
+        frame.data.push_back(std::byte(unit >> 8));
+    }
+    return frame;
+}
+
+TagFrame make_text_frame(Tag tag, std::string_view value, std::uint8_t version)
+{
+    // TDRC is new in v2.4, v2.3 stores the year in TYER
+    if(tag == Tag::YEAR && version < 4)
+    {
+        return make_text_frame("TYER", value, version);
+    }
+
+    const auto frame_id = to_frame_id(tag);
+    const char id[4] = {
+        static_cast<char>(frame_id >> 24),
+        static_cast<char>(frame_id >> 16),
+        static_cast<char>(frame_id >> 8),
+        static_cast<char>(frame_id),
+    };
+    return make_text_frame(std::string_view(id, sizeof(id)), value, version);
+}
+
+bool writable(const TagFrame &frame)
+{
+    return !frame.encryption && !(frame.compression && frame.data.empty());
+}
+
+std::size_t serialized_size(std::span<const TagFrame> frames)
+{
+    auto size = HeaderSize;
+    for(const auto &frame : frames)
+    {
+        size += FrameHeaderSize + (frame.grouping_identity ? 1 : 0) + frame.data.size();
+    }
+    return size;
+}
+
+std::size_t target_tag_size(
+    std::span<const TagFrame> frames, std::size_t existing_size, std::size_t padding)
+{
+    const auto needed = serialized_size(frames);
+    return existing_size > 0 && needed <= existing_size ? existing_size : needed + padding;
+}
+
+std::vector<std::byte> serialize_tag(
+    std::span<const TagFrame> frames, std::uint8_t version, std::size_t tag_size)
+{
+    if(version != 3 && version != 4)
+    {
+        throw std::invalid_argument("Only ID3v2.3 and ID3v2.4 tags can be written");
+    }
+    if(!std::all_of(
+           frames.begin(), frames.end(), [](const auto &frame) { return writable(frame); }))
+    {
+        throw std::invalid_argument("Encrypted or undecoded compressed frames cannot be written");
+    }
+    if(tag_size < serialized_size(frames) || tag_size - HeaderSize > MaxSynchSafe)
+    {
+        throw std::length_error("Frames do not fit the tag size");
+    }
+
+    std::vector<std::byte> tag;
+    tag.reserve(tag_size);
+    tag.insert(tag.end(), std::begin(Identifier), std::end(Identifier));
+    tag.push_back(std::byte{ version });
+    tag.push_back(std::byte{ 0 }); // revision
+    tag.push_back(std::byte{ 0 }); // flags
+    append_synch_safe(tag, static_cast<std::uint32_t>(tag_size - HeaderSize));
+
+    for(const auto &frame : frames)
+    {
+        // the group id is the only field written ahead of the data
+        const auto group_size = frame.grouping_identity ? 1 : 0;
+        const auto size = static_cast<std::uint32_t>(group_size + frame.data.size());
+        const auto flags = encode_frame_flags(version, frame);
+
+        tag.insert(tag.end(), frame.id.begin(), frame.id.end());
+        if(version >= 4)
+        {
+            append_synch_safe(tag, size);
+        }
+        else
+        {
+            append_u32_be(tag, size);
+        }
+        tag.push_back(std::byte(flags >> 8));
+        tag.push_back(std::byte(flags & 0xFF));
+        if(frame.grouping_identity)
+        {
+            tag.push_back(std::byte{ frame.group_id });
+        }
+        tag.insert(tag.end(), frame.data.begin(), frame.data.end());
+    }
+
+    // the rest of the tag is padding
+    tag.resize(tag_size);
+    return tag;
+}
+
+WriteResult write_tag(
+    std::string_view path, std::span<const TagFrame> frames, const WriteOptions &options)
+{
+    const std::string file_path{ path };
+
+    FileDescriptor file{ open(file_path.c_str(), O_RDWR | O_CLOEXEC) };
+    if(file.get() < 0)
+    {
+        throw std::runtime_error("File not opened");
+    }
+
+    struct stat file_stat = {};
+    if(fstat(file.get(), &file_stat) != 0)
+    {
+        throw std::runtime_error("Couldn't read file stat");
+    }
+
+    std::array<std::byte, HeaderSize> header{};
+    const auto header_read = pread(file.get(), header.data(), header.size(), 0);
+    const auto existing_size =
+        header_read == static_cast<ssize_t>(header.size()) ? tag_size(header) : 0;
+    if(existing_size > static_cast<std::size_t>(file_stat.st_size))
+    {
+        throw std::runtime_error("ID3v2 tag exceeds file size");
+    }
+
+    const auto tag = serialize_tag(
+        frames, options.version, target_tag_size(frames, existing_size, options.padding));
+    if(tag.size() == existing_size)
+    {
+        write_fully(file.get(), tag, 0);
+        return WriteResult{ .mode = WriteMode::InPlace, .bytes_written = tag.size() };
+    }
+
+    replace_head(file_path, file.get(), file_stat, tag, existing_size);
+
+    const auto audio_size = static_cast<std::size_t>(file_stat.st_size) - existing_size;
+    return WriteResult{ .mode = WriteMode::Rewritten, .bytes_written = tag.size() + audio_size };
+}
+} // namespace audiotag::ID3v2
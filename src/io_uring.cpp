@@ -0,0 +1,252 @@
+#include "io_uring.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+int io_uring_setup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int ring_fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+template <typename T> T *ring_field(void *ring, std::uint32_t offset)
+{
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+unsigned load_acquire(unsigned *value)
+{
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned *value, unsigned new_value)
+{
+    std::atomic_ref<unsigned>(*value).store(new_value, std::memory_order_release);
+}
+} // namespace
+
+IoUring::IoUring(unsigned entries)
+{
+    io_uring_params params{};
+    ring_fd = io_uring_setup(entries, &params);
+    if(ring_fd < 0)
+    {
+        throw std::runtime_error("io_uring not available");
+    }
+
+    sq_entries = params.sq_entries;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+    constexpr auto protection = PROT_READ | PROT_WRITE;
+    constexpr auto flags = MAP_SHARED | MAP_POPULATE;
+
+    sq_ring = mmap(nullptr, sq_ring_size, protection, flags, ring_fd, IORING_OFF_SQ_RING);
+    cq_ring = mmap(nullptr, cq_ring_size, protection, flags, ring_fd, IORING_OFF_CQ_RING);
+    void *sqes_mapping = mmap(nullptr, sqes_size, protection, flags, ring_fd, IORING_OFF_SQES);
+
+    if(sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes_mapping == MAP_FAILED)
+    {
+        sq_ring = sq_ring == MAP_FAILED ? nullptr : sq_ring;
+        cq_ring = cq_ring == MAP_FAILED ? nullptr : cq_ring;
+        sqes_size = sqes_mapping == MAP_FAILED ? 0 : sqes_size;
+        sqes = sqes_mapping == MAP_FAILED ? nullptr : static_cast<io_uring_sqe *>(sqes_mapping);
+        release();
+        throw std::runtime_error("io_uring rings not mapped");
+    }
+
+    sqes = static_cast<io_uring_sqe *>(sqes_mapping);
+
+    sq_head = ring_field<unsigned>(sq_ring, params.sq_off.head);
+    sq_tail = ring_field<unsigned>(sq_ring, params.sq_off.tail);
+    sq_mask = *ring_field<unsigned>(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field<unsigned>(sq_ring, params.sq_off.array);
+
+    cq_head = ring_field<unsigned>(cq_ring, params.cq_off.head);
+    cq_tail = ring_field<unsigned>(cq_ring, params.cq_off.tail);
+    cq_mask = *ring_field<unsigned>(cq_ring, params.cq_off.ring_mask);
+    cqes = ring_field<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+    if(!probe_operations())
+    {
+        release();
+        throw std::runtime_error("io_uring lacks required operations");
+    }
+}
+
+IoUring::~IoUring()
+{
+    release();
+}
+
+void IoUring::release()
+{
+    if(sqes != nullptr)
+    {
+        munmap(sqes, sqes_size);
+        sqes = nullptr;
+    }
+
+    if(cq_ring != nullptr)
+    {
+        munmap(cq_ring, cq_ring_size);
+        cq_ring = nullptr;
+    }
+
+    if(sq_ring != nullptr)
+    {
+        munmap(sq_ring, sq_ring_size);
+        sq_ring = nullptr;
+    }
+
+    if(ring_fd >= 0)
+    {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+bool IoUring::probe_operations()
+{
+    constexpr unsigned probe_ops{ IORING_OP_LAST };
+
+    std::vector<std::byte> storage(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+    auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+
+    if(io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+    {
+        return false;
+    }
+
+    for(const auto opcode : { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE })
+    {
+        if(opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+unsigned IoUring::entries() const
+{
+    return sq_entries;
+}
+
+int IoUring::file_descriptor() const
+{
+    return ring_fd;
+}
+
+io_uring_sqe *IoUring::get_sqe()
+{
+    const auto head = load_acquire(sq_head);
+    const auto tail = *sq_tail;
+    if(tail - head >= sq_entries)
+    {
+        return nullptr;
+    }
+
+    const auto index = tail & sq_mask;
+    auto *sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    sq_array[index] = index;
+    store_release(sq_tail, tail + 1);
+    ++to_submit;
+
+    return sqe;
+}
+
+void IoUring::submit(unsigned wait_nr)
+{
+    const unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    while(true)
+    {
+        const auto submitted = io_uring_enter(ring_fd, to_submit, wait_nr, flags);
+        if(submitted >= 0)
+        {
+            to_submit -= submitted;
+            return;
+        }
+
+        if(errno == EINTR || errno == EAGAIN)
+        {
+            continue;
+        }
+
+        if(to_submit == 0)
+        {
+            throw std::runtime_error("io_uring_enter failed");
+        }
+
+        refuse_queued(errno);
+        return;
+    }
+}
+
+void IoUring::refuse_queued(int error)
+{
+    // the kernel consumes entries in order and a failed enter consumes none, so
+    // the last `to_submit` entries before the tail are the ones still queued
+    const auto tail = *sq_tail;
+    const auto first = tail - to_submit;
+    for(auto position = first; position != tail; ++position)
+    {
+        io_uring_cqe cqe{};
+        cqe.user_data = sqes[sq_array[position & sq_mask]].user_data;
+        cqe.res = -error;
+        cqe.flags = RefusedFlag;
+        refused.push_back(cqe);
+    }
+
+    store_release(sq_tail, first);
+    to_submit = 0;
+}
+
+bool IoUring::pop(io_uring_cqe &cqe)
+{
+    if(!refused.empty())
+    {
+        cqe = refused.back();
+        refused.pop_back();
+        return true;
+    }
+
+    const auto head = *cq_head;
+    if(head == load_acquire(cq_tail))
+    {
+        return false;
+    }
+
+    cqe = cqes[head & cq_mask];
+    store_release(cq_head, head + 1);
+
+    return true;
+}
+} // namespace audiotag
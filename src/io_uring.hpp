@@ -0,0 +1,72 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiotag
+{
+// Minimal io_uring submission/completion ring on top of the raw syscalls;
+// the constructor throws when the kernel does not provide io_uring or lacks
+// one of the operations the batch readers rely on.
+class IoUring
+{
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    [[nodiscard]] unsigned entries() const;
+
+    // Ring descriptor, readable while completions are pending
+    [[nodiscard]] int file_descriptor() const;
+
+    // Next free submission entry, cleared; nullptr when the ring is full
+    [[nodiscard]] io_uring_sqe *get_sqe();
+
+    // Set in the flags of completions made up for entries the kernel refused
+    static constexpr std::uint32_t RefusedFlag{ 1u << 31 };
+
+    // Submits queued entries and blocks until at least `wait_nr` completions are
+    // ready. Entries the kernel refuses, e.g. with EBUSY or ENOMEM, are taken
+    // back off the ring and complete with that error and RefusedFlag, so each
+    // fails on its own instead of the caller unwinding past entries in flight.
+    // Throws std::runtime_error only when the ring fails with nothing queued.
+    void submit(unsigned wait_nr);
+
+    // Pops one completion, returns false when none is ready
+    [[nodiscard]] bool pop(io_uring_cqe &cqe);
+
+private:
+    bool probe_operations();
+    void refuse_queued(int error);
+    void release();
+
+private:
+    int ring_fd{ -1 };
+    unsigned sq_entries{ 0 };
+    unsigned to_submit{ 0 };
+    std::vector<io_uring_cqe> refused;
+
+    void *sq_ring{ nullptr };
+    std::size_t sq_ring_size{ 0 };
+    void *cq_ring{ nullptr };
+    std::size_t cq_ring_size{ 0 };
+    io_uring_sqe *sqes{ nullptr };
+    std::size_t sqes_size{ 0 };
+
+    unsigned *sq_head{ nullptr };
+    unsigned *sq_tail{ nullptr };
+    unsigned sq_mask{ 0 };
+    unsigned *sq_array{ nullptr };
+
+    unsigned *cq_head{ nullptr };
+    unsigned *cq_tail{ nullptr };
+    unsigned cq_mask{ 0 };
+    io_uring_cqe *cqes{ nullptr };
+};
+} // namespace audiotag
@@ -0,0 +1,171 @@
+#include "audiotag/library_index.hpp"
+
+#include "audiotag/search_index.hpp"
+#include "audiotag/track_metadata.hpp"
+#include "file_format.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace audiotag
+{
+struct LibraryIndex::Impl
+{
+    struct Entry
+    {
+        FileKey key;
+        std::string path;
+        TrackMetadata metadata;
+    };
+
+    // entries by document, the id the index knows them by; dropped entries
+    // leave a hole that the next new entry takes
+    std::vector<std::optional<Entry>> entries;
+    std::vector<std::uint32_t> free_documents;
+    std::map<std::string, std::uint32_t, std::less<>> documents;
+    SearchIndexWriter index;
+
+    void put(const FileKey &key, std::string_view path, TrackMetadata &&metadata)
+    {
+        erase(path);
+
+        std::uint32_t document;
+        if(free_documents.empty())
+        {
+            document = static_cast<std::uint32_t>(entries.size());
+            entries.emplace_back();
+        }
+        else
+        {
+            document = free_documents.back();
+            free_documents.pop_back();
+        }
+
+        // the fields SearchIndexWriter::add indexes for a cache entry
+        index.add(document, metadata.title);
+        index.add(document, metadata.artist);
+        index.add(document, metadata.album);
+
+        entries[document] =
+            Entry{ .key = key, .path = std::string(path), .metadata = std::move(metadata) };
+        documents.emplace(path, document);
+    }
+
+    void erase(std::map<std::string, std::uint32_t, std::less<>>::iterator it)
+    {
+        const auto document = it->second;
+        const auto &metadata = entries[document]->metadata;
+        index.remove(document, metadata.title);
+        index.remove(document, metadata.artist);
+        index.remove(document, metadata.album);
+
+        entries[document].reset();
+        free_documents.push_back(document);
+        documents.erase(it);
+    }
+
+    void erase(std::string_view path)
+    {
+        if(const auto it = documents.find(path); it != documents.end())
+        {
+            erase(it);
+        }
+    }
+
+    // Entries below `directory`, which sort right after its path and a slash
+    void erase_tree(std::string_view directory)
+    {
+        const auto prefix = std::string(directory) + '/';
+        auto it = documents.lower_bound(prefix);
+        while(it != documents.end() && it->first.starts_with(prefix))
+        {
+            erase(it++);
+        }
+    }
+};
+
+LibraryIndex::LibraryIndex()
+: impl(std::make_unique<Impl>())
+{
+}
+
+LibraryIndex::LibraryIndex(const MetadataCache &cache)
+: LibraryIndex()
+{
+    for(std::size_t i = 0; i < cache.size(); ++i)
+    {
+        const auto entry = cache[i];
+        impl->put(entry.key(), entry.path(), entry.to_track_metadata());
+    }
+}
+
+LibraryIndex::~LibraryIndex() = default;
+LibraryIndex::LibraryIndex(LibraryIndex &&other) noexcept = default;
+LibraryIndex &LibraryIndex::operator=(LibraryIndex &&other) noexcept = default;
+
+void LibraryIndex::apply(const WatchEvent &event)
+{
+    const auto &result = event.result;
+    if(event.kind == WatchEventKind::Removed)
+    {
+        impl->erase(result.path);
+        impl->erase_tree(result.path);
+        return;
+    }
+
+    if(result.error || (!result.cached && !result.file))
+    {
+        impl->erase(result.path);
+        return;
+    }
+
+    impl->put(result.key, result.path,
+        result.cached ? result.cached->to_track_metadata() : to_track_metadata(*result.file));
+}
+
+std::size_t LibraryIndex::size() const
+{
+    return impl->documents.size();
+}
+
+void LibraryIndex::write(std::string_view cache_path, std::string_view index_path) const
+{
+    const auto &entries = impl->entries;
+
+    std::vector<std::uint32_t> order;
+    order.reserve(impl->documents.size());
+    for(const auto &[path, document] : impl->documents)
+    {
+        order.push_back(document);
+    }
+
+    // paths come in order, so hard links to one file keep the first of their paths
+    std::stable_sort(order.begin(), order.end(), [&entries](auto a, auto b) {
+        return key_less(entries[a]->key, entries[b]->key);
+    });
+
+    std::vector<std::uint32_t> rows(entries.size(), SearchIndexWriter::NoDocument);
+    MetadataCacheWriter cache;
+    for(std::size_t i = 0; i < order.size(); ++i)
+    {
+        const auto &entry = *entries[order[i]];
+        if(i > 0 && !key_less(entries[order[i - 1]]->key, entry.key))
+        {
+            rows[order[i]] = rows[order[i - 1]];
+            continue;
+        }
+
+        rows[order[i]] = static_cast<std::uint32_t>(cache.size());
+        cache.add(entry.key, entry.path, entry.metadata);
+    }
+
+    cache.write(cache_path);
+    impl->index.write(index_path, rows);
+}
+} // namespace audiotag
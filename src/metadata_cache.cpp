@@ -0,0 +1,270 @@
+#include "audiotag/metadata_cache.hpp"
+
+#include "audiotag/mmap_reader.hpp"
+#include "file_format.hpp"
+#include "file_io.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+
+namespace audiotag
+{
+namespace
+{
+constexpr char CacheMagic[8] = { 'A', 'T', 'C', 'A', 'C', 'H', 'E', '\0' };
+} // namespace
+
+FileKey to_file_key(const struct stat &file_stat)
+{
+    return FileKey{
+        .device = static_cast<std::uint64_t>(file_stat.st_dev),
+        .inode = static_cast<std::uint64_t>(file_stat.st_ino),
+        .size = static_cast<std::uint64_t>(file_stat.st_size),
+        .mtime_ns = static_cast<std::int64_t>(file_stat.st_mtim.tv_sec) * 1'000'000'000 +
+                    file_stat.st_mtim.tv_nsec,
+    };
+}
+
+std::optional<FileKey> read_file_key(std::string_view path)
+{
+    struct stat file_stat = {};
+    if(stat(std::string(path).c_str(), &file_stat) != 0)
+    {
+        return std::nullopt;
+    }
+
+    return to_file_key(file_stat);
+}
+
+MetadataCache::Entry::Entry(const CacheRecord &record, std::string_view strings)
+: record{ &record }
+, strings{ strings }
+{
+}
+
+const FileKey &MetadataCache::Entry::key() const
+{
+    return record->key;
+}
+
+std::string_view MetadataCache::Entry::path() const
+{
+    return string(record->path);
+}
+
+std::string_view MetadataCache::Entry::title() const
+{
+    return string(record->title);
+}
+
+std::string_view MetadataCache::Entry::artist() const
+{
+    return string(record->artist);
+}
+
+std::string_view MetadataCache::Entry::album() const
+{
+    return string(record->album);
+}
+
+std::string_view MetadataCache::Entry::genre() const
+{
+    return string(record->genre);
+}
+
+std::uint32_t MetadataCache::Entry::track() const
+{
+    return record->track;
+}
+
+std::uint32_t MetadataCache::Entry::disc() const
+{
+    return record->disc;
+}
+
+std::uint32_t MetadataCache::Entry::year() const
+{
+    return record->year;
+}
+
+std::uint32_t MetadataCache::Entry::duration_ms() const
+{
+    return record->duration_ms;
+}
+
+TrackMetadata MetadataCache::Entry::to_track_metadata() const
+{
+    return TrackMetadata{
+        .title = std::string(title()),
+        .artist = std::string(artist()),
+        .album = std::string(album()),
+        .genre = std::string(genre()),
+        .track = track(),
+        .disc = disc(),
+        .year = year(),
+        .duration_ms = duration_ms(),
+    };
+}
+
+std::string_view MetadataCache::Entry::string(const CacheString &value) const
+{
+    // offsets are checked on use, a damaged record reads as empty strings
+    if(value.offset > strings.size() || value.length > strings.size() - value.offset)
+    {
+        return {};
+    }
+
+    return strings.substr(value.offset, value.length);
+}
+
+struct MetadataCache::Impl
+{
+    MmapReader file;
+    std::span<const CacheRecord> records;
+    std::string_view strings;
+
+    explicit Impl(std::string_view path)
+    : file{ path }
+    {
+        const auto data = file.view(0, file.length());
+        const auto header =
+            read_file_header<CacheHeader>(data, CacheMagic, CacheVersion, "metadata cache");
+
+        const auto size = data.size();
+        if(header.records_offset % alignof(CacheRecord) != 0 || header.records_offset > size ||
+            header.entry_count > (size - header.records_offset) / sizeof(CacheRecord) ||
+            header.strings_offset > size || header.strings_size > size - header.strings_offset)
+        {
+            throw std::runtime_error("Corrupted metadata cache");
+        }
+
+        // the mapping is page aligned, so records at an aligned offset can be used in place
+        records = std::span(
+            reinterpret_cast<const CacheRecord *>(data.data() + header.records_offset),
+            header.entry_count);
+        strings = std::string_view(
+            reinterpret_cast<const char *>(data.data() + header.strings_offset),
+            header.strings_size);
+    }
+};
+
+MetadataCache::MetadataCache(std::string_view path)
+: impl(std::make_unique<Impl>(path))
+{
+}
+
+MetadataCache::~MetadataCache() = default;
+MetadataCache::MetadataCache(MetadataCache &&other) noexcept = default;
+MetadataCache &MetadataCache::operator=(MetadataCache &&other) noexcept = default;
+
+std::size_t MetadataCache::size() const
+{
+    return impl->records.size();
+}
+
+MetadataCache::Entry MetadataCache::operator[](std::size_t index) const
+{
+    return Entry{ impl->records[index], impl->strings };
+}
+
+std::optional<MetadataCache::Entry> MetadataCache::find(const FileKey &key) const
+{
+    const auto &records = impl->records;
+    const auto it = std::lower_bound(records.begin(), records.end(), key,
+        [](const CacheRecord &record, const FileKey &key) { return key_less(record.key, key); });
+
+    if(it == records.end() || it->key != key)
+    {
+        return std::nullopt;
+    }
+
+    return Entry{ *it, impl->strings };
+}
+
+void MetadataCacheWriter::add(
+    const FileKey &key, std::string_view path, const TrackMetadata &metadata)
+{
+    records.push_back(CacheRecord{
+        .key = key,
+        .path = add_string(path),
+        .title = add_string(metadata.title),
+        .artist = add_string(metadata.artist),
+        .album = add_string(metadata.album),
+        .genre = add_string(metadata.genre),
+        .track = metadata.track,
+        .disc = metadata.disc,
+        .year = metadata.year,
+        .duration_ms = metadata.duration_ms,
+    });
+}
+
+void MetadataCacheWriter::add(const MetadataCache::Entry &entry)
+{
+    records.push_back(CacheRecord{
+        .key = entry.key(),
+        .path = add_string(entry.path()),
+        .title = add_string(entry.title()),
+        .artist = add_string(entry.artist()),
+        .album = add_string(entry.album()),
+        .genre = add_string(entry.genre()),
+        .track = entry.track(),
+        .disc = entry.disc(),
+        .year = entry.year(),
+        .duration_ms = entry.duration_ms(),
+    });
+}
+
+std::size_t MetadataCacheWriter::size() const
+{
+    return records.size();
+}
+
+CacheString MetadataCacheWriter::add_string(std::string_view value)
+{
+    if(strings.size() + value.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        throw std::length_error("Metadata cache strings exceed 4 GiB");
+    }
+
+    const auto offset = static_cast<std::uint32_t>(strings.size());
+    strings.append(value);
+    return CacheString{ .offset = offset, .length = static_cast<std::uint32_t>(value.size()) };
+}
+
+void MetadataCacheWriter::write(std::string_view path) const
+{
+    // the last record added for a file wins
+    auto sorted = records;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const auto &a, const auto &b) { return key_less(a.key, b.key); });
+
+    std::vector<CacheRecord> unique;
+    unique.reserve(sorted.size());
+    for(std::size_t i = 0; i < sorted.size(); ++i)
+    {
+        if(i + 1 == sorted.size() || key_less(sorted[i].key, sorted[i + 1].key))
+        {
+            unique.push_back(sorted[i]);
+        }
+    }
+
+    auto header = make_file_header<CacheHeader>(CacheMagic, CacheVersion);
+    header.entry_count = unique.size();
+    header.records_offset = sizeof(CacheHeader);
+    header.strings_offset = header.records_offset + unique.size() * sizeof(CacheRecord);
+    header.strings_size = strings.size();
+
+    replace_file(path, 0644, [&](int file) {
+        write_fully(file, std::as_bytes(std::span(&header, 1)), 0);
+        write_fully(file, std::as_bytes(std::span(unique)),
+            static_cast<off_t>(header.records_offset));
+        write_fully(file, std::as_bytes(std::span(strings)),
+            static_cast<off_t>(header.strings_offset));
+    });
+}
+} // namespace audiotag
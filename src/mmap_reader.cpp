@@ -0,0 +1,119 @@
+#include "audiotag/mmap_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace audiotag
+{
+struct MmapReader::Impl
+{
+    const std::byte *data{ nullptr };
+    std::size_t file_size{ 0 };
+    std::size_t buffer_size{ 0 };
+    std::size_t cursor{ 0 };
+
+    ~Impl()
+    {
+        if(data != nullptr)
+        {
+            munmap(const_cast<std::byte *>(data), file_size);
+        }
+    }
+};
+
+MmapReader::MmapReader(std::string_view filename)
+: impl(std::make_unique<Impl>())
+{
+    const std::string path{ filename };
+
+    const auto file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(file_descriptor < 0)
+    {
+        throw std::runtime_error("File not opened");
+    }
+
+    struct stat file_stat = {};
+    if(const auto stat_result = fstat(file_descriptor, &file_stat); stat_result != 0)
+    {
+        close(file_descriptor);
+        throw std::runtime_error("Couldn't read file stat");
+    }
+
+    impl->file_size = file_stat.st_size;
+    impl->buffer_size = file_stat.st_blksize;
+
+    // mmap rejects empty mappings, an empty file is simply a reader of length 0
+    if(impl->file_size > 0)
+    {
+        void *mapping = mmap(nullptr, impl->file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if(mapping == MAP_FAILED)
+        {
+            close(file_descriptor);
+            throw std::runtime_error("File not mapped");
+        }
+
+        impl->data = static_cast<const std::byte *>(mapping);
+    }
+
+    // the mapping keeps the file referenced, the descriptor is no longer needed
+    close(file_descriptor);
+}
+
+MmapReader::~MmapReader() = default;
+
+std::size_t MmapReader::length() const
+{
+    return impl->file_size;
+}
+
+std::size_t MmapReader::buffer_size() const
+{
+    return impl->buffer_size;
+}
+
+std::size_t MmapReader::read(std::span<std::byte> buffer)
+{
+    const auto bytes_read = read_at(impl->cursor, buffer);
+    impl->cursor += bytes_read;
+    return bytes_read;
+}
+
+bool MmapReader::seek(long offset)
+{
+    if(offset < 0 || static_cast<std::size_t>(offset) > impl->file_size)
+    {
+        return false;
+    }
+
+    impl->cursor = offset;
+    return true;
+}
+
+std::size_t MmapReader::read_at(std::size_t offset, std::span<std::byte> buffer) const
+{
+    const auto bytes = view(offset, buffer.size());
+    if(!bytes.empty())
+    {
+        std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    }
+
+    return bytes.size();
+}
+
+std::span<const std::byte> MmapReader::view(std::size_t offset, std::size_t length) const
+{
+    if(offset >= impl->file_size)
+    {
+        return {};
+    }
+
+    return { impl->data + offset, std::min(length, impl->file_size - offset) };
+}
+} // namespace audiotag
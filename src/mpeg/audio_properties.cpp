@@ -0,0 +1,368 @@
+#include <audiotag/byte_conversions.hpp>
+#include <audiotag/mpeg/audio_properties.hpp>
+#include <audiotag/read_planner.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace audiotag::MPEG
+{
+namespace
+{
+// kbit/s by [MPEG1, MPEG2/2.5][layer 1, 2, 3][bitrate index 1 to 14]
+constexpr std::uint16_t bitrates[2][3][14] = {
+    {
+        { 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+    },
+    {
+        { 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+        { 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+    },
+};
+
+// Hz by [MPEG1, MPEG2, MPEG2.5][sample rate index]
+constexpr std::uint32_t sample_rates[3][3] = {
+    { 44100, 48000, 32000 },
+    { 22050, 24000, 16000 },
+    { 11025, 12000, 8000 },
+};
+
+constexpr std::size_t max_sync_search{ 64 * 1024 };
+constexpr std::size_t sync_scan_chunk{ 4096 };
+constexpr std::size_t sampled_frames{ 16 };
+
+struct LocatedFrame
+{
+    std::size_t offset;
+    FrameHeader header;
+};
+
+struct VbrInfo
+{
+    VbrHeader type{ VbrHeader::None };
+    std::uint32_t frames{ 0 };
+    std::uint32_t bytes{ 0 };
+    std::uint16_t encoder_delay{ 0 };
+    std::uint16_t encoder_padding{ 0 };
+};
+
+bool same_stream(const FrameHeader &lhs, const FrameHeader &rhs)
+{
+    return lhs.version == rhs.version && lhs.layer == rhs.layer &&
+           lhs.sample_rate == rhs.sample_rate;
+}
+
+bool has_sync(const unsigned char *data)
+{
+    return data[0] == 0xFF && (data[1] & 0xE0) == 0xE0;
+}
+
+bool matches(std::span<const std::byte> data, std::size_t offset, const char (&id)[5])
+{
+    return data.size() >= offset + 4 && std::memcmp(data.data() + offset, id, 4) == 0;
+}
+
+// The first header that is followed by another frame of the same stream, which
+// rules out sync words that happen to appear in leftover tag or junk data
+std::optional<LocatedFrame> find_first_frame(
+    ReadPlanner &planner, std::size_t audio_begin, std::size_t audio_end)
+{
+    const auto search_end = std::min(audio_end, audio_begin + max_sync_search);
+
+    auto offset = audio_begin;
+    while(offset + FrameHeaderSize <= search_end)
+    {
+        const auto chunk = planner.read(offset, std::min(sync_scan_chunk, search_end - offset));
+        if(chunk.size() < FrameHeaderSize)
+        {
+            break;
+        }
+
+        const auto sync = find_frame_sync(chunk);
+        if(sync == chunk.size())
+        {
+            // the last byte may start a sync word continuing in the next chunk
+            offset += chunk.size() - 1;
+            continue;
+        }
+
+        const auto candidate = offset + sync;
+        offset = candidate + 1;
+
+        const auto header = parse_frame_header(planner.read(candidate, FrameHeaderSize));
+        if(!header)
+        {
+            continue;
+        }
+
+        const auto next = candidate + header->frame_size;
+        if(next + FrameHeaderSize > audio_end)
+        {
+            return LocatedFrame{ candidate, *header };
+        }
+
+        const auto next_header = parse_frame_header(planner.read(next, FrameHeaderSize));
+        if(next_header && same_stream(*header, *next_header))
+        {
+            return LocatedFrame{ candidate, *header };
+        }
+    }
+
+    return std::nullopt;
+}
+
+VbrInfo read_vbr_info(std::span<const std::byte> frame, const FrameHeader &header)
+{
+    const auto mono = header.channel_mode == ChannelMode::Mono;
+    const std::size_t side_info = header.version == Version::MPEG1 ? (mono ? 17 : 32)
+                                                                   : (mono ? 9 : 17);
+    const auto xing_offset = FrameHeaderSize + side_info;
+
+    if(matches(frame, xing_offset, "Xing") || matches(frame, xing_offset, "Info"))
+    {
+        if(frame.size() < xing_offset + 8)
+        {
+            return {};
+        }
+
+        VbrInfo info{};
+        info.type = matches(frame, xing_offset, "Xing") ? VbrHeader::Xing : VbrHeader::Info;
+
+        const auto flags = to_u32_be(frame.subspan(xing_offset + 4, 4));
+        auto offset = xing_offset + 8;
+
+        const auto read_field = [&frame, &offset](std::uint32_t &field) {
+            if(frame.size() >= offset + 4)
+            {
+                field = to_u32_be(frame.subspan(offset, 4));
+            }
+            offset += 4;
+        };
+
+        if(flags & 0x1)
+        {
+            read_field(info.frames);
+        }
+        if(flags & 0x2)
+        {
+            read_field(info.bytes);
+        }
+        offset += (flags & 0x4) ? 100 : 0; // seek table
+        offset += (flags & 0x8) ? 4 : 0; // quality
+
+        // LAME and the libavcodec writers share the tag layout, delay and padding are
+        // two 12 bit values 21 bytes in
+        if((matches(frame, offset, "LAME") || matches(frame, offset, "Lavc")) &&
+            frame.size() >= offset + 24)
+        {
+            const auto gapless = std::to_integer<std::uint32_t>(frame[offset + 21]) << 16 |
+                                 std::to_integer<std::uint32_t>(frame[offset + 22]) << 8 |
+                                 std::to_integer<std::uint32_t>(frame[offset + 23]);
+            info.encoder_delay = static_cast<std::uint16_t>(gapless >> 12);
+            info.encoder_padding = static_cast<std::uint16_t>(gapless & 0xFFF);
+        }
+
+        return info;
+    }
+
+    // VBRI always sits 32 bytes after the frame header
+    constexpr std::size_t vbri_offset{ FrameHeaderSize + 32 };
+    if(matches(frame, vbri_offset, "VBRI") && frame.size() >= vbri_offset + 18)
+    {
+        return VbrInfo{
+            .type = VbrHeader::VBRI,
+            .frames = to_u32_be(frame.subspan(vbri_offset + 14, 4)),
+            .bytes = to_u32_be(frame.subspan(vbri_offset + 10, 4)),
+        };
+    }
+
+    return {};
+}
+} // namespace
+
+std::optional<FrameHeader> parse_frame_header(std::span<const std::byte> data)
+{
+    if(data.size() < FrameHeaderSize ||
+        !has_sync(reinterpret_cast<const unsigned char *>(data.data())))
+    {
+        return std::nullopt;
+    }
+
+    const auto b1 = std::to_integer<std::uint8_t>(data[1]);
+    const auto b2 = std::to_integer<std::uint8_t>(data[2]);
+    const auto b3 = std::to_integer<std::uint8_t>(data[3]);
+
+    const auto version_bits = b1 >> 3 & 0x3;
+    const auto layer_bits = b1 >> 1 & 0x3;
+    const auto bitrate_index = b2 >> 4;
+    const auto sample_rate_index = b2 >> 2 & 0x3;
+
+    // reserved version, layer and sample rate, free format and the invalid bitrate
+    if(version_bits == 1 || layer_bits == 0 || bitrate_index == 0 || bitrate_index == 15 ||
+        sample_rate_index == 3)
+    {
+        return std::nullopt;
+    }
+
+    const auto version = version_bits == 3 ? Version::MPEG1
+                         : version_bits == 2 ? Version::MPEG2
+                                             : Version::MPEG25;
+    const std::uint8_t layer = 4 - layer_bits;
+    const auto mpeg1 = version == Version::MPEG1;
+
+    const std::uint32_t bitrate = bitrates[mpeg1 ? 0 : 1][layer - 1][bitrate_index - 1];
+    const auto sample_rate = sample_rates[static_cast<int>(version)][sample_rate_index];
+    const auto padding = (b2 >> 1 & 0x1) != 0;
+
+    const std::uint32_t samples = layer == 1 ? 384 : (layer == 3 && !mpeg1 ? 576 : 1152);
+    const auto frame_size = layer == 1
+                                ? (12 * bitrate * 1000 / sample_rate + padding) * 4
+                                : samples / 8 * bitrate * 1000 / sample_rate + padding;
+
+    return FrameHeader{
+        .version = version,
+        .layer = layer,
+        .bitrate = bitrate,
+        .sample_rate = sample_rate,
+        .channel_mode = static_cast<ChannelMode>(b3 >> 6),
+        .padding = padding,
+        .frame_size = frame_size,
+        .samples = samples,
+    };
+}
+
+std::size_t find_frame_sync(std::span<const std::byte> data)
+{
+    const auto *src = reinterpret_cast<const unsigned char *>(data.data());
+    const auto size = data.size();
+    std::size_t i{ 0 };
+
+#if defined(__SSE2__)
+    // compare every byte with 0xFF and the byte after it against the top three bits
+    for(; i + 17 <= size; i += 16)
+    {
+        const auto current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const auto next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 1));
+        const auto high_bits = _mm_set1_epi8(static_cast<char>(0xE0));
+
+        const auto sync = _mm_and_si128(_mm_cmpeq_epi8(current, _mm_set1_epi8(-1)),
+            _mm_cmpeq_epi8(_mm_and_si128(next, high_bits), high_bits));
+        if(const auto mask = static_cast<unsigned>(_mm_movemask_epi8(sync)); mask != 0)
+        {
+            return i + std::countr_zero(mask);
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for(; i + 17 <= size; i += 16)
+    {
+        const auto current = vld1q_u8(src + i);
+        const auto next = vld1q_u8(src + i + 1);
+        const auto high_bits = vdupq_n_u8(0xE0);
+
+        const auto sync = vandq_u8(
+            vceqq_u8(current, vdupq_n_u8(0xFF)), vceqq_u8(vandq_u8(next, high_bits), high_bits));
+        if(vmaxvq_u8(sync) != 0)
+        {
+            break;
+        }
+    }
+#endif
+
+    for(; i + 1 < size; ++i)
+    {
+        if(has_sync(src + i))
+        {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+std::optional<AudioProperties> read_audio_properties(
+    ReadPlanner &planner, std::size_t audio_begin, std::size_t audio_end)
+{
+    const auto first = find_first_frame(planner, audio_begin, audio_end);
+    if(!first)
+    {
+        return std::nullopt;
+    }
+
+    const auto &header = first->header;
+    auto properties = AudioProperties{
+        .version = header.version,
+        .layer = header.layer,
+        .sample_rate = header.sample_rate,
+        .channel_mode = header.channel_mode,
+        .bitrate = header.bitrate,
+        .frame_count = 0,
+        .duration = {},
+        .vbr_header = VbrHeader::None,
+        .encoder_delay = 0,
+        .encoder_padding = 0,
+    };
+
+    const std::uint64_t audio_size = audio_end - first->offset;
+
+    const auto vbr = read_vbr_info(planner.read(first->offset, header.frame_size), header);
+    if(vbr.type != VbrHeader::None && vbr.frames != 0)
+    {
+        const auto bytes = vbr.bytes != 0 ? std::uint64_t{ vbr.bytes } : audio_size;
+        const auto duration_ms = std::uint64_t{ vbr.frames } * header.samples * 1000 /
+                                 header.sample_rate;
+
+        properties.frame_count = vbr.frames;
+        properties.duration = std::chrono::milliseconds(duration_ms);
+        properties.vbr_header = vbr.type;
+        properties.encoder_delay = vbr.encoder_delay;
+        properties.encoder_padding = vbr.encoder_padding;
+
+        // bits per millisecond is kbit/s
+        if(duration_ms != 0)
+        {
+            properties.bitrate = static_cast<std::uint32_t>(bytes * 8 / duration_ms);
+        }
+
+        return properties;
+    }
+
+    // no header, sample the leading frames and extrapolate over the audio size
+    std::uint64_t bitrate_sum{ 0 };
+    std::uint64_t size_sum{ 0 };
+    std::size_t frames{ 0 };
+
+    auto offset = first->offset;
+    while(frames < sampled_frames && offset + FrameHeaderSize <= audio_end)
+    {
+        const auto frame = parse_frame_header(planner.read(offset, FrameHeaderSize));
+        if(!frame || !same_stream(header, *frame))
+        {
+            break;
+        }
+
+        bitrate_sum += frame->bitrate;
+        size_sum += frame->frame_size;
+        offset += frame->frame_size;
+        ++frames;
+    }
+
+    const auto average_bitrate = bitrate_sum / frames;
+
+    properties.bitrate = static_cast<std::uint32_t>(average_bitrate);
+    properties.frame_count = audio_size * frames / size_sum;
+    properties.duration = std::chrono::milliseconds(audio_size * 8 / average_bitrate);
+
+    return properties;
+}
+} // namespace audiotag::MPEG
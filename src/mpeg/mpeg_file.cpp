@@ -1,152 +1,371 @@
+#include "../id3v2_frames.hpp"
+
 #include <audiotag/byte_conversions.hpp>
+#include <audiotag/mpeg/audio_properties.hpp>
 #include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/read_planner.hpp>
 #include <audiotag/reader.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <optional>
 #include <vector>
 
 namespace audiotag
 {
+static constexpr ID3v2::FrameId SeekFrameId{ ID3v2::to_frame_id("SEEK") };
+
 MpegFile::MpegFile(audiotag::Reader &reader)
+: MpegFile(reader, ReadOptions{})
+{
+}
+
+MpegFile::MpegFile(audiotag::Reader &reader, const ID3v2::FrameFilter &filter)
+: MpegFile(reader, ReadOptions{ .id3v2_filter = filter, .audio_properties = false })
+{
+}
+
+MpegFile::MpegFile(audiotag::Reader &reader, const ReadOptions &options)
+{
+    ReadPlanner planner{ reader };
+    read(planner, options);
+}
+
+MpegFile::MpegFile(ReadPlanner &planner)
+: MpegFile(planner, ReadOptions{})
+{
+}
+
+MpegFile::MpegFile(ReadPlanner &planner, const ID3v2::FrameFilter &filter)
+: MpegFile(planner, ReadOptions{ .id3v2_filter = filter, .audio_properties = false })
 {
-    id3v2_tags = read_id3v2(reader);
-    id3v1_tags = read_id3v1(reader);
 }
 
-const std::optional<ID3v1::Tags> &MpegFile::id3v1()
+MpegFile::MpegFile(ReadPlanner &planner, const ReadOptions &options)
+{
+    read(planner, options);
+}
+
+void MpegFile::read(ReadPlanner &planner, const ReadOptions &options)
+{
+    const auto &filter = options.id3v2_filter;
+
+    id3v2_tags = read_id3v2(planner, filter, 0);
+    audio_begin = id3v2_tags ? ID3v2::tag_extent(id3v2_tags->getHeader()) : 0;
+
+    // tags at the end are peeled off back to front, each one moving the audio end
+    audio_end = planner.length();
+    id3v1_tags = read_id3v1(planner);
+    if(id3v1_tags)
+    {
+        audio_end -= ID3v1::TagSize;
+    }
+
+    ape_tags = read_ape(planner);
+    id3v2_appended_tags = read_appended_id3v2(planner, filter);
+
+    if(options.audio_properties)
+    {
+        properties =
+            MPEG::read_audio_properties(planner, audio_begin, std::max(audio_begin, audio_end));
+    }
+}
+
+const std::optional<ID3v1::Tags> &MpegFile::id3v1() const
 {
     return id3v1_tags;
 }
 
-const std::optional<ID3v2::Tags> &MpegFile::id3v2()
+const std::optional<ID3v2::TagsView> &MpegFile::id3v2() const
 {
     return id3v2_tags;
 }
 
-std::optional<ID3v2::Tags> MpegFile::read_id3v2(Reader &reader)
+const std::optional<ID3v2::TagsView> &MpegFile::id3v2_appended() const
 {
-    constexpr std::size_t header_size{ 10 };
-    std::byte header[header_size]{};
+    return id3v2_appended_tags;
+}
 
-    const std::size_t header_bytes_read = reader.read(header);
-    if(header_bytes_read != header_size)
+const std::optional<APE::Tags> &MpegFile::ape() const
+{
+    return ape_tags;
+}
+
+ReadPlanner::Range MpegFile::audio_range() const
+{
+    return { audio_begin, std::max(audio_begin, audio_end) - audio_begin };
+}
+
+const std::optional<MPEG::AudioProperties> &MpegFile::audio_properties() const
+{
+    return properties;
+}
+
+std::optional<ID3v2::TagsView> MpegFile::read_id3v2(
+    ReadPlanner &planner, const ID3v2::FrameFilter &filter, std::size_t tag_offset)
+{
+    auto header =
+        ID3v2::parse_header(planner.read(tag_offset, ID3v2::HeaderSize), ID3v2::Identifier);
+    if(!header)
     {
         return std::nullopt;
     }
 
-    auto header_span = std::span(header);
-    const auto header_tag = header_span.subspan(0, 3);
-    if(std::memcmp(ID3v2::Identifier, header_tag.data(), header_tag.size()) != 0)
+    const auto synch_safe_size = header->version_major >= 4;
+    const auto synch_size = header->size;
+    const auto body_offset = tag_offset + ID3v2::HeaderSize;
+
+    // make sure the tag fits in the file
+    if(synch_size > planner.length() - std::min(body_offset, planner.length()))
     {
         return std::nullopt;
     }
 
-    const auto version_span = header_span.subspan(3, 2);
-    const auto version_major = std::to_integer<std::uint8_t>(version_span[0]);
-    const auto version_revision = std::to_integer<std::uint8_t>(version_span[1]);
+    // the SEEK frame of a leading v2.4 tag locates the next one, so it is kept
+    // whichever frames the filter selects, but only when the parse passes it
+    const auto keep_seek = tag_offset == 0 && header->version_major >= 4;
 
-    const auto synch_safe_size = version_major >= 4;
-    const auto flags_span = header_span.subspan(5, 1);
+    // frame sizes of a tag unsynchronized as a whole are only known after decoding it
+    if(!filter.empty() && !ID3v2::tag_unsynchronized(*header))
+    {
+        return read_id3v2_frames(planner, std::move(*header), filter, tag_offset, keep_seek);
+    }
 
-    const auto size = header_span.subspan(6, 4);
-    const auto synch_size = to_synch_uint32_t(size);
+    // the whole tag body lands in one buffer that every frame borrows from
+    auto buffer = std::make_shared_for_overwrite<std::byte[]>(synch_size);
+    auto frames_span = std::span<std::byte>(buffer.get(), synch_size);
 
-    // make sure synch_size is smaller than file size
-    if(synch_size >= reader.length())
+    if(planner.read_into(body_offset, frames_span) != synch_size)
     {
         return std::nullopt;
     }
 
-    std::vector<std::byte> frames(synch_size);
+    // decoding shrinks the data in place, no second copy of the tag is made
+    if(ID3v2::tag_unsynchronized(*header))
+    {
+        frames_span = ID3v2::decode_unsynchronized(frames_span);
+    }
 
-    const std::size_t frames_bytes_read = reader.read(frames);
-    if(frames_bytes_read != synch_size)
+    std::vector<ID3v2::FrameView> frames;
+
+    auto offset =
+        std::min(ID3v2::extended_header_size(frames_span, *header), frames_span.size());
+    while(const auto frame_header = ID3v2::parse_frame_header(
+              frames_span.subspan(offset), synch_safe_size, frames_span.size() - offset))
     {
-        return std::nullopt;
+        auto data = frames_span.subspan(offset + ID3v2::FrameHeaderSize, frame_header->size);
+        offset += ID3v2::FrameHeaderSize + frame_header->size;
+
+        if(const auto frame_id = ID3v2::to_frame_id(frame_header->id);
+            !filter.empty() && !filter.contains(frame_id) &&
+            !(keep_seek && frame_id == SeekFrameId))
+        {
+            continue;
+        }
+
+        if(ID3v2::frame_unsynchronized(*header, *frame_header))
+        {
+            data = ID3v2::decode_unsynchronized(data);
+        }
+        frames.push_back(ID3v2::make_frame_view(*header, *frame_header, data));
     }
 
-    const auto frames_span = std::span(frames);
+    return ID3v2::TagsView(std::move(*header), std::move(buffer), std::move(frames));
+}
 
-    struct SpanFrame
+std::optional<ID3v2::TagsView> MpegFile::read_id3v2_frames(ReadPlanner &planner,
+    ID3v2::Header &&header,
+    const ID3v2::FrameFilter &filter,
+    std::size_t tag_offset,
+    bool keep_seek)
+{
+    const auto synch_safe_size = header.version_major >= 4;
+    const std::size_t tag_end = tag_offset + ID3v2::HeaderSize + header.size;
+
+    struct SelectedFrame
     {
-        std::array<std::byte, 4> id;
-        std::uint16_t flags;
-        std::span<std::byte> data_span;
+        ID3v2::FrameHeader header;
+        std::size_t offset;
     };
 
-    std::vector<SpanFrame> span_frames;
+    std::vector<SelectedFrame> selected;
+    // tags with alternative ids (YEAR as TDRC or TYER) are satisfied by either
+    std::vector<bool> found(filter.group_count());
+    std::size_t found_count{ 0 };
 
-    std::size_t offset{ 0 };
-    while(offset < synch_size)
+    // walk frame headers only, skipping over the payloads of unwanted frames
+    std::size_t offset{ tag_offset + ID3v2::HeaderSize };
+    offset = std::min(
+        offset + ID3v2::extended_header_size(planner.read(offset, 4), header), tag_end);
+    while(found_count < found.size())
     {
-        const auto frame_id = frames_span.subspan(offset, 4);
-        if(frame_id[0] == std::byte{ '\0' })
+        const auto frame_header = ID3v2::parse_frame_header(
+            planner.read(offset, ID3v2::FrameHeaderSize), synch_safe_size, tag_end - offset);
+        if(!frame_header)
         {
             break;
         }
 
-        const auto frame_size_span = frames_span.subspan(offset + 4, 4);
-        const auto frame_size =
-            synch_safe_size ? to_synch_uint32_t(frame_size_span) : to_u32_be(frame_size_span);
-        const auto frame_flags = frames_span.subspan(offset + 8, 2);
-        const auto frame_flags_int = to_u16_be(frame_flags);
+        const auto frame_id = ID3v2::to_frame_id(frame_header->id);
+        if(const auto group = filter.group(frame_id); group < found.size())
+        {
+            selected.push_back({ *frame_header, offset + ID3v2::FrameHeaderSize });
+
+            if(!found[group])
+            {
+                found[group] = true;
+                ++found_count;
+            }
+        }
+        else if(keep_seek && frame_id == SeekFrameId)
+        {
+            // most tags have no SEEK, waiting for one would walk every header
+            selected.push_back({ *frame_header, offset + ID3v2::FrameHeaderSize });
+        }
+
+        offset += ID3v2::FrameHeaderSize + frame_header->size;
+    }
+
+    std::size_t buffer_size{ 0 };
+    for(const auto &frame : selected)
+    {
+        buffer_size += frame.header.size;
+    }
+
+    // only the selected payloads are read, back to back into one buffer
+    auto buffer = std::make_shared_for_overwrite<std::byte[]>(buffer_size);
+    const auto buffer_span = std::span<std::byte>(buffer.get(), buffer_size);
 
-        constexpr auto frame_header_size = 10u;
+    std::vector<ID3v2::FrameView> frames;
+    frames.reserve(selected.size());
 
-        span_frames.emplace_back(SpanFrame{
-            .id = { frame_id[0], frame_id[1], frame_id[2], frame_id[3] },
-            .flags = frame_flags_int,
-            .data_span = frames_span.subspan(offset + frame_header_size, frame_size),
-        });
+    std::size_t buffer_offset{ 0 };
+    for(const auto &frame : selected)
+    {
+        auto data = buffer_span.subspan(buffer_offset, frame.header.size);
+        if(planner.read_into(frame.offset, data) != data.size())
+        {
+            return std::nullopt;
+        }
+        buffer_offset += data.size();
 
-        offset += frame_size + frame_header_size;
+        if(ID3v2::frame_unsynchronized(header, frame.header))
+        {
+            data = ID3v2::decode_unsynchronized(data);
+        }
+        frames.push_back(ID3v2::make_frame_view(header, frame.header, data));
     }
 
-    std::vector<ID3v2::TagFrame> tag_frames;
-    tag_frames.reserve(span_frames.size());
+    return ID3v2::TagsView(std::move(header), std::move(buffer), std::move(frames));
+}
 
-    for(const auto &span_frame : span_frames)
+std::optional<ID3v2::TagsView> MpegFile::read_appended_id3v2(
+    ReadPlanner &planner, const ID3v2::FrameFilter &filter)
+{
+    // an appended tag ends right before ID3v1, both probes land in the tail window
+    const auto footer_end = audio_end;
+    if(footer_end >= 2 * ID3v2::HeaderSize)
     {
-        std::vector<std::byte> frame_data(span_frame.data_span.size());
+        const auto footer_span = planner.read(footer_end - ID3v2::HeaderSize, ID3v2::HeaderSize);
+        const auto footer = ID3v2::parse_header(footer_span, ID3v2::FooterIdentifier);
+        const auto tag_size = footer ? 2 * ID3v2::HeaderSize + footer->size : 0;
 
-        std::memcpy(frame_data.data(), span_frame.data_span.data(), span_frame.data_span.size());
+        if(footer && footer->version_major >= 4 && tag_size <= footer_end)
+        {
+            // a tag that is both leading and appended was already read as the leading one
+            const auto tag_offset = footer_end - tag_size;
+            if(tag_offset == 0)
+            {
+                return std::nullopt;
+            }
+
+            auto tags = read_id3v2(planner, filter, tag_offset);
+            if(tags)
+            {
+                audio_end = tag_offset;
+            }
+            return tags;
+        }
+    }
+
+    if(!id3v2_tags)
+    {
+        return std::nullopt;
+    }
 
-        tag_frames.emplace_back(ID3v2::TagFrame{
-            .id = span_frame.id,
-            .data = std::move(frame_data),
-        });
+    // SEEK holds the distance from the end of the leading tag to the next one
+    const auto *seek = id3v2_tags->findFrame(SeekFrameId);
+    if(seek == nullptr || seek->data.size() < 4)
+    {
+        return std::nullopt;
     }
 
-    return ID3v2::Tags(
-        ID3v2::Header{
-            .version_major = version_major,
-            .version_revision = version_revision,
-        },
-        std::move(tag_frames));
+    const auto next_tag = ID3v2::tag_extent(id3v2_tags->getHeader()) + to_u32_be(seek->data);
+    auto tags = read_id3v2(planner, filter, next_tag);
+
+    // a tag between audio frames leaves the range alone, a single range cannot skip it
+    if(tags && next_tag + ID3v2::tag_extent(tags->getHeader()) == audio_end)
+    {
+        audio_end = next_tag;
+    }
+    return tags;
 }
 
-std::optional<ID3v1::Tags> MpegFile::read_id3v1(Reader &reader)
+std::optional<APE::Tags> MpegFile::read_ape(ReadPlanner &planner)
 {
-    constexpr auto id3v1_tag_size = 128u;
+    // like the ID3v1 probe the footer read is served from the tail window
+    const auto footer_end = audio_end;
+    if(footer_end < APE::FooterSize)
+    {
+        return std::nullopt;
+    }
+
+    const auto footer_span = planner.read(footer_end - APE::FooterSize, APE::FooterSize);
+    const auto footer = APE::parse_footer(footer_span);
+    if(!footer || footer->size > footer_end)
+    {
+        return std::nullopt;
+    }
 
-    std::vector<std::byte> buffer(id3v1_tag_size);
+    const std::size_t items_size = footer->size - APE::FooterSize;
+    auto buffer = std::make_shared_for_overwrite<std::byte[]>(items_size);
 
-    reader.seek(reader.length() - id3v1_tag_size);
+    const auto items_span = std::span<std::byte>(buffer.get(), items_size);
+    if(planner.read_into(footer_end - footer->size, items_span) != items_size)
+    {
+        return std::nullopt;
+    }
+
+    audio_end = footer_end - footer->size;
+    if(footer->has_header)
+    {
+        audio_end -= std::min<std::size_t>(APE::FooterSize, audio_end);
+    }
+
+    return APE::Tags(*footer, std::move(buffer), items_size);
+}
+
+std::optional<ID3v1::Tags> MpegFile::read_id3v1(ReadPlanner &planner)
+{
+    if(planner.length() < ID3v1::TagSize)
+    {
+        return std::nullopt;
+    }
 
-    const auto bytes_read = reader.read(buffer);
-    if(bytes_read != id3v1_tag_size)
+    const auto tags = planner.read(planner.length() - ID3v1::TagSize, ID3v1::TagSize);
+    if(tags.size() != ID3v1::TagSize)
     {
         return std::nullopt;
     }
 
-    if(std::memcmp(ID3v1::Identifier, buffer.data(), sizeof(ID3v1::Identifier)) != 0)
+    if(std::memcmp(ID3v1::Identifier, tags.data(), sizeof(ID3v1::Identifier)) != 0)
     {
         return std::nullopt;
     }
 
-    const auto tags = std::span(buffer);
     const auto is_id3v11 = (tags[125] == std::byte{ 0 } && tags[126] != std::byte{ 0 });
     const auto comment_size = is_id3v11 ? 28 : 30;
 
@@ -0,0 +1,182 @@
+#include "audiotag/read_planner.hpp"
+
+#include "audiotag/reader.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audiotag
+{
+namespace
+{
+constexpr std::size_t default_window_size{ 4096 };
+constexpr std::size_t max_window_size{ 256 * 1024 };
+
+std::size_t window_size_for(std::size_t buffer_size)
+{
+    return buffer_size == 0 ? default_window_size : std::min(buffer_size, max_window_size);
+}
+} // namespace
+
+ReadPlanner::ReadPlanner(const Reader &reader)
+: reader{ reader }
+, file_length{ reader.length() }
+, window{ window_size_for(reader.buffer_size()) }
+{
+    // readers lending their storage need no windows at all
+    if(const auto view = reader.view(0, file_length); view.size() == file_length && file_length > 0)
+    {
+        windows.push_back({ 0, view });
+        return;
+    }
+
+    for(const auto &range : plan(file_length, reader.buffer_size()))
+    {
+        fetch(range.offset, range.length);
+    }
+}
+
+ReadPlanner::ReadPlanner(const Reader &reader, std::vector<Prefetched> &&prefetched)
+: reader{ reader }
+, file_length{ reader.length() }
+, window{ window_size_for(reader.buffer_size()) }
+{
+    for(auto &window : prefetched)
+    {
+        const auto &buffer = storage.emplace_back(std::move(window.data));
+        windows.push_back({ window.offset, buffer });
+    }
+}
+
+std::vector<ReadPlanner::Range> ReadPlanner::plan(std::size_t length, std::size_t buffer_size)
+{
+    const auto window = window_size_for(buffer_size);
+
+    // head and tail windows that touch or are less than a window apart are
+    // cheaper to fetch as one contiguous read than as two round trips
+    if(length <= 3 * window)
+    {
+        return { { 0, length } };
+    }
+
+    return { { 0, window }, { length - window, window } };
+}
+
+std::size_t ReadPlanner::length() const
+{
+    return file_length;
+}
+
+std::size_t ReadPlanner::window_size() const
+{
+    return window;
+}
+
+std::size_t ReadPlanner::read_count() const
+{
+    return reads;
+}
+
+std::span<const std::byte> ReadPlanner::read(std::size_t offset, std::size_t length)
+{
+    if(offset >= file_length)
+    {
+        return {};
+    }
+
+    length = std::min(length, file_length - offset);
+
+    const auto *covering = find_window(offset);
+    if(covering != nullptr)
+    {
+        const auto window_offset = offset - covering->offset;
+        if(covering->data.size() - window_offset >= length)
+        {
+            return covering->data.subspan(window_offset, length);
+        }
+    }
+
+    // the range extends past the windows, read ahead by a window so that
+    // small probes following this one are served without another read; the
+    // reader may come back short, e.g. when the file shrank since length()
+    const auto fetched = fetch(offset, std::max(length, window));
+    return fetched.first(std::min(length, fetched.size()));
+}
+
+std::size_t ReadPlanner::read_into(std::size_t offset, std::span<std::byte> buffer)
+{
+    if(offset >= file_length)
+    {
+        return 0;
+    }
+
+    buffer = buffer.first(std::min(buffer.size(), file_length - offset));
+
+    std::size_t copied{ 0 };
+    while(copied < buffer.size())
+    {
+        const auto *covering = find_window(offset + copied);
+        if(covering == nullptr)
+        {
+            break;
+        }
+
+        const auto window_offset = offset + copied - covering->offset;
+        const auto chunk = std::min(buffer.size() - copied, covering->data.size() - window_offset);
+        std::memcpy(buffer.data() + copied, covering->data.data() + window_offset, chunk);
+        copied += chunk;
+    }
+
+    if(copied < buffer.size())
+    {
+        ++reads;
+        copied += reader.read_at(offset + copied, buffer.subspan(copied));
+    }
+
+    return copied;
+}
+
+const ReadPlanner::Window *ReadPlanner::find_window(std::size_t offset) const
+{
+    // of the windows containing offset pick the one reaching furthest past it
+    const Window *covering{ nullptr };
+    for(const auto &window : windows)
+    {
+        const auto end = window.offset + window.data.size();
+        if(offset >= window.offset && offset < end &&
+            (covering == nullptr || end > covering->offset + covering->data.size()))
+        {
+            covering = &window;
+        }
+    }
+
+    return covering;
+}
+
+std::span<const std::byte> ReadPlanner::fetch(std::size_t offset, std::size_t length)
+{
+    length = std::min(length, file_length - offset);
+
+    auto &buffer = storage.emplace_back(length);
+
+    // reuse whatever prefix of the range is already buffered and read only the rest
+    std::size_t prefix{ 0 };
+    if(const auto *covering = find_window(offset); covering != nullptr)
+    {
+        prefix = std::min(length, covering->data.size() - (offset - covering->offset));
+        std::memcpy(buffer.data(), covering->data.data() + (offset - covering->offset), prefix);
+    }
+
+    std::size_t bytes_read{ 0 };
+    if(prefix < length)
+    {
+        ++reads;
+        bytes_read = reader.read_at(offset + prefix, std::span(buffer).subspan(prefix));
+    }
+
+    buffer.resize(prefix + bytes_read);
+    windows.push_back({ offset, buffer });
+
+    return buffer;
+}
+} // namespace audiotag
@@ -0,0 +1,707 @@
+#include "audiotag/retag.hpp"
+
+#include "audiotag/content_hash.hpp"
+#include "audiotag/mpeg/mpeg_file.hpp"
+#include "file_io.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+namespace audiotag
+{
+namespace
+{
+// Journal layout: the magic, then records of
+//   u32 payload size, u64 XXH64 of the payload, payload
+// all little endian. A begin payload is the type, the entry number and the
+// path, old tag, new tag and temporary file of a rewrite, each prefixed by its
+// u32 size; a commit payload is the type and the entry number. A torn tail fails
+// its checksum and ends the journal.
+constexpr std::array<std::byte, 4> JournalMagic{
+    std::byte{ 'A' },
+    std::byte{ 'T' },
+    std::byte{ 'J' },
+    std::byte{ '1' },
+};
+
+enum class RecordType : std::uint8_t
+{
+    Begin = 1,
+    Commit = 2,
+};
+
+[[noreturn]] void throw_errno(const char *what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void append_u32_le(std::vector<std::byte> &out, std::uint32_t value)
+{
+    for(int shift = 0; shift < 32; shift += 8)
+    {
+        out.push_back(std::byte(value >> shift));
+    }
+}
+
+void append_u64_le(std::vector<std::byte> &out, std::uint64_t value)
+{
+    for(int shift = 0; shift < 64; shift += 8)
+    {
+        out.push_back(std::byte(value >> shift));
+    }
+}
+
+void append_sized(std::vector<std::byte> &out, std::span<const std::byte> data)
+{
+    append_u32_le(out, static_cast<std::uint32_t>(data.size()));
+    out.insert(out.end(), data.begin(), data.end());
+}
+
+std::uint64_t to_u64_le(std::span<const std::byte> data)
+{
+    return static_cast<std::uint64_t>(to_u32_le(data.subspan(4, 4))) << 32 | to_u32_le(data);
+}
+
+class Journal
+{
+public:
+    explicit Journal(const std::string &path)
+    : path{ path }
+    , file{ open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644) }
+    {
+        if(file.get() < 0)
+        {
+            throw_errno("Couldn't create journal");
+        }
+
+        write_fully(file.get(), JournalMagic, 0);
+        size = JournalMagic.size();
+
+        // a journal lost with its directory entry would leave in place writes
+        // that recovery never finds
+        sync_parent_directory(path);
+    }
+
+    std::uint32_t begin(std::string_view file_path,
+        std::span<const std::byte> before,
+        std::span<const std::byte> after,
+        std::string_view temporary)
+    {
+        const std::lock_guard lock{ mutex };
+        const auto entry = next_entry++;
+
+        std::vector<std::byte> payload;
+        payload.reserve(1 + 4 + 4 * 4 + file_path.size() + before.size() + after.size() +
+                        temporary.size());
+        payload.push_back(std::byte(RecordType::Begin));
+        append_u32_le(payload, entry);
+        append_sized(payload, std::as_bytes(std::span(file_path.data(), file_path.size())));
+        append_sized(payload, before);
+        append_sized(payload, after);
+        append_sized(payload, std::as_bytes(std::span(temporary.data(), temporary.size())));
+        append(payload);
+
+        ++open_entries;
+        return entry;
+    }
+
+    void commit(std::uint32_t entry)
+    {
+        const std::lock_guard lock{ mutex };
+
+        std::vector<std::byte> payload;
+        payload.push_back(std::byte(RecordType::Commit));
+        append_u32_le(payload, entry);
+        append(payload);
+
+        --open_entries;
+    }
+
+    // Makes every record appended so far durable. Workers calling it together
+    // share one fdatasync: whoever syncs first covers the records of the others.
+    void sync()
+    {
+        const std::lock_guard sync_lock{ sync_mutex };
+
+        std::size_t target{ 0 };
+        {
+            const std::lock_guard lock{ mutex };
+            target = size;
+        }
+
+        if(synced >= target)
+        {
+            return;
+        }
+
+        if(fdatasync(file.get()) != 0)
+        {
+            throw_errno("Couldn't sync journal");
+        }
+        synced = target;
+    }
+
+    // Removes the journal when every begun edit committed
+    void finish()
+    {
+        sync();
+        if(open_entries == 0)
+        {
+            unlink(path.c_str());
+            sync_parent_directory(path);
+        }
+    }
+
+private:
+    void append(std::span<const std::byte> payload)
+    {
+        std::vector<std::byte> record;
+        record.reserve(12 + payload.size());
+        append_u32_le(record, static_cast<std::uint32_t>(payload.size()));
+        append_u64_le(record, Xxh64::hash(payload));
+        record.insert(record.end(), payload.begin(), payload.end());
+
+        write_fully(file.get(), record, static_cast<off_t>(size));
+        size += record.size();
+    }
+
+private:
+    std::string path;
+    FileDescriptor file;
+    std::mutex mutex;
+    std::mutex sync_mutex;
+    std::size_t size{ 0 };
+    std::size_t synced{ 0 };
+    std::uint32_t next_entry{ 0 };
+    std::size_t open_entries{ 0 };
+};
+
+// Leading ID3v2 tag of an open file, empty when there is none
+std::vector<std::byte> read_leading_tag(int file_descriptor, std::size_t file_size)
+{
+    std::array<std::byte, ID3v2::HeaderSize> header{};
+    if(read_fully(file_descriptor, header, 0) != header.size())
+    {
+        return {};
+    }
+
+    std::vector<std::byte> tag(std::min(ID3v2::tag_size(header), file_size));
+    tag.resize(read_fully(file_descriptor, tag, 0));
+    return tag;
+}
+
+struct PreparedEdit
+{
+    std::size_t index;
+    // absolute, so recovery finds the file from any working directory
+    std::string path;
+    FileDescriptor file;
+    struct stat stat;
+    std::vector<std::byte> before;
+    std::vector<std::byte> after;
+    // created before the begin record of a rewrite, which names it for recovery
+    std::optional<TemporaryFile> temporary;
+    std::uint32_t entry{ 0 };
+};
+
+class RetagBatch
+{
+public:
+    RetagBatch(std::span<const std::string> paths,
+        const RetagFunction &edit,
+        const RetagOptions &options)
+    : paths{ paths }
+    , edit{ edit }
+    , options{ options }
+    , results(paths.size())
+    {
+        if(!options.journal_path.empty())
+        {
+            journal.emplace(options.journal_path);
+        }
+    }
+
+    std::vector<RetagResult> run()
+    {
+        // files are grouped per device so one slow disk only holds up its own workers
+        std::map<dev_t, std::vector<std::size_t>> devices;
+        for(std::size_t index = 0; index < paths.size(); ++index)
+        {
+            struct stat file_stat = {};
+            if(stat(paths[index].c_str(), &file_stat) != 0)
+            {
+                results[index].error = std::error_code(errno, std::generic_category());
+                continue;
+            }
+            devices[file_stat.st_dev].push_back(index);
+        }
+
+        std::vector<std::atomic<std::size_t>> cursors(devices.size());
+        {
+            std::vector<std::jthread> workers;
+            std::size_t device_index{ 0 };
+            for(const auto &[device, indices] : devices)
+            {
+                auto &cursor = cursors[device_index++];
+                const auto thread_count = std::min<std::size_t>(
+                    std::max(options.threads_per_device, 1u), indices.size());
+
+                for(std::size_t i = 0; i < thread_count; ++i)
+                {
+                    workers.emplace_back([this, &cursor, &indices = indices] {
+                        work(cursor, indices);
+                    });
+                }
+            }
+        }
+
+        if(failure != nullptr)
+        {
+            std::rethrow_exception(failure);
+        }
+
+        if(journal)
+        {
+            journal->finish();
+        }
+
+        return std::move(results);
+    }
+
+private:
+    void work(std::atomic<std::size_t> &cursor, std::span<const std::size_t> indices)
+    {
+        const auto group_size = std::max<std::size_t>(options.group_size, 1);
+
+        try
+        {
+            while(!stopped)
+            {
+                const auto begin = cursor.fetch_add(group_size);
+                if(begin >= indices.size())
+                {
+                    return;
+                }
+
+                run_group(indices.subspan(begin, std::min(group_size, indices.size() - begin)));
+            }
+        }
+        catch(...)
+        {
+            const std::lock_guard lock{ failure_mutex };
+            if(failure == nullptr)
+            {
+                failure = std::current_exception();
+            }
+            stopped = true;
+        }
+    }
+
+    void run_group(std::span<const std::size_t> indices)
+    {
+        std::vector<PreparedEdit> edits;
+        for(const auto index : indices)
+        {
+            if(auto prepared = prepare(index))
+            {
+                edits.push_back(std::move(*prepared));
+            }
+        }
+
+        if(edits.empty())
+        {
+            return;
+        }
+
+        // the old and new tags are durable before any file is touched
+        if(journal)
+        {
+            for(auto &prepared : edits)
+            {
+                const auto temporary =
+                    prepared.temporary ? std::string_view(prepared.temporary->path()) : "";
+                prepared.entry =
+                    journal->begin(prepared.path, prepared.before, prepared.after, temporary);
+            }
+            journal->sync();
+        }
+
+        int sync_descriptor{ -1 };
+        for(auto &prepared : edits)
+        {
+            auto &result = results[prepared.index];
+            try
+            {
+                if(prepared.after.size() == prepared.before.size())
+                {
+                    write_fully(prepared.file.get(), prepared.after, 0);
+                    sync_descriptor = prepared.file.get();
+                    result.mode = ID3v2::WriteMode::InPlace;
+                }
+                else
+                {
+                    // renamed and synced along with its directory before the commit record
+                    replace_head(std::move(*prepared.temporary), prepared.file.get(),
+                        prepared.stat, prepared.after, prepared.before.size());
+                    result.mode = ID3v2::WriteMode::Rewritten;
+                }
+            }
+            catch(const std::system_error &error)
+            {
+                result.error = error.code();
+            }
+        }
+
+        // one syncfs flushes the in place writes of the whole group
+        if(sync_descriptor >= 0 && syncfs(sync_descriptor) != 0)
+        {
+            const auto error = std::error_code(errno, std::generic_category());
+            for(const auto &prepared : edits)
+            {
+                if(prepared.after.size() == prepared.before.size())
+                {
+                    results[prepared.index].error = error;
+                }
+            }
+        }
+
+        for(const auto &prepared : edits)
+        {
+            auto &result = results[prepared.index];
+            if(result.error)
+            {
+                continue;
+            }
+
+            result.changed = true;
+            if(journal)
+            {
+                journal->commit(prepared.entry);
+            }
+        }
+
+        if(journal)
+        {
+            journal->sync();
+        }
+    }
+
+    std::optional<PreparedEdit> prepare(std::size_t index)
+    {
+        auto &result = results[index];
+
+        auto path = std::filesystem::absolute(paths[index], result.error).string();
+        if(result.error)
+        {
+            return std::nullopt;
+        }
+
+        FileDescriptor file{ open(path.c_str(), O_RDWR | O_CLOEXEC) };
+        struct stat file_stat = {};
+        if(file.get() < 0 || fstat(file.get(), &file_stat) != 0)
+        {
+            result.error = std::error_code(errno, std::generic_category());
+            return std::nullopt;
+        }
+
+        const auto file_size = static_cast<std::size_t>(file_stat.st_size);
+        auto before = read_leading_tag(file.get(), file_size);
+
+        std::vector<ID3v2::TagFrame> frames;
+        auto version = options.version;
+        if(!before.empty())
+        {
+            DescriptorReader reader{ file.get(), file_size,
+                static_cast<std::size_t>(file_stat.st_blksize) };
+            const MpegFile mpeg{ reader };
+
+            if(const auto &tags = mpeg.id3v2())
+            {
+                const auto major = tags->getHeader().version_major;
+                frames = tags->toTags().getFrames();
+
+                // frames that cannot be decoded would be lost in the rewrite
+                if(!std::all_of(frames.cbegin(), frames.cend(),
+                       [](const auto &frame) { return ID3v2::writable(frame); }))
+                {
+                    result.error = std::make_error_code(std::errc::operation_not_supported);
+                    return std::nullopt;
+                }
+
+                version = major == 3 || major == 4 ? major : options.version;
+            }
+        }
+
+        if(!edit(index, version, frames))
+        {
+            return std::nullopt;
+        }
+
+        auto after = ID3v2::serialize_tag(
+            frames, version, ID3v2::target_tag_size(frames, before.size(), options.padding));
+        if(after == before)
+        {
+            return std::nullopt;
+        }
+
+        std::optional<TemporaryFile> temporary;
+        if(after.size() != before.size())
+        {
+            try
+            {
+                temporary.emplace(path);
+            }
+            catch(const std::system_error &error)
+            {
+                result.error = error.code();
+                return std::nullopt;
+            }
+        }
+
+        return PreparedEdit{
+            .index = index,
+            .path = std::move(path),
+            .file = std::move(file),
+            .stat = file_stat,
+            .before = std::move(before),
+            .after = std::move(after),
+            .temporary = std::move(temporary),
+        };
+    }
+
+private:
+    std::span<const std::string> paths;
+    const RetagFunction &edit;
+    const RetagOptions &options;
+    std::vector<RetagResult> results;
+    std::optional<Journal> journal;
+    std::atomic<bool> stopped{ false };
+    std::mutex failure_mutex;
+    std::exception_ptr failure;
+};
+
+struct JournalEntry
+{
+    std::string path;
+    std::vector<std::byte> before;
+    std::vector<std::byte> after;
+    std::string temporary;
+    bool committed{ false };
+};
+
+std::vector<JournalEntry> read_journal(const std::string &path)
+{
+    FileDescriptor file{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+    struct stat file_stat = {};
+    if(file.get() < 0 || fstat(file.get(), &file_stat) != 0)
+    {
+        throw_errno("Couldn't open journal");
+    }
+
+    std::vector<std::byte> data(static_cast<std::size_t>(file_stat.st_size));
+    data.resize(read_fully(file.get(), data, 0));
+
+    const std::span<const std::byte> journal{ data };
+    if(journal.size() < JournalMagic.size() ||
+        !std::equal(JournalMagic.begin(), JournalMagic.end(), journal.begin()))
+    {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Not a journal");
+    }
+
+    std::unordered_map<std::uint32_t, std::size_t> entry_indices;
+    std::vector<JournalEntry> entries;
+
+    auto records = journal.subspan(JournalMagic.size());
+    while(records.size() >= 12)
+    {
+        const auto payload_size = to_u32_le(records);
+        if(payload_size < 5 || payload_size > records.size() - 12)
+        {
+            break;
+        }
+
+        const auto payload = records.subspan(12, payload_size);
+        if(Xxh64::hash(payload) != to_u64_le(records.subspan(4, 8)))
+        {
+            break;
+        }
+        records = records.subspan(12 + payload_size);
+
+        const auto type = static_cast<RecordType>(payload[0]);
+        const auto entry = to_u32_le(payload.subspan(1));
+        auto fields = payload.subspan(5);
+
+        const auto next_field = [&fields]() -> std::optional<std::span<const std::byte>> {
+            if(fields.size() < 4 || to_u32_le(fields) > fields.size() - 4)
+            {
+                return std::nullopt;
+            }
+
+            const auto field = fields.subspan(4, to_u32_le(fields));
+            fields = fields.subspan(4 + field.size());
+            return field;
+        };
+
+        if(type == RecordType::Begin)
+        {
+            const auto file_path = next_field();
+            const auto before = next_field();
+            const auto after = next_field();
+            const auto temporary = next_field();
+            if(!file_path || !before || !after || !temporary)
+            {
+                break;
+            }
+
+            entry_indices[entry] = entries.size();
+            entries.push_back(JournalEntry{
+                .path = std::string(reinterpret_cast<const char *>(file_path->data()),
+                    file_path->size()),
+                .before = { before->begin(), before->end() },
+                .after = { after->begin(), after->end() },
+                .temporary = std::string(reinterpret_cast<const char *>(temporary->data()),
+                    temporary->size()),
+            });
+        }
+        else if(type == RecordType::Commit)
+        {
+            if(const auto it = entry_indices.find(entry); it != entry_indices.end())
+            {
+                entries[it->second].committed = true;
+            }
+        }
+    }
+
+    return entries;
+}
+
+enum class RecoveryOutcome
+{
+    Replayed,
+    Unchanged,
+    Conflict,
+};
+
+bool holds_torn_write(std::span<const std::byte> region,
+    std::span<const std::byte> before,
+    std::span<const std::byte> after)
+{
+    if(region.size() != before.size())
+    {
+        return false;
+    }
+
+    for(std::size_t i = 0; i < region.size(); ++i)
+    {
+        if(region[i] != before[i] && region[i] != after[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+RecoveryOutcome recover_entry(const JournalEntry &entry, RecoveryMode mode)
+{
+    const auto &source = mode == RecoveryMode::RollForward ? entry.before : entry.after;
+    const auto &target = mode == RecoveryMode::RollForward ? entry.after : entry.before;
+
+    FileDescriptor file{ open(entry.path.c_str(), O_RDWR | O_CLOEXEC) };
+    struct stat file_stat = {};
+    if(file.get() < 0 || fstat(file.get(), &file_stat) != 0)
+    {
+        return RecoveryOutcome::Conflict;
+    }
+
+    const auto current = read_leading_tag(file.get(), static_cast<std::size_t>(file_stat.st_size));
+    if(current == target)
+    {
+        return RecoveryOutcome::Unchanged;
+    }
+
+    // an in place write may have been torn, its region is written again as long as every byte
+    // still comes from one of the two tags
+    if(entry.before.size() == entry.after.size())
+    {
+        std::vector<std::byte> region(target.size());
+        region.resize(read_fully(file.get(), region, 0));
+        if(!holds_torn_write(region, entry.before, entry.after))
+        {
+            return RecoveryOutcome::Conflict;
+        }
+
+        write_fully(file.get(), target, 0);
+        if(fdatasync(file.get()) != 0)
+        {
+            throw_errno("Couldn't sync file");
+        }
+        return RecoveryOutcome::Replayed;
+    }
+
+    // rewrites are atomic, the file holds either tag unless it was changed since
+    if(current != source)
+    {
+        return RecoveryOutcome::Conflict;
+    }
+
+    replace_head(entry.path, file.get(), file_stat, target, current.size());
+    return RecoveryOutcome::Replayed;
+}
+} // namespace
+
+std::vector<RetagResult> retag_files(
+    std::span<const std::string> paths, const RetagFunction &edit, const RetagOptions &options)
+{
+    return RetagBatch{ paths, edit, options }.run();
+}
+
+RecoveryReport recover_journal(std::string_view journal_path, RecoveryMode mode)
+{
+    const std::string path{ journal_path };
+
+    RecoveryReport report;
+    for(const auto &entry : read_journal(path))
+    {
+        if(entry.committed)
+        {
+            continue;
+        }
+
+        // only the file the batch created is removed, never one of a concurrent writer
+        if(!entry.temporary.empty())
+        {
+            unlink(entry.temporary.c_str());
+        }
+
+        switch(recover_entry(entry, mode))
+        {
+        case RecoveryOutcome::Replayed:
+            ++report.replayed;
+            break;
+        case RecoveryOutcome::Unchanged:
+            ++report.unchanged;
+            break;
+        case RecoveryOutcome::Conflict:
+            report.conflicts.push_back(entry.path);
+            break;
+        }
+    }
+
+    unlink(path.c_str());
+    sync_parent_directory(path);
+    return report;
+}
+} // namespace audiotag
@@ -0,0 +1,417 @@
+#include "audiotag/scanner.hpp"
+
+#include "file_io.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace audiotag
+{
+namespace
+{
+constexpr std::size_t FileBatchSize{ 64 };
+constexpr std::size_t DirentBufferSize{ 64 * 1024 };
+constexpr unsigned IdleSpins{ 64 };
+
+// Fixed part of the records getdents64 returns, the name follows d_type
+struct DirentHeader
+{
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    std::uint16_t d_reclen;
+    std::uint8_t d_type;
+};
+constexpr std::size_t DirentNameOffset{ offsetof(DirentHeader, d_type) + 1 };
+
+struct WorkItem
+{
+    bool directory{ false };
+    std::vector<std::string> paths;
+};
+
+// Owner pushes and pops at the back, thieves take from the front, where the
+// oldest and usually largest subtrees are
+class WorkQueue
+{
+public:
+    void push(WorkItem &&item)
+    {
+        const std::lock_guard lock{ mutex };
+        items.push_back(std::move(item));
+    }
+
+    std::optional<WorkItem> pop()
+    {
+        const std::lock_guard lock{ mutex };
+        if(items.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto item = std::move(items.back());
+        items.pop_back();
+        return item;
+    }
+
+    std::optional<WorkItem> steal()
+    {
+        const std::lock_guard lock{ mutex };
+        if(items.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto item = std::move(items.front());
+        items.pop_front();
+        return item;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<WorkItem> items;
+};
+
+std::string join_path(std::string_view directory, std::string_view name)
+{
+    std::string path;
+    path.reserve(directory.size() + 1 + name.size());
+    path.append(directory);
+    if(path.empty() || path.back() != '/')
+    {
+        path.push_back('/');
+    }
+    path.append(name);
+    return path;
+}
+
+class Scanner
+{
+public:
+    Scanner(const ScanSink &sink, const ScanOptions &options)
+    : sink{ sink }
+    , options{ options }
+    , queues(options.thread_count != 0 ? options.thread_count
+                                       : std::max(std::thread::hardware_concurrency(), 1u))
+    {
+    }
+
+    void run(std::span<const std::string> roots)
+    {
+        for(std::size_t i = 0; i < roots.size(); ++i)
+        {
+            push(i % queues.size(), WorkItem{ .directory = true, .paths = { roots[i] } });
+        }
+
+        {
+            std::vector<std::jthread> workers;
+            for(std::size_t i = 0; i < queues.size(); ++i)
+            {
+                workers.emplace_back([this, i] { work(i); });
+            }
+        }
+
+        if(failure != nullptr)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+
+private:
+    void push(std::size_t queue, WorkItem &&item)
+    {
+        ++pending;
+        queues[queue].push(std::move(item));
+    }
+
+    std::optional<WorkItem> take(std::size_t self)
+    {
+        if(auto item = queues[self].pop())
+        {
+            return item;
+        }
+
+        for(std::size_t i = 1; i < queues.size(); ++i)
+        {
+            if(auto item = queues[(self + i) % queues.size()].steal())
+            {
+                return item;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    void work(std::size_t self)
+    {
+        std::vector<std::byte> buffer(DirentBufferSize);
+        unsigned idle{ 0 };
+
+        while(!stopped)
+        {
+            auto item = take(self);
+            if(!item)
+            {
+                // items are only pushed while another one is processed, so no
+                // pending item means the traversal is complete
+                if(pending == 0)
+                {
+                    return;
+                }
+
+                if(++idle < IdleSpins)
+                {
+                    std::this_thread::yield();
+                }
+                else
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                continue;
+            }
+
+            idle = 0;
+            if(item->directory)
+            {
+                list(self, item->paths.front(), buffer);
+            }
+            else
+            {
+                for(auto &path : item->paths)
+                {
+                    parse(std::move(path));
+                }
+            }
+            --pending;
+        }
+    }
+
+    void list(std::size_t self, const std::string &directory, std::span<std::byte> buffer)
+    {
+        const FileDescriptor file{ open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+        if(file.get() < 0)
+        {
+            emit(ScanResult{ .path = directory,
+                .error = std::error_code(errno, std::generic_category()),
+                .file = std::nullopt });
+            return;
+        }
+
+        WorkItem files{ .directory = false, .paths = {} };
+        while(true)
+        {
+            const auto size = syscall(SYS_getdents64, file.get(), buffer.data(), buffer.size());
+            if(size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(size < 0)
+            {
+                emit(ScanResult{ .path = directory,
+                    .error = std::error_code(errno, std::generic_category()),
+                    .file = std::nullopt });
+                break;
+            }
+            if(size == 0)
+            {
+                break;
+            }
+
+            for(std::size_t offset = 0; offset < static_cast<std::size_t>(size);)
+            {
+                DirentHeader header{};
+                std::memcpy(&header, buffer.data() + offset, sizeof(header));
+                const std::string_view name{ reinterpret_cast<const char *>(
+                    buffer.data() + offset + DirentNameOffset) };
+                offset += header.d_reclen;
+
+                if(name == "." || name == "..")
+                {
+                    continue;
+                }
+
+                switch(entry_type(file.get(), header.d_type, name))
+                {
+                case DT_DIR:
+                    push(self,
+                        WorkItem{ .directory = true, .paths = { join_path(directory, name) } });
+                    break;
+                case DT_REG:
+                    if(matches_extension(name))
+                    {
+                        files.paths.push_back(join_path(directory, name));
+                        if(files.paths.size() == FileBatchSize)
+                        {
+                            push(self, std::exchange(files, WorkItem{}));
+                        }
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        if(!files.paths.empty())
+        {
+            push(self, std::move(files));
+        }
+    }
+
+    // Type of a directory entry, stat'ed only when the file system does not
+    // report it or a symlink has to be followed
+    unsigned char entry_type(int directory, unsigned char type, std::string_view name)
+    {
+        if(type != DT_UNKNOWN && (type != DT_LNK || !options.follow_symlinks))
+        {
+            return type;
+        }
+
+        struct stat entry_stat = {};
+        const auto flags = options.follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW;
+        if(fstatat(directory, std::string(name).c_str(), &entry_stat, flags) != 0)
+        {
+            return DT_UNKNOWN;
+        }
+
+        if(S_ISREG(entry_stat.st_mode))
+        {
+            return DT_REG;
+        }
+
+        if(!S_ISDIR(entry_stat.st_mode))
+        {
+            return DT_UNKNOWN;
+        }
+
+        // directories reached through links are visited once, which stops link cycles
+        if(type == DT_LNK)
+        {
+            const std::lock_guard lock{ visited_mutex };
+            if(!visited.emplace(entry_stat.st_dev, entry_stat.st_ino).second)
+            {
+                return DT_UNKNOWN;
+            }
+        }
+
+        return DT_DIR;
+    }
+
+    bool matches_extension(std::string_view name) const
+    {
+        return has_extension(name, options.extensions);
+    }
+
+    void parse(std::string &&path)
+    {
+        emit(scan_file(std::move(path), options));
+    }
+
+    void emit(ScanResult &&result)
+    {
+        try
+        {
+            sink(std::move(result));
+        }
+        catch(...)
+        {
+            const std::lock_guard lock{ failure_mutex };
+            if(failure == nullptr)
+            {
+                failure = std::current_exception();
+            }
+            stopped = true;
+        }
+    }
+
+private:
+    const ScanSink &sink;
+    const ScanOptions &options;
+    std::vector<WorkQueue> queues;
+    std::atomic<std::size_t> pending{ 0 };
+    std::atomic<bool> stopped{ false };
+    std::mutex visited_mutex;
+    std::set<std::pair<dev_t, ino_t>> visited;
+    std::mutex failure_mutex;
+    std::exception_ptr failure;
+};
+} // namespace
+
+bool has_extension(std::string_view name, std::span<const std::string> extensions)
+{
+    return std::any_of(extensions.begin(), extensions.end(), [name](const auto &extension) {
+        return name.size() >= extension.size() &&
+               std::equal(extension.rbegin(), extension.rend(), name.rbegin(), [](char a, char b) {
+                   return std::tolower(static_cast<unsigned char>(a)) ==
+                          std::tolower(static_cast<unsigned char>(b));
+               });
+    });
+}
+
+ScanResult scan_file(std::string path, const ScanOptions &options)
+{
+    ScanResult result{ .path = std::move(path), .error = {}, .file = std::nullopt };
+
+    // a cache hit costs one stat instead of an open and the tag reads
+    if(options.cache != nullptr)
+    {
+        if(const auto key = read_file_key(result.path))
+        {
+            result.key = *key;
+            result.cached = options.cache->find(*key);
+            if(result.cached)
+            {
+                return result;
+            }
+        }
+    }
+
+    const FileDescriptor file{ open(result.path.c_str(), O_RDONLY | O_CLOEXEC) };
+    struct stat file_stat = {};
+    if(file.get() < 0 || fstat(file.get(), &file_stat) != 0)
+    {
+        result.error = std::error_code(errno, std::generic_category());
+        return result;
+    }
+
+    result.key = to_file_key(file_stat);
+    try
+    {
+        DescriptorReader reader{ file.get(), static_cast<std::size_t>(file_stat.st_size),
+            static_cast<std::size_t>(file_stat.st_blksize) };
+        result.file.emplace(reader, options.read_options);
+    }
+    catch(...)
+    {
+        // escaping a scan worker would end the whole scan
+        result.file.reset();
+        result.error = current_parse_error();
+    }
+
+    return result;
+}
+
+void scan_directories(
+    std::span<const std::string> roots, const ScanSink &sink, const ScanOptions &options)
+{
+    Scanner{ sink, options }.run(roots);
+}
+} // namespace audiotag
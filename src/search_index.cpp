@@ -0,0 +1,627 @@
+#include "audiotag/search_index.hpp"
+
+#include "audiotag/mmap_reader.hpp"
+#include "file_format.hpp"
+#include "file_io.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+constexpr char IndexMagic[8] = { 'A', 'T', 'I', 'N', 'D', 'E', 'X', '\0' };
+constexpr char32_t ReplacementCharacter{ 0xFFFD };
+
+// Folds of U+00C0 to U+00FF, empty for the multiplication and division signs
+constexpr std::array<std::string_view, 64> latin1_folds = {
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i", //
+    "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "ss", //
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i", //
+    "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "y",  //
+};
+
+// Base letters of Latin Extended-A, U+0100 to U+017F
+constexpr std::string_view latin_extended_a_folds = "aaaaaaccccccccdd"
+                                                    "ddeeeeeeeeeegggg"
+                                                    "gggghhhhiiiiiiii"
+                                                    "iiiijjkkklllllll"
+                                                    "lllnnnnnnnnnoooo"
+                                                    "oooorrrrrrssssss"
+                                                    "ssttttttuuuuuuuu"
+                                                    "uuuuwwyyyzzzzzzs";
+
+static_assert(latin_extended_a_folds.size() == 0x80);
+
+// Decodes the code point starting at `offset` and advances past it, invalid
+// sequences decode as U+FFFD one byte at a time
+char32_t next_code_point(std::string_view text, std::size_t &offset)
+{
+    const auto lead = static_cast<unsigned char>(text[offset++]);
+    if(lead < 0x80)
+    {
+        return lead;
+    }
+
+    const std::size_t length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+    if(length == 0 || lead > 0xF4 || text.size() - offset < length)
+    {
+        return ReplacementCharacter;
+    }
+
+    char32_t code_point = lead & (0x3F >> length);
+    for(std::size_t i = 0; i < length; ++i)
+    {
+        const auto continuation = static_cast<unsigned char>(text[offset + i]);
+        if((continuation & 0xC0) != 0x80)
+        {
+            return ReplacementCharacter;
+        }
+        code_point = code_point << 6 | (continuation & 0x3F);
+    }
+
+    offset += length;
+    return code_point;
+}
+
+void append_utf8(std::string &out, char32_t code_point)
+{
+    if(code_point < 0x80)
+    {
+        out.push_back(static_cast<char>(code_point));
+    }
+    else if(code_point < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | code_point >> 6));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+    else if(code_point < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xE0 | code_point >> 12));
+        out.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xF0 | code_point >> 18));
+        out.push_back(static_cast<char>(0x80 | (code_point >> 12 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+bool is_dropped(char32_t c)
+{
+    // apostrophes join "don't" into one token, combining marks are diacritics
+    return c == '\'' || c == 0x2019 || (c >= 0x300 && c <= 0x36F);
+}
+
+bool is_separator(char32_t c)
+{
+    if(c < 0x80)
+    {
+        return !((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
+    }
+
+    return c < 0xC0 || c == 0xD7 || c == 0xF7 || (c >= 0x2000 && c <= 0x206F) ||
+           (c >= 0x3000 && c <= 0x303F) || c == ReplacementCharacter;
+}
+
+void append_folded(std::string &out, char32_t c)
+{
+    if(c < 0x80)
+    {
+        out.push_back(static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c));
+    }
+    else if(c >= 0xC0 && c <= 0xFF)
+    {
+        out.append(latin1_folds[c - 0xC0]);
+    }
+    else if(c == 0x132 || c == 0x133)
+    {
+        out.append("ij");
+    }
+    else if(c == 0x152 || c == 0x153)
+    {
+        out.append("oe");
+    }
+    else if(c >= 0x100 && c <= 0x17F)
+    {
+        out.push_back(latin_extended_a_folds[c - 0x100]);
+    }
+    else if((c >= 0x391 && c <= 0x3A9) || (c >= 0x410 && c <= 0x42F))
+    {
+        // Greek and Cyrillic capitals sit 0x20 below their small letters
+        append_utf8(out, c + 0x20);
+    }
+    else if(c >= 0x400 && c <= 0x40F)
+    {
+        append_utf8(out, c + 0x50);
+    }
+    else
+    {
+        append_utf8(out, c);
+    }
+}
+
+template <typename Function> void for_each_token(std::string_view folded, Function &&function)
+{
+    while(!folded.empty())
+    {
+        const auto end = folded.find(' ');
+        function(folded.substr(0, end));
+        folded.remove_prefix(end == std::string_view::npos ? folded.size() : end + 1);
+    }
+}
+
+std::vector<std::uint32_t> intersect(
+    std::span<const std::uint32_t> smaller, std::span<const std::uint32_t> larger)
+{
+    std::vector<std::uint32_t> result;
+    auto position = larger.begin();
+    for(const auto document : smaller)
+    {
+        position = std::lower_bound(position, larger.end(), document);
+        if(position == larger.end())
+        {
+            break;
+        }
+        if(*position == document)
+        {
+            result.push_back(document);
+        }
+    }
+    return result;
+}
+
+// Ascending union of the postings of a term range, produced lazily so that a
+// limited search over a short prefix stops after `limit` documents
+class PostingMerge
+{
+public:
+    template <typename Postings> PostingMerge(TermRange terms, Postings &&postings)
+    {
+        for(auto term = terms.begin; term < terms.end; ++term)
+        {
+            if(const auto list = postings(term); !list.empty())
+            {
+                heap.push(Cursor{ list.front(), list });
+            }
+        }
+    }
+
+    std::optional<std::uint32_t> next()
+    {
+        while(!heap.empty())
+        {
+            auto cursor = heap.top();
+            heap.pop();
+
+            const auto document = cursor.document;
+            cursor.list = cursor.list.subspan(1);
+            if(!cursor.list.empty())
+            {
+                cursor.document = cursor.list.front();
+                heap.push(cursor);
+            }
+
+            if(!last || *last != document)
+            {
+                last = document;
+                return document;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    struct Cursor
+    {
+        std::uint32_t document;
+        std::span<const std::uint32_t> list;
+
+        bool operator>(const Cursor &other) const
+        {
+            return document > other.document;
+        }
+    };
+
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<>> heap;
+    std::optional<std::uint32_t> last;
+};
+
+// Writes `postings` with every document passed through `renumber`
+template <typename Postings, typename Renumber>
+void write_postings(std::string_view path, const Postings &postings, Renumber &&renumber)
+{
+    std::vector<const typename Postings::value_type *> sorted;
+    sorted.reserve(postings.size());
+    for(const auto &entry : postings)
+    {
+        sorted.push_back(&entry);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+        [](const auto *a, const auto *b) { return a->first < b->first; });
+
+    std::vector<std::uint32_t> term_offsets{ 0 };
+    std::string terms;
+    std::vector<std::uint32_t> posting_offsets{ 0 };
+    std::vector<std::uint32_t> all_postings;
+    term_offsets.reserve(sorted.size() + 1);
+    posting_offsets.reserve(sorted.size() + 1);
+
+    for(const auto *entry : sorted)
+    {
+        const auto first = all_postings.size();
+        for(const auto document : entry->second)
+        {
+            if(const auto stored = renumber(document); stored != SearchIndexWriter::NoDocument)
+            {
+                all_postings.push_back(stored);
+            }
+        }
+
+        // a term whose documents were all dropped is left out
+        if(all_postings.size() == first)
+        {
+            continue;
+        }
+
+        // documents may have been added out of order
+        const auto list = all_postings.begin() + static_cast<std::ptrdiff_t>(first);
+        std::sort(list, all_postings.end());
+        all_postings.erase(std::unique(list, all_postings.end()), all_postings.end());
+
+        terms.append(entry->first);
+        if(terms.size() > std::numeric_limits<std::uint32_t>::max() ||
+            all_postings.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("Search index exceeds 4 GiB");
+        }
+
+        term_offsets.push_back(static_cast<std::uint32_t>(terms.size()));
+        posting_offsets.push_back(static_cast<std::uint32_t>(all_postings.size()));
+    }
+
+    auto header = make_file_header<SearchIndexHeader>(IndexMagic, SearchIndexVersion);
+    header.term_count = term_offsets.size() - 1;
+    header.term_offsets_offset = sizeof(SearchIndexHeader);
+    header.posting_offsets_offset =
+        header.term_offsets_offset + term_offsets.size() * sizeof(std::uint32_t);
+    header.postings_offset =
+        header.posting_offsets_offset + posting_offsets.size() * sizeof(std::uint32_t);
+    header.posting_count = all_postings.size();
+    header.terms_offset = header.postings_offset + all_postings.size() * sizeof(std::uint32_t);
+    header.terms_size = terms.size();
+
+    replace_file(path, 0644, [&](int file) {
+        write_fully(file, std::as_bytes(std::span(&header, 1)), 0);
+        write_fully(file, std::as_bytes(std::span(term_offsets)),
+            static_cast<off_t>(header.term_offsets_offset));
+        write_fully(file, std::as_bytes(std::span(posting_offsets)),
+            static_cast<off_t>(header.posting_offsets_offset));
+        write_fully(file, std::as_bytes(std::span(all_postings)),
+            static_cast<off_t>(header.postings_offset));
+        write_fully(file, std::as_bytes(std::span(terms)),
+            static_cast<off_t>(header.terms_offset));
+    });
+}
+} // namespace
+
+std::string fold_search_text(std::string_view text)
+{
+    std::string folded;
+    folded.reserve(text.size());
+
+    bool separated{ false };
+    for(std::size_t offset = 0; offset < text.size();)
+    {
+        const auto c = next_code_point(text, offset);
+        if(is_dropped(c))
+        {
+            continue;
+        }
+
+        if(is_separator(c))
+        {
+            separated = !folded.empty();
+            continue;
+        }
+
+        if(std::exchange(separated, false))
+        {
+            folded.push_back(' ');
+        }
+        append_folded(folded, c);
+    }
+
+    return folded;
+}
+
+struct SearchIndex::Impl
+{
+    MmapReader file;
+    std::span<const std::uint32_t> term_offsets;
+    std::string_view terms;
+    std::span<const std::uint32_t> posting_offsets;
+    std::span<const std::uint32_t> postings;
+
+    explicit Impl(std::string_view path)
+    : file{ path }
+    {
+        const auto data = file.view(0, file.length());
+        const auto header = read_file_header<SearchIndexHeader>(
+            data, IndexMagic, SearchIndexVersion, "search index");
+
+        const auto size = data.size();
+        const auto in_bounds = [size](std::uint64_t offset, std::uint64_t count,
+                                   std::uint64_t element) {
+            return offset % element == 0 && offset <= size && count <= (size - offset) / element;
+        };
+
+        if(header.term_count >= size ||
+            !in_bounds(header.term_offsets_offset, header.term_count + 1, sizeof(std::uint32_t)) ||
+            !in_bounds(header.terms_offset, header.terms_size, 1) ||
+            !in_bounds(header.posting_offsets_offset, header.term_count + 1,
+                sizeof(std::uint32_t)) ||
+            !in_bounds(header.postings_offset, header.posting_count, sizeof(std::uint32_t)))
+        {
+            throw std::runtime_error("Corrupted search index");
+        }
+
+        const auto numbers = [&data](std::uint64_t offset, std::uint64_t count) {
+            return std::span(
+                reinterpret_cast<const std::uint32_t *>(data.data() + offset), count);
+        };
+
+        term_offsets = numbers(header.term_offsets_offset, header.term_count + 1);
+        terms = std::string_view(
+            reinterpret_cast<const char *>(data.data() + header.terms_offset), header.terms_size);
+        posting_offsets = numbers(header.posting_offsets_offset, header.term_count + 1);
+        postings = numbers(header.postings_offset, header.posting_count);
+    }
+};
+
+SearchIndex::SearchIndex(std::string_view path)
+: impl(std::make_unique<Impl>(path))
+{
+}
+
+SearchIndex::~SearchIndex() = default;
+SearchIndex::SearchIndex(SearchIndex &&other) noexcept = default;
+SearchIndex &SearchIndex::operator=(SearchIndex &&other) noexcept = default;
+
+std::size_t SearchIndex::term_count() const
+{
+    return impl->term_offsets.size() - 1;
+}
+
+std::string_view SearchIndex::term(std::size_t index) const
+{
+    // term offsets are only bounded against the blob here, a damaged pair gives an empty term
+    const auto begin = impl->term_offsets[index];
+    const auto end = impl->term_offsets[index + 1];
+    if(begin > end || end > impl->terms.size())
+    {
+        return {};
+    }
+
+    return impl->terms.substr(begin, end - begin);
+}
+
+std::span<const std::uint32_t> SearchIndex::postings(std::size_t index) const
+{
+    const auto begin = impl->posting_offsets[index];
+    const auto end = impl->posting_offsets[index + 1];
+    if(begin > end || end > impl->postings.size())
+    {
+        return {};
+    }
+
+    return impl->postings.subspan(begin, end - begin);
+}
+
+TermRange SearchIndex::prefix_range(std::string_view prefix) const
+{
+    const auto count = term_count();
+
+    // first term not less than the prefix, then the first that does not start with it
+    std::size_t begin{ 0 };
+    for(auto length = count; length > 0;)
+    {
+        const auto half = length / 2;
+        if(term(begin + half) < prefix)
+        {
+            begin += half + 1;
+            length -= half + 1;
+        }
+        else
+        {
+            length = half;
+        }
+    }
+
+    auto end = begin;
+    for(auto length = count - begin; length > 0;)
+    {
+        const auto half = length / 2;
+        if(term(end + half).starts_with(prefix))
+        {
+            end += half + 1;
+            length -= half + 1;
+        }
+        else
+        {
+            length = half;
+        }
+    }
+
+    return TermRange{ .begin = begin, .end = end };
+}
+
+std::vector<std::uint32_t> SearchIndex::search(std::string_view query, std::size_t limit) const
+{
+    std::vector<std::string_view> tokens;
+    const auto folded = fold_search_text(query);
+    for_each_token(folded, [&tokens](std::string_view token) { tokens.push_back(token); });
+
+    if(tokens.empty() || limit == 0)
+    {
+        return {};
+    }
+
+    const auto complete = !query.empty() && (query.back() == ' ' || query.back() == '\t');
+    const auto prefix = complete ? std::string_view{} : tokens.back();
+    if(!complete)
+    {
+        tokens.pop_back();
+    }
+
+    // complete tokens must match a term exactly, rarest first
+    std::vector<std::span<const std::uint32_t>> lists;
+    for(const auto token : tokens)
+    {
+        const auto range = prefix_range(token);
+        if(range.size() == 0 || term(range.begin) != token)
+        {
+            return {};
+        }
+        lists.push_back(postings(range.begin));
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const auto &a, const auto &b) { return a.size() < b.size(); });
+
+    std::optional<std::vector<std::uint32_t>> candidates;
+    for(const auto list : lists)
+    {
+        candidates = candidates ? intersect(*candidates, list)
+                                : std::vector<std::uint32_t>(list.begin(), list.end());
+    }
+
+    std::vector<std::uint32_t> results;
+    if(prefix.empty())
+    {
+        results = std::move(*candidates);
+        results.resize(std::min(results.size(), limit));
+        return results;
+    }
+
+    PostingMerge merge{ prefix_range(prefix), [this](std::size_t term) { return postings(term); } };
+    std::vector<std::uint32_t>::const_iterator candidate;
+    if(candidates)
+    {
+        candidate = candidates->cbegin();
+    }
+    while(results.size() < limit)
+    {
+        const auto document = merge.next();
+        if(!document)
+        {
+            break;
+        }
+
+        if(candidates)
+        {
+            candidate = std::lower_bound(candidate, candidates->cend(), *document);
+            if(candidate == candidates->cend())
+            {
+                break;
+            }
+            if(*candidate != *document)
+            {
+                continue;
+            }
+        }
+        results.push_back(*document);
+    }
+
+    return results;
+}
+
+struct SearchIndexWriter::Impl
+{
+    // documents of each folded term, in the order they were added
+    std::unordered_map<std::string, std::vector<std::uint32_t>, StringHash, std::equal_to<>>
+        postings;
+};
+
+SearchIndexWriter::SearchIndexWriter()
+: impl(std::make_unique<Impl>())
+{
+}
+
+SearchIndexWriter::~SearchIndexWriter() = default;
+SearchIndexWriter::SearchIndexWriter(SearchIndexWriter &&other) noexcept = default;
+SearchIndexWriter &SearchIndexWriter::operator=(SearchIndexWriter &&other) noexcept = default;
+
+void SearchIndexWriter::add(std::uint32_t document, std::string_view text)
+{
+    auto &postings = impl->postings;
+    for_each_token(fold_search_text(text), [&postings, document](std::string_view token) {
+        auto it = postings.find(token);
+        if(it == postings.end())
+        {
+            it = postings.emplace(token, std::vector<std::uint32_t>{}).first;
+        }
+
+        if(it->second.empty() || it->second.back() != document)
+        {
+            it->second.push_back(document);
+        }
+    });
+}
+
+void SearchIndexWriter::add(std::uint32_t document, const MetadataCache::Entry &entry)
+{
+    add(document, entry.title());
+    add(document, entry.artist());
+    add(document, entry.album());
+}
+
+void SearchIndexWriter::remove(std::uint32_t document, std::string_view text)
+{
+    auto &postings = impl->postings;
+    for_each_token(fold_search_text(text), [&postings, document](std::string_view token) {
+        const auto it = postings.find(token);
+        if(it == postings.end())
+        {
+            return;
+        }
+
+        std::erase(it->second, document);
+        if(it->second.empty())
+        {
+            postings.erase(it);
+        }
+    });
+}
+
+std::size_t SearchIndexWriter::term_count() const
+{
+    return impl->postings.size();
+}
+
+void SearchIndexWriter::write(std::string_view path) const
+{
+    write_postings(path, impl->postings, [](std::uint32_t document) { return document; });
+}
+
+void SearchIndexWriter::write(
+    std::string_view path, std::span<const std::uint32_t> documents) const
+{
+    write_postings(path, impl->postings, [documents](std::uint32_t document) {
+        return document < documents.size() ? documents[document] : NoDocument;
+    });
+}
+} // namespace audiotag
@@ -0,0 +1,201 @@
+#include "audiotag/track_metadata.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+constexpr Tag TrackTags[] = {
+    Tag::TITLE,
+    Tag::ARIST,
+    Tag::ALBUM,
+    Tag::GENRE,
+    Tag::TRACKNUMBER,
+    Tag::DISCNUMBER,
+    Tag::YEAR,
+};
+
+std::string_view genre_number(std::string_view value)
+{
+    if(value.empty() || !std::all_of(value.begin(), value.end(),
+                            [](char c) { return c >= '0' && c <= '9'; }))
+    {
+        return value;
+    }
+
+    const auto number = parse_number(value);
+    return number <= 0xFF ? ID3v1::genre_name(static_cast<std::uint8_t>(number)) : value;
+}
+} // namespace
+
+std::uint32_t parse_number(std::string_view value)
+{
+    std::uint32_t number{ 0 };
+    std::from_chars(value.data(), value.data() + value.size(), number);
+    return number;
+}
+
+std::string_view resolve_genre(std::string_view value)
+{
+    // "((" escapes a name starting with a parenthesis
+    if(value.starts_with("(("))
+    {
+        return value.substr(1);
+    }
+
+    if(!value.starts_with('('))
+    {
+        return genre_number(value);
+    }
+
+    const auto close = value.find(')');
+    if(close == std::string_view::npos)
+    {
+        return value;
+    }
+
+    // a refinement after the reference is more specific than the reference
+    if(close + 1 < value.size())
+    {
+        return value.substr(close + 1);
+    }
+
+    const auto reference = value.substr(1, close - 1);
+    if(reference == "RX")
+    {
+        return "Remix";
+    }
+    if(reference == "CR")
+    {
+        return "Cover";
+    }
+    return genre_number(reference);
+}
+
+void visit_track_values(
+    const MpegFile &file, std::span<const Tag> tags, const TrackValueVisitor &visitor)
+{
+    std::vector<Tag> missing(tags.begin(), tags.end());
+
+    const auto deliver = [&missing, &visitor](Tag tag, std::string_view value) {
+        if(tag == Tag::GENRE)
+        {
+            value = resolve_genre(value);
+        }
+
+        const auto it = std::find(missing.begin(), missing.end(), tag);
+        if(value.empty() || it == missing.end())
+        {
+            return;
+        }
+
+        missing.erase(it);
+        visitor(tag, value);
+    };
+
+    const auto visit_id3v2 = [&missing, &deliver](const ID3v2::TagsView &id3v2) {
+        // deliver shrinks `missing` while the tag is visited
+        const auto requested = missing;
+        id3v2.visitStringValues(requested, deliver);
+    };
+
+    if(file.id3v2())
+    {
+        visit_id3v2(*file.id3v2());
+    }
+
+    if(file.ape() && !missing.empty())
+    {
+        const auto requested = missing;
+        for(const auto tag : requested)
+        {
+            deliver(tag, file.ape()->getStringValue(tag));
+        }
+    }
+
+    if(file.id3v2_appended() && !missing.empty())
+    {
+        visit_id3v2(*file.id3v2_appended());
+    }
+
+    if(const auto &id3v1 = file.id3v1(); id3v1 && !missing.empty())
+    {
+        char track[4];
+        const auto track_end = std::to_chars(std::begin(track), std::end(track), id3v1->track).ptr;
+
+        const auto requested = missing;
+        for(const auto tag : requested)
+        {
+            switch(tag)
+            {
+            case Tag::TITLE:
+                deliver(tag, id3v1->title);
+                break;
+            case Tag::ARIST:
+                deliver(tag, id3v1->artist);
+                break;
+            case Tag::ALBUM:
+                deliver(tag, id3v1->album);
+                break;
+            case Tag::TRACKNUMBER:
+                if(id3v1->track != 0)
+                {
+                    deliver(tag, std::string_view(track, track_end));
+                }
+                break;
+            case Tag::GENRE:
+                deliver(tag, ID3v1::genre_name(id3v1->genre));
+                break;
+            case Tag::YEAR:
+                deliver(tag, id3v1->year);
+                break;
+            case Tag::DISCNUMBER:
+                break;
+            }
+        }
+    }
+}
+
+TrackMetadata to_track_metadata(const MpegFile &file)
+{
+    TrackMetadata metadata;
+
+    visit_track_values(file, TrackTags, [&metadata](Tag tag, std::string_view value) {
+        switch(tag)
+        {
+        case Tag::TITLE:
+            metadata.title = value;
+            break;
+        case Tag::ARIST:
+            metadata.artist = value;
+            break;
+        case Tag::ALBUM:
+            metadata.album = value;
+            break;
+        case Tag::GENRE:
+            metadata.genre = value;
+            break;
+        case Tag::TRACKNUMBER:
+            metadata.track = parse_number(value);
+            break;
+        case Tag::DISCNUMBER:
+            metadata.disc = parse_number(value);
+            break;
+        case Tag::YEAR:
+            metadata.year = parse_number(value);
+            break;
+        }
+    });
+
+    if(const auto &properties = file.audio_properties())
+    {
+        metadata.duration_ms = static_cast<std::uint32_t>(properties->duration.count());
+    }
+
+    return metadata;
+}
+} // namespace audiotag
@@ -0,0 +1,523 @@
+#include "audiotag/watcher.hpp"
+
+#include "file_io.hpp"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace audiotag
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t WatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE |
+                                    IN_DELETE | IN_ONLYDIR | IN_EXCL_UNLINK;
+constexpr std::size_t EventBufferSize{ 64 * 1024 };
+
+bool is_within(std::string_view path, std::string_view directory)
+{
+    return path.starts_with(directory) &&
+           (path.size() == directory.size() || path[directory.size()] == '/');
+}
+} // namespace
+
+struct LibraryWatcher::Impl
+{
+    std::vector<std::string> roots;
+    WatchSink sink;
+    WatchOptions options;
+    FileDescriptor inotify;
+
+    std::unordered_map<int, std::string> watches;
+    // version of every file under the roots as last delivered, rescans report
+    // the difference to what they find
+    std::map<std::string, FileKey> known;
+    // subtrees beyond the watch limit, rescanned periodically
+    std::set<std::string> unwatched;
+    Clock::time_point next_rescan;
+
+    // deadlines of files to parse and of directories to watch and scan
+    std::map<std::string, Clock::time_point> pending_files;
+    std::map<std::string, Clock::time_point> pending_directories;
+
+    std::vector<std::byte> buffer;
+    std::size_t delivered{ 0 };
+
+    Impl(std::span<const std::string> roots, WatchSink &&sink, WatchOptions &&options)
+    : roots{ roots.begin(), roots.end() }
+    , sink{ std::move(sink) }
+    , options{ std::move(options) }
+    , inotify{ inotify_init1(IN_NONBLOCK | IN_CLOEXEC) }
+    , buffer(EventBufferSize)
+    {
+        if(inotify.get() < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Couldn't initialize inotify");
+        }
+
+        for(const auto &root : this->roots)
+        {
+            watch_tree(root);
+            list_files(root, [&](std::string &&path, const FileKey &key) {
+                known.emplace(std::move(path), key);
+            });
+        }
+        next_rescan = Clock::now() + this->options.rescan_interval;
+    }
+
+    bool watch_directory(const std::string &directory)
+    {
+        const auto watch = inotify_add_watch(inotify.get(), directory.c_str(), WatchMask);
+        if(watch < 0)
+        {
+            // out of watches, the subtree falls back to periodic rescans
+            if(errno == ENOSPC)
+            {
+                unwatched.insert(directory);
+            }
+            return false;
+        }
+
+        // adding a watched directory again returns its watch, which updates
+        // the path of directories that were moved; only new watches count
+        // against the limit
+        const auto watched = watches.find(watch);
+        if(watched != watches.end())
+        {
+            // a followed symlink leads to a directory still watched under its
+            // first path; its tree is watched already and may hold the link
+            std::error_code error;
+            if(watched->second != directory &&
+                std::filesystem::equivalent(watched->second, directory, error))
+            {
+                return false;
+            }
+
+            watched->second = directory;
+            return true;
+        }
+
+        if(options.max_watches != 0 && watches.size() >= options.max_watches)
+        {
+            inotify_rm_watch(inotify.get(), watch);
+            unwatched.insert(directory);
+            return false;
+        }
+
+        watches.emplace(watch, directory);
+        return true;
+    }
+
+    // Options of the walks over a tree, following directory symlinks as scans do
+    std::filesystem::directory_options walk_options() const
+    {
+        auto directory_options = std::filesystem::directory_options::skip_permission_denied;
+        if(options.scan_options.follow_symlinks)
+        {
+            directory_options |= std::filesystem::directory_options::follow_directory_symlink;
+        }
+        return directory_options;
+    }
+
+    void watch_tree(const std::string &root)
+    {
+        if(!watch_directory(root))
+        {
+            return;
+        }
+
+        namespace fs = std::filesystem;
+
+        std::error_code error;
+        auto it = fs::recursive_directory_iterator(root, walk_options(), error);
+        for(; !error && it != fs::recursive_directory_iterator(); it.increment(error))
+        {
+            std::error_code status_error;
+            if((!options.scan_options.follow_symlinks && it->is_symlink(status_error)) ||
+                !it->is_directory(status_error))
+            {
+                continue;
+            }
+
+            // also stops at symlinks looping back into the tree
+            if(!watch_directory(it->path().string()))
+            {
+                it.disable_recursion_pending();
+            }
+        }
+    }
+
+    void unwatch_tree(const std::string &directory)
+    {
+        for(auto it = watches.begin(); it != watches.end();)
+        {
+            if(is_within(it->second, directory))
+            {
+                inotify_rm_watch(inotify.get(), it->first);
+                it = watches.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        std::erase_if(unwatched, [&](const auto &path) { return is_within(path, directory); });
+    }
+
+    // Calls `visit` with the path and key of every file under `directory` the
+    // scan options select; returns false when the listing was cut short
+    template <typename Visit> bool list_files(const std::string &directory, Visit &&visit) const
+    {
+        namespace fs = std::filesystem;
+
+        std::error_code error;
+        auto it = fs::recursive_directory_iterator(directory, walk_options(), error);
+        for(; !error && it != fs::recursive_directory_iterator(); it.increment(error))
+        {
+            std::error_code status_error;
+            if((!options.scan_options.follow_symlinks && it->is_symlink(status_error)) ||
+                !it->is_regular_file(status_error) ||
+                !has_extension(it->path().filename().native(), options.scan_options.extensions))
+            {
+                continue;
+            }
+
+            auto path = it->path().string();
+            if(const auto key = read_file_key(path))
+            {
+                visit(std::move(path), *key);
+            }
+        }
+
+        return !error;
+    }
+
+    void emit(WatchEventKind kind, ScanResult &&result)
+    {
+        ++delivered;
+        sink(WatchEvent{ .kind = kind, .result = std::move(result) });
+    }
+
+    void emit_removed(std::string path)
+    {
+        emit(WatchEventKind::Removed,
+            ScanResult{ .path = std::move(path), .error = {}, .file = std::nullopt });
+    }
+
+    void forget_tree(const std::string &directory)
+    {
+        const auto first = known.lower_bound(directory + '/');
+        auto last = first;
+        while(last != known.end() && is_within(last->first, directory))
+        {
+            ++last;
+        }
+        known.erase(first, last);
+    }
+
+    // Whether anything below `path` is watched or known, i.e. it was a directory
+    bool holds_tree(const std::string &path) const
+    {
+        const auto first = known.lower_bound(path + '/');
+        return (first != known.end() && is_within(first->first, path)) ||
+               std::any_of(watches.begin(), watches.end(),
+                   [&](const auto &watch) { return is_within(watch.second, path); });
+    }
+
+    // Drops a directory that is gone along with everything known below it
+    void remove_tree(std::string &&path)
+    {
+        unwatch_tree(path);
+        forget_tree(path);
+        std::erase_if(pending_files, [&](const auto &file) { return is_within(file.first, path); });
+        std::erase_if(pending_directories,
+            [&](const auto &directory) { return is_within(directory.first, path); });
+        emit_removed(std::move(path));
+    }
+
+    void read_events()
+    {
+        while(true)
+        {
+            const auto size = read(inotify.get(), buffer.data(), buffer.size());
+            if(size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(size <= 0)
+            {
+                return;
+            }
+
+            for(std::size_t offset = 0; offset < static_cast<std::size_t>(size);)
+            {
+                inotify_event event{};
+                std::memcpy(&event, buffer.data() + offset, sizeof(event));
+                const auto *name = reinterpret_cast<const char *>(
+                    buffer.data() + offset + sizeof(inotify_event));
+                offset += sizeof(inotify_event) + event.len;
+
+                handle(event, std::string_view(name, event.len > 0 ? std::strlen(name) : 0));
+            }
+        }
+    }
+
+    void handle(const inotify_event &event, std::string_view name)
+    {
+        const auto deadline = Clock::now() + options.debounce;
+
+        // the kernel dropped events, nothing short of a full rescan is reliable
+        if((event.mask & IN_Q_OVERFLOW) != 0)
+        {
+            for(const auto &root : roots)
+            {
+                pending_directories[root] = deadline;
+            }
+            return;
+        }
+
+        const auto watch = watches.find(event.wd);
+        if(watch == watches.end())
+        {
+            return;
+        }
+
+        if((event.mask & IN_IGNORED) != 0)
+        {
+            watches.erase(watch);
+            return;
+        }
+
+        if(name.empty())
+        {
+            return;
+        }
+
+        auto path = watch->second;
+        path.push_back('/');
+        path.append(name);
+
+        if((event.mask & IN_ISDIR) != 0)
+        {
+            if((event.mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+            {
+                pending_directories[path] = deadline;
+            }
+            else if((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+            {
+                remove_tree(std::move(path));
+            }
+            return;
+        }
+
+        // symlinks come without IN_ISDIR even when they lead to a directory
+        if(options.scan_options.follow_symlinks)
+        {
+            std::error_code error;
+            if((event.mask & (IN_CREATE | IN_MOVED_TO)) != 0 &&
+                std::filesystem::is_directory(path, error))
+            {
+                pending_directories[path] = deadline;
+                return;
+            }
+
+            if((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0 && holds_tree(path))
+            {
+                remove_tree(std::move(path));
+                return;
+            }
+        }
+
+        if(!has_extension(name, options.scan_options.extensions))
+        {
+            return;
+        }
+
+        if((event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+        {
+            pending_files[std::move(path)] = deadline;
+        }
+        else if((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+        {
+            pending_files.erase(path);
+            known.erase(path);
+            emit_removed(std::move(path));
+        }
+    }
+
+    // Queues the files under `directory` that are new or changed since they
+    // were delivered and reports the ones that are gone
+    void rescan(const std::string &directory)
+    {
+        const auto now = Clock::now();
+
+        std::unordered_set<std::string> found;
+        const auto complete = list_files(directory, [&](std::string &&path, const FileKey &key) {
+            const auto known_file = known.find(path);
+            if(known_file == known.end() || !(known_file->second == key))
+            {
+                pending_files.try_emplace(path, now);
+            }
+            found.insert(std::move(path));
+        });
+
+        // files a listing cut short missed are not gone, unless the whole directory is
+        std::error_code error;
+        if(!complete && std::filesystem::exists(directory, error))
+        {
+            return;
+        }
+
+        auto it = known.lower_bound(directory + '/');
+        while(it != known.end() && is_within(it->first, directory))
+        {
+            if(found.contains(it->first))
+            {
+                ++it;
+                continue;
+            }
+
+            pending_files.erase(it->first);
+            emit_removed(it->first);
+            it = known.erase(it);
+        }
+    }
+
+    void deliver_due()
+    {
+        const auto now = Clock::now();
+
+        while(!pending_directories.empty())
+        {
+            const auto due = std::find_if(pending_directories.begin(), pending_directories.end(),
+                [now](const auto &directory) { return directory.second <= now; });
+            if(due == pending_directories.end())
+            {
+                break;
+            }
+
+            const auto directory = due->first;
+            pending_directories.erase(due);
+
+            watch_tree(directory);
+            rescan(directory);
+        }
+
+        for(auto it = pending_files.begin(); it != pending_files.end();)
+        {
+            if(it->second > now)
+            {
+                ++it;
+                continue;
+            }
+
+            auto result = scan_file(it->first, options.scan_options);
+            it = pending_files.erase(it);
+
+            if(result.error == std::errc::no_such_file_or_directory)
+            {
+                known.erase(result.path);
+                emit_removed(std::move(result.path));
+            }
+            else
+            {
+                known.insert_or_assign(result.path, result.key);
+                emit(WatchEventKind::Updated, std::move(result));
+            }
+        }
+
+        if(!unwatched.empty() && now >= next_rescan)
+        {
+            next_rescan = now + options.rescan_interval;
+
+            const auto subtrees = unwatched;
+            for(const auto &subtree : subtrees)
+            {
+                rescan(subtree);
+            }
+        }
+    }
+
+    // Time until the earliest deadline, capped at `timeout`
+    std::chrono::milliseconds wait_time(std::chrono::milliseconds timeout) const
+    {
+        auto next = Clock::now() + timeout;
+        for(const auto &pending : { &pending_files, &pending_directories })
+        {
+            for(const auto &[path, deadline] : *pending)
+            {
+                next = std::min(next, deadline);
+            }
+        }
+        if(!unwatched.empty())
+        {
+            next = std::min(next, next_rescan);
+        }
+
+        const auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - Clock::now());
+        return std::max(wait, std::chrono::milliseconds(0));
+    }
+};
+
+LibraryWatcher::LibraryWatcher(
+    std::span<const std::string> roots, WatchSink sink, WatchOptions options)
+: impl(std::make_unique<Impl>(roots, std::move(sink), std::move(options)))
+{
+}
+
+LibraryWatcher::~LibraryWatcher() = default;
+
+int LibraryWatcher::file_descriptor() const
+{
+    return impl->inotify.get();
+}
+
+std::size_t LibraryWatcher::watch_count() const
+{
+    return impl->watches.size();
+}
+
+std::size_t LibraryWatcher::unwatched_count() const
+{
+    return impl->unwatched.size();
+}
+
+std::size_t LibraryWatcher::poll(std::chrono::milliseconds timeout)
+{
+    impl->delivered = 0;
+
+    pollfd descriptor{ .fd = impl->inotify.get(), .events = POLLIN, .revents = 0 };
+    const auto ready = ::poll(&descriptor, 1, static_cast<int>(impl->wait_time(timeout).count()));
+    if(ready > 0)
+    {
+        impl->read_events();
+    }
+
+    impl->deliver_due();
+    return impl->delivered;
+}
+
+void LibraryWatcher::run(std::stop_token stop)
+{
+    while(!stop.stop_requested())
+    {
+        poll(std::chrono::milliseconds(100));
+    }
+}
+} // namespace audiotag
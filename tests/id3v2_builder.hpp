@@ -6,10 +6,27 @@
 
 #include <bit>
 #include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace audiotag
 {
+// Applies ID3v2 unsynchronization, a 0x00 is inserted after every 0xFF
+inline std::vector<std::byte> unsynchronize(std::span<const std::byte> data)
+{
+    std::vector<std::byte> out;
+    for(const auto byte : data)
+    {
+        out.push_back(byte);
+        if(byte == std::byte{ 0xFF })
+        {
+            out.push_back(std::byte{ 0x00 });
+        }
+    }
+    return out;
+}
+
 class ID3v2Builder : private DataBuilder
 {
 public:
@@ -50,6 +67,12 @@ public:
         write(text, endianness);
     }
 
+    void add_frame(FrameHeader header, std::span<const std::byte> data)
+    {
+        write_frame_header(header, data.size());
+        write(data);
+    }
+
     void write_frame_header(FrameHeader &header, std::uint32_t size)
     {
         write(std::string(header.frame_id));
@@ -0,0 +1,191 @@
+#include "data_builder.hpp"
+#include "id3v1_builder.hpp"
+#include "id3v2_builder.hpp"
+#include "vector_reader.hpp"
+
+#include <audiotag/async_reader.hpp>
+#include <audiotag/file_reader.hpp>
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+// AsyncReader over memory whose reads complete without suspending
+class MemoryAsyncReader
+{
+public:
+    struct ReadAwaiter
+    {
+        std::size_t bytes_read;
+
+        bool await_ready() const noexcept
+        {
+            return true;
+        }
+
+        void await_suspend(std::coroutine_handle<>) const noexcept
+        {
+        }
+
+        std::size_t await_resume() const noexcept
+        {
+            return bytes_read;
+        }
+    };
+
+    explicit MemoryAsyncReader(const std::vector<std::byte> &data)
+    : data{ data }
+    {
+    }
+
+    std::size_t length() const
+    {
+        return data.size();
+    }
+
+    std::size_t buffer_size() const
+    {
+        return 1024;
+    }
+
+    ReadAwaiter read_at(std::size_t offset, std::span<std::byte> buffer)
+    {
+        ++reads;
+        const auto count = offset < data.size() ? std::min(buffer.size(), data.size() - offset) : 0;
+        std::memcpy(buffer.data(), data.data() + offset, count);
+        return { count };
+    }
+
+    std::size_t reads{ 0 };
+
+private:
+    const std::vector<std::byte> &data;
+};
+
+static_assert(AsyncReader<MemoryAsyncReader>);
+static_assert(AsyncReader<AsyncFile>);
+
+Task<void> read_title(IoLoop &loop, std::string path, std::string &title, std::thread::id &thread)
+{
+    auto file = co_await AsyncFile::open(loop, std::move(path));
+    const auto mpeg = co_await read_mpeg(file);
+
+    title = mpeg.id3v2() ? mpeg.id3v2()->getStringValue(Tag::TITLE) : std::string{};
+    thread = std::this_thread::get_id();
+}
+
+template <AsyncReader R> Task<void> read_into(R &reader, std::optional<MpegFile> &file)
+{
+    const ReadOptions options{ .id3v2_filter = {}, .audio_properties = true };
+    file.emplace(co_await read_mpeg(reader, options));
+}
+
+void check_interleaved_reads(const IoLoopOptions &options)
+{
+    const std::vector<std::string> names = {
+        "/id3v2_id3v1.mp3",
+        "/id3v2_only.mp3",
+        "/ape.mp3",
+        "/no_tags.mp3",
+    };
+
+    IoLoop loop{ options };
+
+    // far more reads in flight than the loop has threads or queue entries
+    constexpr std::size_t read_count{ 1000 };
+    std::vector<std::string> titles(read_count);
+    std::vector<std::thread::id> threads(read_count);
+    for(std::size_t i = 0; i < read_count; ++i)
+    {
+        const auto path = TEST_DATA_DIR + names[i % names.size()];
+        loop.spawn(read_title(loop, path, titles[i], threads[i]));
+    }
+    CHECK(loop.active_tasks() > 0);
+
+    loop.run();
+    CHECK(loop.active_tasks() == 0);
+
+    for(std::size_t i = 0; i < read_count; ++i)
+    {
+        CHECK(titles[i] == (i % names.size() < 2 ? "Sample title" : ""));
+        CHECK(threads[i] == std::this_thread::get_id());
+    }
+}
+} // namespace
+
+TEST_CASE("ReadMpegThroughIoLoop")
+{
+    check_interleaved_reads({ .queue_depth = 8, .thread_count = 0, .use_io_uring = true });
+}
+
+TEST_CASE("ReadMpegThroughThreadPoolLoop")
+{
+    IoLoopOptions options{ .queue_depth = 8, .thread_count = 4, .use_io_uring = false };
+    CHECK_FALSE(IoLoop{ options }.uses_io_uring());
+    check_interleaved_reads(options);
+}
+
+TEST_CASE("ReadMpegFetchesWhatTheWindowsMiss")
+{
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, std::string(20'000, 't'));
+    id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Large tag artist");
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+    builder.write(std::byte{ 0xAA }, 50'000);
+    builder.write(ID3v1Builder::build(ID3v1::Tags{
+        .title = "Sample title",
+        .artist = "",
+        .album = "",
+        .year = "",
+        .comment = "",
+        .track = 0,
+        .genre = 255,
+    }));
+    const auto data = builder.build();
+
+    MemoryAsyncReader async_reader{ data };
+    std::optional<MpegFile> file;
+    IoLoop loop;
+    loop.spawn(read_into(async_reader, file));
+    loop.run();
+
+    VectorReader reader{ data };
+    const MpegFile expected{ reader, ReadOptions{ .id3v2_filter = {}, .audio_properties = true } };
+
+    REQUIRE(file);
+    REQUIRE(file->id3v2());
+    CHECK(file->id3v2()->getStringValue(Tag::TITLE) == std::string(20'000, 't'));
+    CHECK(file->id3v2()->getStringValue(Tag::ARIST) == "Large tag artist");
+    REQUIRE(file->id3v1());
+    CHECK(file->id3v1()->title == "Sample title");
+    CHECK(file->audio_range().offset == expected.audio_range().offset);
+    CHECK(file->audio_range().length == expected.audio_range().length);
+    // head and tail windows, then the rest of the tag
+    CHECK(async_reader.reads > 2);
+}
+
+TEST_CASE("ReadMpegRethrowsOpenFailure")
+{
+    IoLoop loop;
+    std::string title;
+    std::thread::id thread;
+    loop.spawn(read_title(loop, TEST_DATA_DIR "/missing.mp3", title, thread));
+    CHECK_THROWS_AS(loop.run(), std::system_error);
+}
@@ -0,0 +1,188 @@
+#include "data_builder.hpp"
+#include "vector_reader.hpp"
+
+#include <audiotag/file_reader.hpp>
+#include <audiotag/mpeg/audio_properties.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <doctest/doctest.h>
+
+#include <random>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+// MPEG1 layer 3, 128 kbit/s, 44100 Hz, joint stereo, 417 byte frames
+constexpr std::uint8_t cbr_header[4] = { 0xFF, 0xFB, 0x90, 0x44 };
+constexpr std::size_t cbr_frame_size{ 417 };
+
+ReadOptions with_audio_properties()
+{
+    return ReadOptions{ .id3v2_filter = {}, .audio_properties = true };
+}
+
+void write_frame(DataBuilder &builder, std::span<const std::uint8_t> header)
+{
+    builder.write(header);
+    builder.write(std::byte{ 0 }, cbr_frame_size - header.size());
+}
+} // namespace
+
+TEST_CASE("MpegFrameHeaderParsing")
+{
+    const auto cbr = MPEG::parse_frame_header(std::as_bytes(std::span(cbr_header)));
+    REQUIRE(cbr);
+    CHECK(cbr->version == MPEG::Version::MPEG1);
+    CHECK(cbr->layer == 3);
+    CHECK(cbr->bitrate == 128);
+    CHECK(cbr->sample_rate == 44100);
+    CHECK(cbr->channel_mode == MPEG::ChannelMode::JointStereo);
+    CHECK(cbr->frame_size == cbr_frame_size);
+    CHECK(cbr->samples == 1152);
+
+    // MPEG2 layer 3, 64 kbit/s, 22050 Hz, padded, mono
+    const std::uint8_t mpeg2[4] = { 0xFF, 0xF3, 0x82, 0xC4 };
+    const auto lsf = MPEG::parse_frame_header(std::as_bytes(std::span(mpeg2)));
+    REQUIRE(lsf);
+    CHECK(lsf->version == MPEG::Version::MPEG2);
+    CHECK(lsf->bitrate == 64);
+    CHECK(lsf->sample_rate == 22050);
+    CHECK(lsf->padding);
+    CHECK(lsf->channel_mode == MPEG::ChannelMode::Mono);
+    CHECK(lsf->samples == 576);
+    CHECK(lsf->frame_size == 72 * 64000 / 22050 + 1);
+
+    // free format, reserved sample rate and reserved version
+    const std::uint8_t invalid[3][4] = {
+        { 0xFF, 0xFB, 0x00, 0x44 },
+        { 0xFF, 0xFB, 0x9C, 0x44 },
+        { 0xFF, 0xEB, 0x90, 0x44 },
+    };
+    for(const auto &header : invalid)
+    {
+        CHECK_FALSE(MPEG::parse_frame_header(std::as_bytes(std::span(header))));
+    }
+}
+
+TEST_CASE("MpegFrameSyncScanMatchesScalarSearch")
+{
+    std::mt19937 generator{ 42 };
+    std::uniform_int_distribution<int> distribution{ 0, 0xFF };
+
+    for(std::size_t size = 0; size < 100; ++size)
+    {
+        std::vector<std::byte> data(size);
+        for(auto &byte : data)
+        {
+            // sync words stay rare so the vector loop runs over several blocks
+            const auto value = distribution(generator);
+            byte = std::byte(value == 0xFF && distribution(generator) > 0x20 ? 0xFE : value);
+        }
+
+        std::size_t expected{ size };
+        for(std::size_t i = 0; i + 1 < size; ++i)
+        {
+            if(data[i] == std::byte{ 0xFF } && (std::to_integer<int>(data[i + 1]) & 0xE0) == 0xE0)
+            {
+                expected = i;
+                break;
+            }
+        }
+
+        CHECK(MPEG::find_frame_sync(data) == expected);
+    }
+}
+
+TEST_CASE("MpegAudioPropertiesFromXingHeader")
+{
+    for(const auto *path : { TEST_DATA_DIR "/no_tags.mp3", TEST_DATA_DIR "/id3v2_only.mp3" })
+    {
+        FileReader reader{ path };
+        MpegFile file{ reader, with_audio_properties() };
+
+        const auto &properties = file.audio_properties();
+        REQUIRE(properties);
+        CHECK(properties->vbr_header == MPEG::VbrHeader::Xing);
+        CHECK(properties->version == MPEG::Version::MPEG1);
+        CHECK(properties->layer == 3);
+        CHECK(properties->sample_rate == 44100);
+        CHECK(properties->frame_count == 31);
+        CHECK(properties->duration == std::chrono::milliseconds(809));
+        CHECK(properties->bitrate == 13870 * 8 / 809);
+        CHECK(properties->encoder_delay == 576);
+        CHECK(properties->encoder_padding == 832);
+    }
+}
+
+TEST_CASE("MpegAudioPropertiesAreOptIn")
+{
+    FileReader reader{ TEST_DATA_DIR "/no_tags.mp3" };
+    MpegFile file{ reader };
+
+    CHECK_FALSE(file.audio_properties());
+}
+
+TEST_CASE("MpegAudioPropertiesFromVbriHeader")
+{
+    auto vbri = DataBuilder{};
+    vbri.write(std::byte{ 0 }, 32); // side info
+    vbri.write(std::string_view{ "VBRI" });
+    vbri.write(std::uint16_t{ 1 }, std::endian::big); // version
+    vbri.write(std::uint16_t{ 0 }, std::endian::big); // delay
+    vbri.write(std::uint16_t{ 75 }, std::endian::big); // quality
+    vbri.write(std::uint32_t{ 500'000 }, std::endian::big); // bytes
+    vbri.write(std::uint32_t{ 1'000 }, std::endian::big); // frames
+    const auto vbri_data = vbri.build();
+
+    auto builder = DataBuilder{};
+    builder.write(cbr_header);
+    builder.write(vbri_data);
+    builder.write(std::byte{ 0 }, cbr_frame_size - 4 - vbri_data.size());
+    for(int i = 0; i < 3; ++i)
+    {
+        write_frame(builder, cbr_header);
+    }
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader, with_audio_properties() };
+
+    const auto &properties = file.audio_properties();
+    REQUIRE(properties);
+    CHECK(properties->vbr_header == MPEG::VbrHeader::VBRI);
+    CHECK(properties->frame_count == 1'000);
+    CHECK(properties->duration == std::chrono::milliseconds(1'000 * 1152 * 1000 / 44100));
+}
+
+TEST_CASE("MpegAudioPropertiesEstimatedForConstantBitrate")
+{
+    constexpr std::size_t frame_count{ 2'000 };
+
+    auto builder = DataBuilder{};
+    // junk before the audio holding a lone sync word that is not followed by a frame
+    builder.write(std::byte{ 0x11 }, 100);
+    builder.write(std::byte{ 0xFF }, 1);
+    builder.write(std::byte{ 0xFB }, 1);
+    builder.write(std::byte{ 0x90 }, 1);
+    builder.write(std::byte{ 0x11 }, 300);
+    for(std::size_t i = 0; i < frame_count; ++i)
+    {
+        write_frame(builder, cbr_header);
+    }
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader, with_audio_properties() };
+
+    const auto &properties = file.audio_properties();
+    REQUIRE(properties);
+    CHECK(properties->vbr_header == MPEG::VbrHeader::None);
+    CHECK(properties->bitrate == 128);
+    CHECK(properties->frame_count == frame_count);
+    const auto audio_bits = frame_count * cbr_frame_size * 8;
+    CHECK(properties->duration == std::chrono::milliseconds(audio_bits / 128));
+
+    // a bounded sample of frames at the head, never the whole file
+    CHECK(reader.total_bytes_read() < 32 * 1024);
+}
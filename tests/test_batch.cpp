@@ -0,0 +1,224 @@
+#include "data_builder.hpp"
+#include "id3v2_builder.hpp"
+#include "test_files.hpp"
+
+#include <audiotag/batch.hpp>
+#include <doctest/doctest.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+std::string write_large_tag_file(const TemporaryDirectory &directory)
+{
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, std::string(20'000, 't'));
+    id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Large tag artist");
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+    builder.write(std::byte{ 0xAA }, 50'000);
+    const auto data = builder.build();
+
+    const auto path = directory.file("large_tag.mp3");
+    write_file(path, data);
+    return path;
+}
+
+// A sparse file whose leading tag claims almost 256 MiB, far more than
+// parse_with_memory_limit leaves the process
+std::string write_huge_tag_file(const TemporaryDirectory &directory)
+{
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(0x0FFF'FFFF);
+    const auto data = builder.build();
+
+    const auto path = directory.file("huge_tag.mp3");
+    write_file(path, data);
+    std::filesystem::resize_file(path, 0x1000'0000 + 1024);
+    return path;
+}
+
+std::vector<BatchResult> run_batch(
+    const std::vector<std::string> &paths, const BatchOptions &options)
+{
+    std::vector<BatchResult> results(paths.size());
+    std::size_t calls{ 0 };
+
+    read_mpeg_files(
+        paths,
+        [&](BatchResult &&result) {
+            ++calls;
+            results.at(result.index) = std::move(result);
+        },
+        options);
+
+    CHECK(calls == paths.size());
+    return results;
+}
+
+// Runs the batch with the address space capped, so buffering the huge tag throws
+std::vector<BatchResult> parse_with_memory_limit(
+    const std::vector<std::string> &paths, const BatchOptions &options)
+{
+    rlimit previous{};
+    REQUIRE(getrlimit(RLIMIT_AS, &previous) == 0);
+
+    std::size_t pages{ 0 };
+    std::ifstream{ "/proc/self/statm" } >> pages;
+    REQUIRE(pages > 0);
+
+    rlimit limited = previous;
+    limited.rlim_cur = pages * static_cast<rlim_t>(sysconf(_SC_PAGESIZE)) + 128 * 1024 * 1024;
+    REQUIRE(setrlimit(RLIMIT_AS, &limited) == 0);
+
+    std::vector<BatchResult> results;
+    try
+    {
+        results = run_batch(paths, options);
+    }
+    catch(...)
+    {
+        setrlimit(RLIMIT_AS, &previous);
+        throw;
+    }
+    setrlimit(RLIMIT_AS, &previous);
+    return results;
+}
+
+void check_results(const std::vector<BatchResult> &results)
+{
+    REQUIRE(results.size() == 4);
+
+    REQUIRE(results[0].file);
+    REQUIRE(results[0].file->id3v2());
+    CHECK(results[0].file->id3v2()->getStringValue(Tag::TITLE) == "Sample title");
+    CHECK(results[0].file->id3v1());
+
+    REQUIRE(results[1].file);
+    CHECK_FALSE(results[1].file->id3v2());
+    CHECK_FALSE(results[1].file->id3v1());
+
+    CHECK(results[2].error == std::errc::no_such_file_or_directory);
+    CHECK_FALSE(results[2].file);
+
+    REQUIRE(results[3].file);
+    REQUIRE(results[3].file->id3v2());
+    CHECK(results[3].file->id3v2()->getStringValue(Tag::TITLE) == std::string(20'000, 't'));
+    CHECK(results[3].file->id3v2()->getStringValue(Tag::ARIST) == "Large tag artist");
+}
+} // namespace
+
+TEST_CASE("ID3v2TagSizeCountsHeaderAndFooter")
+{
+    const auto header = [](std::uint8_t version, std::uint8_t flags) {
+        auto builder = DataBuilder{};
+        builder.write(ID3v2::Identifier);
+        builder.write(std::byte{ version }, 1); // version major
+        builder.write(std::byte{ 0 }, 1); // version minor
+        builder.write(std::byte{ flags }, 1);
+        builder.write_synch_safe(1000);
+        builder.write(std::byte{ 0 }, 20); // start of the frames
+        return builder.build();
+    };
+
+    CHECK(ID3v2::tag_size(header(4, 0)) == ID3v2::HeaderSize + 1000);
+    CHECK(ID3v2::tag_size(header(4, ID3v2::HeaderFlags::Footer)) == 2 * ID3v2::HeaderSize + 1000);
+    // v2.3 has no footer, the flag bit means nothing there
+    CHECK(ID3v2::tag_size(header(3, ID3v2::HeaderFlags::Footer)) == ID3v2::HeaderSize + 1000);
+    const auto short_header = header(4, 0);
+    CHECK(ID3v2::tag_size(std::span(short_header).first(ID3v2::HeaderSize - 1)) == 0);
+    CHECK(ID3v2::tag_size(std::vector<std::byte>(ID3v2::HeaderSize)) == 0);
+}
+
+TEST_CASE("BatchReadsFilesThroughIoUring")
+{
+    const TemporaryDirectory directory;
+
+    const std::vector<std::string> paths{
+        TEST_DATA_DIR "/id3v2_id3v1.mp3",
+        TEST_DATA_DIR "/no_tags.mp3",
+        TEST_DATA_DIR "/does_not_exist.mp3",
+        write_large_tag_file(directory),
+    };
+
+    check_results(run_batch(paths, BatchOptions{}));
+}
+
+TEST_CASE("BatchReadsFilesWithBlockingWorkers")
+{
+    const TemporaryDirectory directory;
+
+    const std::vector<std::string> paths{
+        TEST_DATA_DIR "/id3v2_id3v1.mp3",
+        TEST_DATA_DIR "/no_tags.mp3",
+        TEST_DATA_DIR "/does_not_exist.mp3",
+        write_large_tag_file(directory),
+    };
+
+    const auto options = BatchOptions{ .queue_depth = 0, .thread_count = 3, .use_io_uring = false };
+    check_results(run_batch(paths, options));
+}
+
+TEST_CASE("BatchReusesSlotsBeyondQueueDepth")
+{
+    const std::vector<std::string> paths(200, TEST_DATA_DIR "/id3v2_only.mp3");
+
+    const auto options = BatchOptions{ .queue_depth = 8, .thread_count = 0, .use_io_uring = true };
+    const auto results = run_batch(paths, options);
+    for(const auto &result : results)
+    {
+        REQUIRE(result.file);
+        CHECK(result.file->id3v2());
+    }
+}
+
+TEST_CASE("BatchReportsFilesWhoseParseThrows")
+{
+    const TemporaryDirectory directory;
+
+    const std::vector<std::string> paths{
+        write_huge_tag_file(directory),
+        TEST_DATA_DIR "/id3v2_id3v1.mp3",
+    };
+
+    const auto check = [](const std::vector<BatchResult> &results) {
+        CHECK(results[0].error == std::errc::not_enough_memory);
+        CHECK_FALSE(results[0].file);
+
+        REQUIRE(results[1].file);
+        CHECK(results[1].file->id3v2());
+    };
+
+    SUBCASE("io_uring")
+    {
+        check(parse_with_memory_limit(
+            paths, BatchOptions{ .queue_depth = 8, .thread_count = 0, .use_io_uring = true }));
+    }
+
+    SUBCASE("blocking workers")
+    {
+        check(parse_with_memory_limit(
+            paths, BatchOptions{ .queue_depth = 0, .thread_count = 1, .use_io_uring = false }));
+    }
+
+    std::filesystem::remove(paths[0]);
+}
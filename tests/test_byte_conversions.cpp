@@ -0,0 +1,231 @@
+#include "id3v2_builder.hpp"
+#include "test_files.hpp"
+
+#include <audiotag/byte_conversions.hpp>
+#include <doctest/doctest.h>
+
+#include <bit>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+std::string reference_latin1_to_utf8(const std::vector<std::byte> &data)
+{
+    std::string out;
+    for(const auto byte : data)
+    {
+        const auto character = std::to_integer<unsigned char>(byte);
+        if(character < 0x80)
+        {
+            out.push_back(character);
+        }
+        else
+        {
+            out.push_back(0xc0 | character >> 6);
+            out.push_back(0x80 | (character & 0x3f));
+        }
+    }
+    return out;
+}
+
+void append_code_point(
+    char32_t code_point, std::endian endianness, std::vector<std::byte> &utf16, std::string &utf8)
+{
+    const auto push_unit = [&](char32_t unit)
+    {
+        const auto high = std::byte(unit >> 8);
+        const auto low = std::byte(unit & 0xFF);
+        utf16.push_back(endianness == std::endian::big ? high : low);
+        utf16.push_back(endianness == std::endian::big ? low : high);
+    };
+
+    if(code_point < 0x10000)
+    {
+        push_unit(code_point);
+    }
+    else
+    {
+        push_unit(0xD800 + ((code_point - 0x10000) >> 10));
+        push_unit(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+    }
+
+    if(code_point < 0x80)
+    {
+        utf8.push_back(code_point);
+    }
+    else if(code_point < 0x800)
+    {
+        utf8.push_back(0xC0 | code_point >> 6);
+        utf8.push_back(0x80 | (code_point & 0x3F));
+    }
+    else if(code_point < 0x10000)
+    {
+        utf8.push_back(0xE0 | code_point >> 12);
+        utf8.push_back(0x80 | (code_point >> 6 & 0x3F));
+        utf8.push_back(0x80 | (code_point & 0x3F));
+    }
+    else
+    {
+        utf8.push_back(0xF0 | code_point >> 18);
+        utf8.push_back(0x80 | (code_point >> 12 & 0x3F));
+        utf8.push_back(0x80 | (code_point >> 6 & 0x3F));
+        utf8.push_back(0x80 | (code_point & 0x3F));
+    }
+}
+} // namespace
+
+TEST_CASE("Latin1ToUtf8MatchesScalarConversion")
+{
+    std::mt19937 generator{ 42 };
+
+    // sizes around the vector block widths exercise the scalar tails
+    for(std::size_t size = 0; size < 150; ++size)
+    {
+        for(const auto &[min, max] :
+            { std::pair{ 0x20, 0x7E }, std::pair{ 0x80, 0xFF }, std::pair{ 0, 0xFF } })
+        {
+            const auto data = random_bytes(generator, size, min, max);
+            CHECK(from_latin1_to_utf8(data) == reference_latin1_to_utf8(data));
+        }
+    }
+}
+
+TEST_CASE("Latin1ToUtf8MixedBlocks")
+{
+    std::vector<std::byte> data(64, std::byte{ 'a' });
+    data[5] = std::byte{ 0xE9 }; // é
+    data.resize(96, std::byte{ 0xFC }); // ü
+
+    const auto utf8 = from_latin1_to_utf8(data);
+    CHECK(utf8 == reference_latin1_to_utf8(data));
+    CHECK(utf8.substr(0, 8) == "aaaaa\xC3\xA9" "a");
+    CHECK(utf8.size() == 64 + 1 + 32 * 2);
+}
+
+TEST_CASE("RemoveUnsynchronizationRestoresOriginal")
+{
+    std::mt19937 generator{ 42 };
+
+    // sizes around the vector block widths, with 0xFF both rare and dense
+    for(std::size_t size = 0; size < 150; ++size)
+    {
+        for(const auto min : { 0xF0, 0xFE })
+        {
+            auto original = random_bytes(generator, size, min, 0xFF);
+            for(auto &byte : original)
+            {
+                byte = byte == std::byte{ 0xF0 } ? std::byte{ 0x00 } : byte;
+            }
+
+            auto data = unsynchronize(original);
+            const auto decoded_size = remove_unsynchronization(data);
+
+            REQUIRE(decoded_size == original.size());
+            data.resize(decoded_size);
+            CHECK(data == original);
+        }
+    }
+}
+
+TEST_CASE("RemoveUnsynchronizationKeepsUnpairedBytes")
+{
+    // 0xFF not followed by 0x00, and a lone 0x00 without a preceding 0xFF
+    std::vector<std::byte> data(40, std::byte{ 0x11 });
+    data[3] = std::byte{ 0xFF };
+    data[4] = std::byte{ 0xE0 };
+    data[10] = std::byte{ 0x00 };
+    data[31] = std::byte{ 0xFF };
+    data[32] = std::byte{ 0x00 };
+    data[33] = std::byte{ 0x00 };
+    data.back() = std::byte{ 0xFF };
+
+    auto expected = data;
+    expected.erase(expected.begin() + 32);
+
+    CHECK(remove_unsynchronization(data) == expected.size());
+    data.resize(expected.size());
+    CHECK(data == expected);
+}
+
+TEST_CASE("Utf16ToUtf8MatchesReferenceEncoding")
+{
+    std::mt19937 generator{ 42 };
+    std::uniform_int_distribution<int> kind{ 0, 9 };
+    std::uniform_int_distribution<char32_t> ascii{ 0x20, 0x7E };
+    std::uniform_int_distribution<char32_t> bmp{ 0x80, 0xD7FF };
+    std::uniform_int_distribution<char32_t> supplementary{ 0x10000, 0x10FFFF };
+
+    for(const auto endianness : { std::endian::little, std::endian::big })
+    {
+        // mostly ASCII runs so both the vector path and its fallbacks get exercised
+        for(std::size_t length = 0; length < 100; ++length)
+        {
+            std::vector<std::byte> utf16;
+            std::string expected;
+            for(std::size_t i = 0; i < length; ++i)
+            {
+                const auto k = kind(generator);
+                const auto code_point =
+                    k < 7 ? ascii(generator) : (k < 9 ? bmp(generator) : supplementary(generator));
+                append_code_point(code_point, endianness, utf16, expected);
+            }
+
+            CHECK(from_utf16_to_utf8(utf16, endianness) == expected);
+        }
+    }
+}
+
+TEST_CASE("Utf16ToUtf8HandlesBomAndInvalidInput")
+{
+    SUBCASE("Byte order is taken from the BOM")
+    {
+        const std::vector<std::byte> little{ std::byte{ 0xFF }, std::byte{ 0xFE },
+            std::byte{ 0xE9 }, std::byte{ 0x00 } };
+        const std::vector<std::byte> big{ std::byte{ 0xFE }, std::byte{ 0xFF }, std::byte{ 0x00 },
+            std::byte{ 0xE9 } };
+
+        CHECK(detect_bom(little) == std::endian::little);
+        CHECK(detect_bom(big) == std::endian::big);
+        CHECK(from_utf16_bom_to_utf8(little) == "\xC3\xA9");
+        CHECK(from_utf16_bom_to_utf8(big) == "\xC3\xA9");
+    }
+
+    SUBCASE("Missing BOM defaults to little endian")
+    {
+        const std::vector<std::byte> data{ std::byte{ 'a' }, std::byte{ 0x00 } };
+        CHECK_FALSE(detect_bom(data).has_value());
+        CHECK(from_utf16_bom_to_utf8(data) == "a");
+    }
+
+    SUBCASE("Unpaired surrogates are replaced")
+    {
+        std::vector<std::byte> data(64, std::byte{ 0x00 });
+        for(std::size_t i = 0; i < data.size(); i += 2)
+        {
+            data[i] = std::byte{ 'x' };
+        }
+        data[21] = std::byte{ 0xD8 }; // lone high surrogate inside a vector block
+        data.push_back(std::byte{ 0x00 });
+        data.push_back(std::byte{ 0xDC }); // lone low surrogate at the end
+        data.push_back(std::byte{ 0x41 }); // odd trailing byte
+
+        const auto utf8 = from_utf16_to_utf8(data, std::endian::little);
+        const std::string replacement{ "\xEF\xBF\xBD" };
+        CHECK(utf8 == std::string(10, 'x') + replacement + std::string(21, 'x') + replacement);
+    }
+
+    SUBCASE("Appends into an existing string")
+    {
+        std::string out{ "prefix " };
+        const std::vector<std::byte> data{ std::byte{ 'o' }, std::byte{ 0 }, std::byte{ 'k' },
+            std::byte{ 0 } };
+        append_utf16_as_utf8(data, std::endian::little, out);
+        CHECK(out == "prefix ok");
+    }
+}
@@ -0,0 +1,174 @@
+#include "test_files.hpp"
+
+#include <audiotag/columnar.hpp>
+#include <audiotag/file_reader.hpp>
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/scanner.hpp>
+#include <audiotag/track_metadata.hpp>
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+TEST_CASE("ColumnarExportRoundTrip")
+{
+    const TemporaryDirectory directory;
+
+    const std::vector<std::string> files = {
+        "id3v2_id3v1.mp3",
+        "id3v2_only.mp3",
+        "ape.mp3",
+        "no_tags.mp3",
+        "id3v1_ape.mp3",
+    };
+
+    const ReadOptions options{ .id3v2_filter = {}, .audio_properties = true };
+    ColumnarWriter writer;
+    for(const auto &name : files)
+    {
+        const auto path = std::string(TEST_DATA_DIR "/") + name;
+        FileReader reader{ path };
+        writer.add(path, MpegFile{ reader, options });
+    }
+    CHECK(writer.size() == files.size());
+
+    const auto path = directory.file("round_trip.columns");
+    writer.write(path);
+
+    const ColumnarReader reader{ path };
+    REQUIRE(reader.row_count() == files.size());
+
+    const auto paths = reader.strings(Column::Path);
+    const auto titles = reader.strings(Column::Title);
+    CHECK_FALSE(paths.is_dictionary());
+    CHECK(paths[1] == TEST_DATA_DIR "/id3v2_only.mp3");
+    CHECK(titles[0] == "Sample title");
+    CHECK(titles[3].empty());
+    CHECK(titles[4] == "Sample title");
+
+    const auto artists = reader.strings(Column::Artist);
+    REQUIRE(artists.is_dictionary());
+    CHECK(artists[0] == "Sample artist in UTF16");
+    CHECK(artists[1] == "画家");
+    CHECK(artists[2] == "Sample artist");
+    CHECK(artists[3].empty());
+    // "", three distinct artists, the last row reuses one
+    CHECK(artists.dictionary_size() == 4);
+    CHECK(artists.codes()[2] == artists.codes()[4]);
+    CHECK(artists.codes()[3] == 0);
+
+    const auto genres = reader.strings(Column::Genre);
+    CHECK(genres.dictionary_size() == 2);
+    CHECK(genres[0] == "Classical");
+    CHECK(genres[3].empty());
+
+    const auto tracks = reader.numbers(Column::Track);
+    REQUIRE(tracks.size() == files.size());
+    CHECK(tracks[0] == 3);
+    CHECK(tracks[3] == 0);
+
+    const auto durations = reader.numbers(Column::DurationMs);
+    CHECK(durations[0] > 0);
+
+    CHECK_THROWS_AS(reader.numbers(Column::Title), std::invalid_argument);
+    CHECK_THROWS_AS(reader.strings(Column::Year), std::invalid_argument);
+}
+
+TEST_CASE("ColumnarExportFromCache")
+{
+    const TemporaryDirectory directory;
+
+    MetadataCacheWriter cache_writer;
+    for(std::uint64_t i = 0; i < 100; ++i)
+    {
+        cache_writer.add(FileKey{ .device = 1, .inode = i, .size = 10, .mtime_ns = 0 },
+            "/music/" + std::to_string(i) + ".mp3",
+            TrackMetadata{
+                .title = "Title " + std::to_string(i),
+                .artist = "Artist " + std::to_string(i % 4),
+                .album = "",
+                .genre = "Jazz",
+                .track = static_cast<std::uint32_t>(i % 10),
+                .disc = 1,
+                .year = 2000,
+                .duration_ms = 1000,
+            });
+    }
+
+    const auto cache_path = directory.file("export.cache");
+    cache_writer.write(cache_path);
+    const MetadataCache cache{ cache_path };
+
+    ColumnarWriter writer;
+    for(std::size_t i = 0; i < cache.size(); ++i)
+    {
+        writer.add(cache[i].path(), cache[i]);
+    }
+
+    const auto path = directory.file("cache.columns");
+    writer.write(path);
+
+    const ColumnarReader reader{ path };
+    REQUIRE(reader.row_count() == 100);
+    CHECK(reader.strings(Column::Title)[42] == "Title 42");
+    CHECK(reader.strings(Column::Artist).dictionary_size() == 5);
+    CHECK(reader.strings(Column::Artist)[42] == "Artist 2");
+    CHECK(reader.strings(Column::Album).dictionary_size() == 1);
+    CHECK(reader.numbers(Column::Track)[42] == 2);
+    CHECK(reader.numbers(Column::Year)[99] == 2000);
+}
+
+TEST_CASE("ColumnarExportOfRenamedCachedFile")
+{
+    const TemporaryDirectory directory;
+    const auto old_path = directory.copy_test_file("id3v2_only.mp3", "old.mp3");
+
+    const auto parsed = scan_file(old_path);
+    REQUIRE(parsed.file);
+
+    MetadataCacheWriter cache_writer;
+    cache_writer.add(parsed.key, parsed.path, to_track_metadata(*parsed.file));
+    const auto cache_path = directory.file("renamed.cache");
+    cache_writer.write(cache_path);
+    const MetadataCache cache{ cache_path };
+
+    // a rename keeps the inode, size and mtime the cache is keyed by
+    const auto new_path = directory.file("new.mp3");
+    std::filesystem::rename(old_path, new_path);
+
+    const auto result = scan_file(new_path, ScanOptions{ .cache = &cache });
+    REQUIRE(result.cached);
+    CHECK(result.cached->path() == old_path);
+
+    ColumnarWriter writer;
+    writer.add(result.path, *result.cached);
+
+    const auto path = directory.file("renamed.columns");
+    writer.write(path);
+
+    const ColumnarReader reader{ path };
+    REQUIRE(reader.row_count() == 1);
+    CHECK(reader.strings(Column::Path)[0] == new_path);
+    CHECK(reader.strings(Column::Title)[0] == "Sample title");
+}
+
+TEST_CASE("ColumnarReaderRejectsOtherFiles")
+{
+    const TemporaryDirectory directory;
+
+    const auto path = directory.file("empty.columns");
+    ColumnarWriter{}.write(path);
+    CHECK(ColumnarReader{ path }.row_count() == 0);
+
+    // truncated into the descriptors
+    std::filesystem::resize_file(path, sizeof(ColumnarHeader) + sizeof(ColumnDescriptor));
+    CHECK_THROWS_AS(ColumnarReader{ path }, std::runtime_error);
+
+    std::ofstream{ path, std::ios::trunc } << std::string(200, 'x');
+    CHECK_THROWS_AS(ColumnarReader{ path }, std::runtime_error);
+}
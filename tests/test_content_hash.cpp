@@ -0,0 +1,108 @@
+#include "test_files.hpp"
+#include "vector_reader.hpp"
+
+#include <audiotag/content_hash.hpp>
+#include <audiotag/file_reader.hpp>
+#include <audiotag/mmap_reader.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <doctest/doctest.h>
+
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+std::span<const std::byte> bytes_of(std::string_view text)
+{
+    return std::as_bytes(std::span(text.data(), text.size()));
+}
+} // namespace
+
+TEST_CASE("Xxh64MatchesReferenceValues")
+{
+    CHECK(Xxh64::hash(bytes_of("")) == 0xEF46DB3751D8E999);
+    CHECK(Xxh64::hash(bytes_of("a")) == 0xD24EC4F1A98C6E5B);
+    CHECK(Xxh64::hash(bytes_of("abc")) == 0x44BC2CF5AD770999);
+    CHECK(Xxh64::hash(bytes_of("Nobody inspects the spammish repetition")) == 0xFBCEA83C8A378BF1);
+
+    std::vector<std::byte> counting(2560);
+    for(std::size_t i = 0; i < counting.size(); ++i)
+    {
+        counting[i] = std::byte(i);
+    }
+    CHECK(Xxh64::hash(counting, 0x9E3779B1) == 0xF98DCDC27301B680);
+}
+
+TEST_CASE("Xxh64StreamingMatchesOneShot")
+{
+    std::mt19937 generator{ 1 };
+    const auto data = random_bytes(generator, 1000);
+    const auto expected = Xxh64::hash(data, 7);
+
+    for(int attempt = 0; attempt < 20; ++attempt)
+    {
+        Xxh64 state{ 7 };
+
+        std::size_t offset{ 0 };
+        while(offset < data.size())
+        {
+            const auto remaining = data.size() - offset;
+            std::uniform_int_distribution<std::size_t> split{
+                0, std::min<std::size_t>(70, remaining) };
+            const auto size = split(generator);
+            state.update(std::span(data).subspan(offset, size));
+            offset += size;
+        }
+
+        CHECK(state.digest() == expected);
+    }
+}
+
+TEST_CASE("AudioHashIgnoresTags")
+{
+    for(const auto *path : { TEST_DATA_DIR "/no_tags.mp3", TEST_DATA_DIR "/ape.mp3",
+            TEST_DATA_DIR "/id3v1_ape.mp3", TEST_DATA_DIR "/id3v2_only.mp3",
+            TEST_DATA_DIR "/id3v2_id3v1.mp3" })
+    {
+        FileReader reader{ path };
+        MpegFile file{ reader };
+
+        const auto range = file.audio_range();
+        CHECK(range.length == 13870);
+        CHECK(hash_range(reader, range) == 0xB0D04692E54272B7);
+
+        MmapReader mapped{ path };
+        CHECK(hash_range(mapped, range) == 0xB0D04692E54272B7);
+    }
+
+    FileReader reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+    MpegFile file{ reader };
+    CHECK(file.audio_range().offset == 1090);
+}
+
+TEST_CASE("ChunkedHashDoesNotDependOnThreadsOrReadSize")
+{
+    std::mt19937 generator{ 42 };
+    const auto data = random_bytes(generator, 2 * HashChunkSize + 12'345);
+    const VectorReader reader{ data };
+    const ReadPlanner::Range range{ 100, data.size() - 100 };
+
+    // chunk digests combined in order
+    Xxh64 combined{ 3 };
+    for(std::size_t offset = 0; offset < range.length; offset += HashChunkSize)
+    {
+        const auto length = std::min(HashChunkSize, range.length - offset);
+        const auto digest = Xxh64::hash(std::span(data).subspan(range.offset + offset, length), 3);
+        combined.update(std::as_bytes(std::span(&digest, 1)));
+    }
+    const auto expected = combined.digest();
+
+    CHECK(hash_range(reader, range, { .thread_count = 1, .read_size = 1024 * 1024, .seed = 3 }) ==
+          expected);
+    CHECK(hash_range(reader, range, { .thread_count = 4, .read_size = 10'000, .seed = 3 }) ==
+          expected);
+    CHECK(hash_range(reader, range, { .thread_count = 0, .read_size = 1, .seed = 3 }) == expected);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdlib.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audiotag
+{
+// Fresh directory under the system temporary directory, removed with its
+// contents on destruction. Each one gets a unique name, so test cases and
+// concurrent test runs never share files.
+class TemporaryDirectory
+{
+public:
+    TemporaryDirectory()
+    {
+        auto pattern = (std::filesystem::temp_directory_path() / "audiotag_XXXXXX").string();
+        if(mkdtemp(pattern.data()) == nullptr)
+        {
+            throw std::runtime_error("Couldn't create temporary directory");
+        }
+        directory = pattern;
+    }
+
+    ~TemporaryDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+    }
+
+    TemporaryDirectory(const TemporaryDirectory &) = delete;
+    TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+    const std::filesystem::path &path() const
+    {
+        return directory;
+    }
+
+    std::string file(std::string_view name) const
+    {
+        return (directory / name).string();
+    }
+
+    // Copies a file of the test data into the directory as `target`, by default
+    // under its own name
+    std::string copy_test_file(std::string_view name, std::string_view target = {}) const
+    {
+        const auto path = directory / (target.empty() ? name : target);
+        std::filesystem::copy_file(std::filesystem::path(TEST_DATA_DIR) / name, path,
+            std::filesystem::copy_options::overwrite_existing);
+        return path.string();
+    }
+
+private:
+    std::filesystem::path directory;
+};
+
+inline std::vector<std::byte> read_file(const std::string &path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    std::vector<char> data{ std::istreambuf_iterator<char>(file), {} };
+    const auto bytes = std::as_bytes(std::span(data));
+    return { bytes.begin(), bytes.end() };
+}
+
+inline void write_file(const std::string &path, std::span<const std::byte> data)
+{
+    std::ofstream{ path, std::ios::binary }.write(
+        reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+inline std::vector<std::byte> random_bytes(
+    std::mt19937 &generator, std::size_t size, int min = 0x00, int max = 0xFF)
+{
+    std::uniform_int_distribution<int> distribution{ min, max };
+
+    std::vector<std::byte> data(size);
+    for(auto &byte : data)
+    {
+        byte = std::byte(distribution(generator));
+    }
+    return data;
+}
+} // namespace audiotag
@@ -0,0 +1,176 @@
+#include "data_builder.hpp"
+#include "id3v2_builder.hpp"
+#include "test_files.hpp"
+
+#include <audiotag/file_reader.hpp>
+#include <audiotag/id3v2_stream.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+struct StreamedFrame
+{
+    std::string id;
+    std::vector<std::byte> data;
+};
+
+struct StreamedTag
+{
+    std::optional<ID3v2::Header> header;
+    std::vector<StreamedFrame> frames;
+    // bytes of the stream the feeds returned as not belonging to the tag
+    std::size_t rejected{ 0 };
+    std::size_t skipped_frames{ 0 };
+};
+
+// Feeds `data` in chunks of `chunk_size`, as a pipe or socket would deliver it
+StreamedTag parse_stream(
+    std::span<const std::byte> data, std::size_t chunk_size, ID3v2::StreamOptions options = {})
+{
+    StreamedTag tag;
+    ID3v2::StreamParser parser{
+        [&tag](const ID3v2::Header &header) { tag.header = header; },
+        [&tag](const ID3v2::FrameView &frame) {
+            tag.frames.push_back({ std::string(reinterpret_cast<const char *>(frame.id.data()), 4),
+                { frame.data.begin(), frame.data.end() } });
+        },
+        std::move(options),
+    };
+
+    for(std::size_t offset = 0; offset < data.size(); offset += chunk_size)
+    {
+        const auto chunk = data.subspan(offset, std::min(chunk_size, data.size() - offset));
+        tag.rejected += chunk.size() - parser.feed(chunk);
+    }
+
+    CHECK(parser.consumed() + tag.rejected == data.size());
+    tag.skipped_frames = parser.skipped_frames();
+    return tag;
+}
+} // namespace
+
+TEST_CASE("StreamParserMatchesMpegFile")
+{
+    for(const auto *name : { "/id3v2_id3v1.mp3", "/id3v2_only.mp3" })
+    {
+        const auto path = std::string(TEST_DATA_DIR) + name;
+        const auto data = read_file(path);
+
+        FileReader reader{ path };
+        const MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+        const auto &frames = file.id3v2()->getFrames();
+
+        for(const std::size_t chunk_size : { 1, 3, 10, 97, 4096, 1 << 20 })
+        {
+            const auto tag = parse_stream(data, chunk_size);
+
+            REQUIRE(tag.header);
+            CHECK(tag.header->size == file.id3v2()->getHeader().size);
+            CHECK(tag.rejected == data.size() - file.audio_range().offset);
+
+            REQUIRE(tag.frames.size() == frames.size());
+            for(std::size_t i = 0; i < frames.size(); ++i)
+            {
+                CHECK(std::ranges::equal(tag.frames[i].data, frames[i].data));
+            }
+        }
+    }
+}
+
+TEST_CASE("StreamParserWithUnsynchronizedID3v23Tag")
+{
+    // every chunk boundary lands once between a 0xFF and the 0x00 following it
+    std::vector<std::byte> binary(100, std::byte{ 0xFF });
+    binary[50] = std::byte{ 0x00 };
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_frame({ "PRIV", 0 }, binary);
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    const auto body = unsynchronize(id3v2_builder.build());
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 3 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0x80 }, 1); // unsynchronization
+    builder.write_synch_safe(body.size());
+    builder.write(body);
+    builder.write(std::byte{ 0xAA }, 100);
+    const auto data = builder.build();
+
+    for(const std::size_t chunk_size : { 1, 2, 7, 1000 })
+    {
+        const auto tag = parse_stream(data, chunk_size);
+
+        REQUIRE(tag.frames.size() == 2);
+        CHECK(tag.frames[0].id == "PRIV");
+        CHECK(tag.frames[0].data == binary);
+        CHECK(tag.frames[1].id == "TIT2");
+        CHECK(tag.rejected == 100);
+    }
+}
+
+TEST_CASE("StreamParserSkipsFilteredAndOversizedFrames")
+{
+    const std::vector<std::byte> picture(5000, std::byte{ 0x42 });
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_frame({ "APIC", 0 }, picture);
+    id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Sample artist");
+    id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+    const auto frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(frames.size() + 500);
+    builder.write(frames);
+    builder.write(std::byte{ 0 }, 500); // padding
+    const auto data = builder.build();
+
+    auto options = ID3v2::StreamOptions{ .filter = {}, .max_frame_size = 1000 };
+    auto tag = parse_stream(data, 64, options);
+    REQUIRE(tag.frames.size() == 3);
+    CHECK(tag.frames[1].id == "TPE1");
+    CHECK(tag.skipped_frames == 1);
+    CHECK(tag.rejected == 0);
+
+    options.filter = { Tag::TITLE, Tag::ALBUM };
+    tag = parse_stream(data, 64, options);
+    REQUIRE(tag.frames.size() == 2);
+    CHECK(tag.frames[0].id == "TIT2");
+    CHECK(tag.frames[1].id == "TALB");
+}
+
+TEST_CASE("StreamParserWithoutTag")
+{
+    const std::vector<std::byte> audio(100, std::byte{ 0xFF });
+
+    ID3v2::StreamParser parser{ {}, {} };
+    CHECK(parser.feed(audio) == 0);
+    CHECK(parser.done());
+    CHECK(parser.state() == ID3v2::StreamParser::State::NoTag);
+    CHECK(parser.unconsumed().empty());
+
+    // bytes held while the identifier still matched are handed back
+    const std::vector<std::byte> id{ std::byte{ 'I' }, std::byte{ 'D' } };
+    ID3v2::StreamParser partial{ {}, {} };
+    CHECK(partial.feed(id) == 2);
+    CHECK_FALSE(partial.done());
+    CHECK(partial.feed(audio) == 0);
+    CHECK(partial.consumed() == 0);
+    CHECK(std::ranges::equal(partial.unconsumed(), id));
+}
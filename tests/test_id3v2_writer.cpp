@@ -0,0 +1,210 @@
+#include "test_files.hpp"
+
+#include <audiotag/content_hash.hpp>
+#include <audiotag/file_reader.hpp>
+#include <audiotag/id3v2_writer.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/track_metadata.hpp>
+#include <doctest/doctest.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+std::uint64_t audio_hash(const std::string &path)
+{
+    FileReader reader{ path };
+    MpegFile file{ reader };
+    return hash_range(reader, file.audio_range());
+}
+} // namespace
+
+TEST_CASE("ID3v2WriterRewritesInPlaceWhenFramesFit")
+{
+    const TemporaryDirectory directory;
+    const auto path = directory.copy_test_file("id3v2_only.mp3");
+    const auto size = std::filesystem::file_size(path);
+
+    const std::vector frames{
+        ID3v2::make_text_frame(Tag::TITLE, "New title"),
+        ID3v2::make_text_frame(Tag::ARIST, "New artist"),
+    };
+    const auto result = ID3v2::write_tag(path, frames);
+
+    CHECK(result.mode == ID3v2::WriteMode::InPlace);
+    CHECK(result.bytes_written == 1090);
+    CHECK(std::filesystem::file_size(path) == size);
+    CHECK(audio_hash(path) == 0xB0D04692E54272B7);
+
+    FileReader reader{ path };
+    MpegFile file{ reader };
+    REQUIRE(file.id3v2());
+    CHECK(file.id3v2()->getFrames().size() == 2);
+    CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "New title");
+    CHECK(file.id3v2()->getStringValue(Tag::ARIST) == "New artist");
+    CHECK(file.audio_range().offset == 1090);
+}
+
+TEST_CASE("ID3v2WriterReservesPaddingWhenFramesDoNotFit")
+{
+    const TemporaryDirectory directory;
+    const auto path = directory.copy_test_file("id3v2_only.mp3");
+
+    const std::vector frames{ ID3v2::make_text_frame(Tag::TITLE, std::string(2000, 't')) };
+    const auto rewritten = ID3v2::write_tag(path, frames, { .version = 4, .padding = 1000 });
+
+    CHECK(rewritten.mode == ID3v2::WriteMode::Rewritten);
+    const auto tag_size = ID3v2::serialized_size(frames) + 1000;
+    CHECK(std::filesystem::file_size(path) == tag_size + 13870);
+    CHECK(audio_hash(path) == 0xB0D04692E54272B7);
+
+    // the reserved padding takes the next edit in place
+    const std::vector grown{
+        ID3v2::make_text_frame(Tag::TITLE, std::string(2500, 't')),
+        ID3v2::make_text_frame(Tag::ALBUM, "Album"),
+    };
+    const auto in_place = ID3v2::write_tag(path, grown);
+
+    CHECK(in_place.mode == ID3v2::WriteMode::InPlace);
+    CHECK(std::filesystem::file_size(path) == tag_size + 13870);
+
+    FileReader reader{ path };
+    MpegFile file{ reader };
+    REQUIRE(file.id3v2());
+    CHECK(file.id3v2()->getStringValue(Tag::TITLE) == std::string(2500, 't'));
+    CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "Album");
+    CHECK(hash_range(reader, file.audio_range()) == 0xB0D04692E54272B7);
+}
+
+TEST_CASE("ID3v2WriterAddsTagToUntaggedFile")
+{
+    const TemporaryDirectory directory;
+    const auto path = directory.copy_test_file("no_tags.mp3");
+
+    const std::vector frames{ ID3v2::make_text_frame(Tag::TITLE, "Title") };
+    const auto result = ID3v2::write_tag(path, frames);
+
+    CHECK(result.mode == ID3v2::WriteMode::Rewritten);
+    CHECK(std::filesystem::file_size(path) == ID3v2::serialized_size(frames) + 4096 + 13870);
+
+    FileReader reader{ path };
+    MpegFile file{ reader };
+    REQUIRE(file.id3v2());
+    CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "Title");
+    CHECK(hash_range(reader, file.audio_range()) == 0xB0D04692E54272B7);
+}
+
+TEST_CASE("ID3v2WriterRewriteKeepsModeAndOwner")
+{
+    const TemporaryDirectory directory;
+    const auto path = directory.copy_test_file("no_tags.mp3");
+    REQUIRE(chmod(path.c_str(), 0640) == 0);
+
+    // handing the file to another owner needs privileges, otherwise it keeps ours
+    if(geteuid() == 0)
+    {
+        REQUIRE(chown(path.c_str(), 1234, 1234) == 0);
+    }
+
+    struct stat before = {};
+    REQUIRE(stat(path.c_str(), &before) == 0);
+
+    const std::vector frames{ ID3v2::make_text_frame(Tag::TITLE, "Title") };
+    REQUIRE(ID3v2::write_tag(path, frames).mode == ID3v2::WriteMode::Rewritten);
+
+    struct stat after = {};
+    REQUIRE(stat(path.c_str(), &after) == 0);
+    CHECK(after.st_ino != before.st_ino);
+    CHECK((after.st_mode & 07777) == 0640);
+    CHECK(after.st_uid == before.st_uid);
+    CHECK(after.st_gid == before.st_gid);
+}
+
+TEST_CASE("ID3v2WriterEncodesTextForVersion")
+{
+    const auto v4 = ID3v2::make_text_frame("TIT2", "画家", 4);
+    CHECK(v4.data.size() == 1 + 6);
+    CHECK(v4.data[0] == std::byte{ 3 });
+
+    const auto v3 = ID3v2::make_text_frame("TIT2", "画家", 3);
+    CHECK(v3.data.size() == 1 + 2 + 4);
+    CHECK(v3.data[0] == std::byte{ 1 });
+
+    // a truncated sequence is rejected whichever encoding it would be stored in
+    const std::string_view truncated{ "\xE7\x94" };
+    CHECK_THROWS_AS(ID3v2::make_text_frame("TIT2", truncated, 4), std::invalid_argument);
+    CHECK_THROWS_AS(ID3v2::make_text_frame("TIT2", truncated, 3), std::invalid_argument);
+
+    const TemporaryDirectory directory;
+    const auto path = directory.copy_test_file("id3v2_id3v1.mp3");
+    const std::vector frames{
+        ID3v2::make_text_frame(Tag::TITLE, "画家", 3),
+        ID3v2::make_text_frame(Tag::ALBUM, "アルバム", 3),
+        ID3v2::make_text_frame(Tag::YEAR, "1999", 3),
+    };
+    CHECK(frames[2].id == std::array{ std::byte{ 'T' }, std::byte{ 'Y' }, std::byte{ 'E' },
+                             std::byte{ 'R' } });
+    CHECK(ID3v2::write_tag(path, frames, { .version = 3 }).mode == ID3v2::WriteMode::InPlace);
+
+    FileReader reader{ path };
+    MpegFile file{ reader };
+    REQUIRE(file.id3v2());
+    CHECK(file.id3v2()->getHeader().version_major == 3);
+    CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "画家");
+    CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "アルバム");
+    CHECK(file.id3v2()->getStringValue(Tag::YEAR) == "1999");
+    CHECK(to_track_metadata(file).year == 1999);
+    CHECK(file.id3v1());
+}
+
+TEST_CASE("ID3v2WriterKeepsGroupsAndRejectsUndecodedFrames")
+{
+    const TemporaryDirectory directory;
+    const auto path = directory.copy_test_file("id3v2_only.mp3");
+
+    for(const std::uint8_t version : { 3, 4 })
+    {
+        auto grouped = ID3v2::make_text_frame(Tag::TITLE, "Grouped title", version);
+        grouped.grouping_identity = true;
+        grouped.group_id = 0x42;
+        const std::vector frames{ grouped, ID3v2::make_text_frame(Tag::ALBUM, "Album", version) };
+        ID3v2::write_tag(path, frames, { .version = version });
+
+        FileReader reader{ path };
+        MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "Grouped title");
+        CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "Album");
+
+        const auto tags = file.id3v2()->toTags();
+        CHECK(tags.getFrames()[0].grouping_identity);
+        CHECK(tags.getFrames()[0].group_id == 0x42);
+        CHECK_FALSE(tags.getFrames()[1].grouping_identity);
+    }
+
+    const auto before = read_file(path);
+
+    auto encrypted = ID3v2::make_text_frame(Tag::TITLE, "Title");
+    encrypted.encryption = true;
+    encrypted.data.clear();
+    CHECK_FALSE(ID3v2::writable(encrypted));
+    CHECK_THROWS_AS(ID3v2::write_tag(path, std::vector{ encrypted }), std::invalid_argument);
+
+    auto compressed = ID3v2::make_text_frame(Tag::TITLE, "Title");
+    compressed.compression = true;
+    CHECK(ID3v2::writable(compressed));
+    compressed.data.clear();
+    CHECK_FALSE(ID3v2::writable(compressed));
+    CHECK_THROWS_AS(ID3v2::write_tag(path, std::vector{ compressed }), std::invalid_argument);
+
+    CHECK(read_file(path) == before);
+}
@@ -0,0 +1,135 @@
+#include "test_files.hpp"
+
+#include <audiotag/id3v2_writer.hpp>
+#include <audiotag/library_index.hpp>
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/scanner.hpp>
+#include <audiotag/search_index.hpp>
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+WatchEvent updated(const std::string &path)
+{
+    return WatchEvent{ .kind = WatchEventKind::Updated, .result = scan_file(path) };
+}
+
+WatchEvent removed(const std::string &path)
+{
+    return WatchEvent{
+        .kind = WatchEventKind::Removed,
+        .result = ScanResult{ .path = path, .error = {}, .file = std::nullopt },
+    };
+}
+
+void retitle(const std::string &path, std::string_view title)
+{
+    const std::vector frames{ ID3v2::make_text_frame(Tag::TITLE, title) };
+    ID3v2::write_tag(path, frames);
+}
+
+// Paths of the cache rows the index returns for `query`
+std::vector<std::string> search_paths(
+    const MetadataCache &cache, const SearchIndex &index, std::string_view query)
+{
+    std::vector<std::string> paths;
+    for(const auto row : index.search(query))
+    {
+        paths.emplace_back(cache[row].path());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+} // namespace
+
+TEST_CASE("LibraryIndexAppliesWatchEvents")
+{
+    const TemporaryDirectory directory;
+    const auto album = directory.path() / "album";
+    std::filesystem::create_directories(album);
+
+    const auto first = directory.copy_test_file("id3v2_id3v1.mp3", "album/first.mp3");
+    const auto second = directory.copy_test_file("id3v2_id3v1.mp3", "album/second.mp3");
+    const auto single = directory.copy_test_file("id3v2_only.mp3", "single.mp3");
+    retitle(first, "Morning Song");
+    retitle(second, "Evening Song");
+    retitle(single, "Night Song");
+
+    const auto cache_path = directory.file("library.cache");
+    const auto index_path = directory.file("library.index");
+
+    LibraryIndex library;
+    library.apply(updated(first));
+    library.apply(updated(second));
+    library.apply(updated(single));
+    CHECK(library.size() == 3);
+    library.write(cache_path, index_path);
+
+    {
+        const MetadataCache cache{ cache_path };
+        const SearchIndex index{ index_path };
+        CHECK(cache.size() == 3);
+        CHECK(search_paths(cache, index, "song") == std::vector{ first, second, single });
+        CHECK(search_paths(cache, index, "mor") == std::vector{ first });
+    }
+
+    SUBCASE("Updates replace the entry of their path")
+    {
+        retitle(first, "Afternoon Tune");
+        library.apply(updated(first));
+        CHECK(library.size() == 3);
+        library.write(cache_path, index_path);
+
+        const MetadataCache cache{ cache_path };
+        const SearchIndex index{ index_path };
+        CHECK(cache.size() == 3);
+        CHECK(search_paths(cache, index, "morning").empty());
+        CHECK(search_paths(cache, index, "afternoon") == std::vector{ first });
+        CHECK(search_paths(cache, index, "song") == std::vector{ second, single });
+        CHECK(cache.find(*read_file_key(first))->title() == "Afternoon Tune");
+    }
+
+    SUBCASE("Removing a directory drops the files below it")
+    {
+        library.apply(removed(album.string()));
+        CHECK(library.size() == 1);
+        library.write(cache_path, index_path);
+
+        const MetadataCache cache{ cache_path };
+        const SearchIndex index{ index_path };
+        REQUIRE(cache.size() == 1);
+        CHECK(cache[0].path() == single);
+        CHECK(search_paths(cache, index, "song") == std::vector{ single });
+        CHECK(index.prefix_range("morning").size() == 0);
+    }
+
+    SUBCASE("Files that fail to parse are dropped")
+    {
+        std::filesystem::remove(second);
+        library.apply(updated(second));
+        CHECK(library.size() == 2);
+    }
+
+    SUBCASE("Starts from a written cache")
+    {
+        const MetadataCache cache{ cache_path };
+        LibraryIndex reloaded{ cache };
+        CHECK(reloaded.size() == 3);
+
+        reloaded.apply(removed(single));
+        reloaded.write(cache_path, index_path);
+
+        const MetadataCache rewritten{ cache_path };
+        const SearchIndex index{ index_path };
+        CHECK(rewritten.size() == 2);
+        CHECK(search_paths(rewritten, index, "song") == std::vector{ first, second });
+    }
+}
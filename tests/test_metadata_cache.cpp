@@ -0,0 +1,166 @@
+#include "test_files.hpp"
+
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/scanner.hpp>
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+TrackMetadata metadata_of(int number)
+{
+    return TrackMetadata{
+        .title = "Title " + std::to_string(number),
+        .artist = "Artist",
+        .album = "Album " + std::to_string(number % 7),
+        .genre = "Rock",
+        .track = static_cast<std::uint32_t>(number % 12 + 1),
+        .disc = 1,
+        .year = static_cast<std::uint32_t>(1990 + number % 30),
+        .duration_ms = static_cast<std::uint32_t>(number * 1000),
+    };
+}
+} // namespace
+
+TEST_CASE("MetadataCacheRoundTrip")
+{
+    const TemporaryDirectory directory;
+
+    MetadataCacheWriter writer;
+    for(int i = 999; i >= 0; --i)
+    {
+        const auto key = FileKey{ .device = static_cast<std::uint64_t>(i % 3),
+            .inode = static_cast<std::uint64_t>(i),
+            .size = 1000,
+            .mtime_ns = 42 };
+        writer.add(key, "/music/" + std::to_string(i) + ".mp3", metadata_of(i));
+    }
+
+    // a later record for the same file replaces the earlier one
+    writer.add(FileKey{ .device = 0, .inode = 3, .size = 2000, .mtime_ns = 43 }, "/music/3.mp3",
+        metadata_of(333));
+
+    const auto path = directory.file("round_trip.cache");
+    writer.write(path);
+
+    const MetadataCache cache{ path };
+    CHECK(cache.size() == 1000);
+
+    const auto entry = cache.find(FileKey{ .device = 1, .inode = 4, .size = 1000, .mtime_ns = 42 });
+    REQUIRE(entry);
+    CHECK(entry->path() == "/music/4.mp3");
+    CHECK(entry->title() == "Title 4");
+    CHECK(entry->album() == "Album 4");
+    CHECK(entry->genre() == "Rock");
+    CHECK(entry->track() == 5);
+    CHECK(entry->year() == 1994);
+    CHECK(entry->duration_ms() == 4000);
+
+    const auto replaced =
+        cache.find(FileKey{ .device = 0, .inode = 3, .size = 2000, .mtime_ns = 43 });
+    REQUIRE(replaced);
+    CHECK(replaced->title() == "Title 333");
+
+    // any change of size or mtime misses
+    CHECK_FALSE(cache.find(FileKey{ .device = 0, .inode = 3, .size = 1000, .mtime_ns = 42 }));
+    CHECK_FALSE(cache.find(FileKey{ .device = 1, .inode = 4, .size = 1000, .mtime_ns = 41 }));
+    CHECK_FALSE(cache.find(FileKey{ .device = 2, .inode = 4, .size = 1000, .mtime_ns = 42 }));
+
+    for(std::size_t i = 1; i < cache.size(); ++i)
+    {
+        const auto &previous = cache[i - 1].key();
+        const auto &current = cache[i].key();
+        CHECK((previous.device < current.device ||
+               (previous.device == current.device && previous.inode < current.inode)));
+    }
+}
+
+TEST_CASE("MetadataCacheRejectsOtherFiles")
+{
+    const TemporaryDirectory directory;
+
+    CHECK_THROWS_AS(MetadataCache{ directory.file("missing.cache") }, std::runtime_error);
+    CHECK_THROWS_AS(MetadataCache{ TEST_DATA_DIR "/id3v2_only.mp3" }, std::runtime_error);
+
+    MetadataCacheWriter writer;
+    writer.add(
+        FileKey{ .device = 1, .inode = 1, .size = 1, .mtime_ns = 1 }, "/a.mp3", metadata_of(1));
+    const auto path = directory.file("truncated.cache");
+    writer.write(path);
+
+    std::filesystem::resize_file(path, sizeof(CacheHeader) + sizeof(CacheRecord) / 2);
+    CHECK_THROWS_AS(MetadataCache{ path }, std::runtime_error);
+
+    MetadataCacheWriter empty;
+    empty.write(path);
+    CHECK(MetadataCache{ path }.size() == 0);
+}
+
+TEST_CASE("ScannerOnlyParsesChangedFiles")
+{
+    const TemporaryDirectory directory;
+
+    const auto library = directory.path() / "library";
+    std::filesystem::create_directories(library);
+    for(int i = 0; i < 10; ++i)
+    {
+        std::filesystem::copy_file(
+            TEST_DATA_DIR "/id3v2_only.mp3", library / (std::to_string(i) + ".mp3"));
+    }
+
+    const auto scan = [&](const MetadataCache *cache) {
+        std::mutex mutex;
+        std::vector<ScanResult> results;
+        const std::vector roots{ library.string() };
+        scan_directories(
+            roots,
+            [&](ScanResult &&result) {
+                const std::lock_guard lock{ mutex };
+                results.push_back(std::move(result));
+            },
+            ScanOptions{ .thread_count = 2, .cache = cache });
+        return results;
+    };
+
+    MetadataCacheWriter writer;
+    for(const auto &result : scan(nullptr))
+    {
+        REQUIRE(result.file);
+        CHECK(result.key == read_file_key(result.path));
+        writer.add(result.key, result.path, to_track_metadata(*result.file));
+    }
+
+    const auto path = directory.file("library.cache");
+    writer.write(path);
+    const MetadataCache cache{ path };
+
+    const auto changed = library / "3.mp3";
+    std::filesystem::last_write_time(
+        changed, std::filesystem::last_write_time(changed) + std::chrono::seconds(1));
+
+    std::size_t parsed{ 0 };
+    for(const auto &result : scan(&cache))
+    {
+        if(result.file)
+        {
+            ++parsed;
+            CHECK(result.path == changed.string());
+        }
+        else
+        {
+            REQUIRE(result.cached);
+            CHECK(result.cached->path() == result.path);
+            CHECK(result.cached->title() == "Sample title");
+        }
+    }
+    CHECK(parsed == 1);
+}
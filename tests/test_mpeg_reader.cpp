@@ -7,6 +7,13 @@
 #include <audiotag/mpeg/mpeg_file.hpp>
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <bit>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 using namespace audiotag;
 
 TEST_CASE("MpegFileWithoutTags")
@@ -25,6 +32,118 @@ TEST_CASE("MpegFileWithApeTags")
 
     REQUIRE_FALSE(mpeg.id3v1());
     REQUIRE_FALSE(mpeg.id3v2());
+
+    const auto &tags = mpeg.ape();
+    REQUIRE(tags);
+    CHECK(tags->getVersion() == 2000);
+    CHECK(tags->getItems().size() == 5);
+    CHECK(tags->getStringValue(Tag::TITLE) == "Sample title");
+    CHECK(tags->getStringValue(Tag::ARIST) == "Sample artist");
+    CHECK(tags->getStringValue(Tag::ALBUM) == "Sample album");
+    CHECK(tags->getStringValue(Tag::TRACKNUMBER) == "3");
+    CHECK(tags->getStringValue(Tag::DISCNUMBER) == "");
+
+    const auto *genre = tags->findItem("Genre");
+    REQUIRE(genre);
+    CHECK(genre->key == "GENRE");
+    CHECK(genre->type == APE::ItemType::Text);
+}
+
+TEST_CASE("MpegFileWithApeAndID3v1Tags")
+{
+    FileReader reader{ TEST_DATA_DIR "/id3v1_ape.mp3" };
+    MpegFile mpeg{ reader };
+
+    REQUIRE(mpeg.id3v1());
+    REQUIRE(mpeg.ape());
+    CHECK(mpeg.ape()->getStringValue(Tag::TITLE) == "Sample title");
+
+    // values are views into the tag buffer, copies share it
+    const auto copy = *mpeg.ape();
+    const auto title = mpeg.ape()->getStringValue(Tag::TITLE);
+    CHECK(copy.getStringValue(Tag::TITLE).data() == title.data());
+}
+
+TEST_CASE("MpegFileApeTagsFromTailWindow")
+{
+    auto items = DataBuilder{};
+    items.write(std::uint32_t{ 4 }, std::endian::little); // value size
+    items.write(std::uint32_t{ 0 }, std::endian::little); // flags
+    items.write(std::string_view{ "Title" });
+    items.write(std::byte{ 0 }, 1);
+    items.write(std::string_view{ "Song" });
+    items.write(std::uint32_t{ 3 }, std::endian::little);
+    items.write(std::uint32_t{ 1u << 1 }, std::endian::little); // binary
+    items.write(std::string_view{ "Cover" });
+    items.write(std::byte{ 0 }, 1);
+    items.write(std::string_view{ "\xFF\xD8\xFF" });
+    const auto items_data = items.build();
+
+    auto builder = DataBuilder{};
+    builder.write(std::byte{ 0xAA }, 1024 * 1024);
+    builder.write(items_data);
+    builder.write(APE::Identifier);
+    builder.write(std::uint32_t{ 2000 }, std::endian::little);
+    const auto tag_size = static_cast<std::uint32_t>(items_data.size() + APE::FooterSize);
+    builder.write(tag_size, std::endian::little);
+    builder.write(std::uint32_t{ 2 }, std::endian::little); // item count
+    builder.write(std::uint32_t{ 0 }, std::endian::little); // flags, no header
+    builder.write(std::byte{ 0 }, 8);
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile mpeg{ reader };
+
+    REQUIRE(mpeg.ape());
+    CHECK(mpeg.ape()->getStringValue(Tag::TITLE) == "Song");
+
+    const auto *cover = mpeg.ape()->findItem("cover");
+    REQUIRE(cover);
+    CHECK(cover->type == APE::ItemType::Binary);
+    CHECK(cover->value.size() == 3);
+    CHECK(mpeg.ape()->getStringValue(Tag::ALBUM) == "");
+
+    // head and tail windows only, no separate read for the APE tag
+    CHECK(reader.read_count() == 2);
+}
+
+TEST_CASE("MpegFileApeV1TextIsLatin1")
+{
+    auto items = DataBuilder{};
+    items.write(std::uint32_t{ 4 }, std::endian::little); // value size
+    items.write(std::uint32_t{ 0 }, std::endian::little); // flags
+    items.write(std::string_view{ "Title" });
+    items.write(std::byte{ 0 }, 1);
+    items.write(std::string_view{ "Caf\xE9" });
+    items.write(std::uint32_t{ 5 }, std::endian::little);
+    items.write(std::uint32_t{ 0 }, std::endian::little);
+    items.write(std::string_view{ "Album" });
+    items.write(std::byte{ 0 }, 1);
+    items.write(std::string_view{ "Plain" });
+    const auto items_data = items.build();
+
+    auto builder = DataBuilder{};
+    builder.write(std::byte{ 0xAA }, 4096);
+    builder.write(items_data);
+    builder.write(APE::Identifier);
+    builder.write(std::uint32_t{ 1000 }, std::endian::little);
+    const auto tag_size = static_cast<std::uint32_t>(items_data.size() + APE::FooterSize);
+    builder.write(tag_size, std::endian::little);
+    builder.write(std::uint32_t{ 2 }, std::endian::little); // item count
+    builder.write(std::uint32_t{ 0 }, std::endian::little); // flags, no header
+    builder.write(std::byte{ 0 }, 8);
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile mpeg{ reader };
+
+    REQUIRE(mpeg.ape());
+    CHECK(mpeg.ape()->getVersion() == 1000);
+    CHECK(mpeg.ape()->getStringValue(Tag::TITLE) == "Caf\xC3\xA9");
+    CHECK(mpeg.ape()->getStringValue(Tag::ALBUM) == "Plain");
+
+    const auto copy = *mpeg.ape();
+    CHECK(copy.getStringValue(Tag::TITLE).data() == mpeg.ape()->getStringValue(Tag::TITLE).data());
 }
 
 TEST_CASE("MpegFileWithID3v1Tags")
@@ -178,3 +297,765 @@ TEST_CASE("MpegFileWithID3v11Comment")
     CHECK(tag->track == track);
     CHECK(tag->genre == genre);
 }
+
+TEST_CASE("MpegFileID3v2FramesShareTagBuffer")
+{
+    FileReader reader{ TEST_DATA_DIR "/id3v2_only.mp3" };
+    MpegFile file{ reader };
+
+    const auto &tags = file.id3v2();
+    REQUIRE(tags);
+
+    const auto &frames = tags->getFrames();
+    REQUIRE(frames.size() >= 2);
+
+    // frames are laid out back to back in the tag buffer, 10 byte frame header apart
+    CHECK(frames[1].data.data() == frames[0].data.data() + frames[0].data.size() + 10);
+
+    const auto copy = *tags;
+    CHECK(copy.getFrames()[0].data.data() == frames[0].data.data());
+    CHECK(copy.getStringValue(Tag::TITLE) == "Sample title");
+}
+
+TEST_CASE("MpegFileID3v2ConvertsToOwningTags")
+{
+    FileReader reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+    MpegFile file{ reader };
+
+    REQUIRE(file.id3v2());
+
+    const auto tags = file.id3v2()->toTags();
+    REQUIRE(tags.getFrames().size() == file.id3v2()->getFrames().size());
+    CHECK(tags.getFrames()[0].id == file.id3v2()->getFrames()[0].id);
+    CHECK(tags.getFrames()[0].data.data() != file.id3v2()->getFrames()[0].data.data());
+    CHECK(tags.getStringValue(Tag::TITLE) == "Sample title");
+    CHECK(tags.getStringValue(Tag::ARIST) == "Sample artist in UTF16");
+}
+
+TEST_CASE("MpegFileWithFrameFilterSkipsUnwantedPayloads")
+{
+    const std::vector<std::byte> cover_art(2 * 1024 * 1024, std::byte{ 0x42 });
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_frame({ "APIC", 0 }, cover_art);
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_frame({ "PRIV", 0 }, cover_art);
+    id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Sample artist");
+    id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+    builder.write(std::byte{ 0xAA }, 10'000);
+
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader, ID3v2::FrameFilter{ Tag::TITLE, Tag::ARIST } };
+
+    const auto &tags = file.id3v2();
+    REQUIRE(tags);
+
+    REQUIRE(tags->getFrames().size() == 2);
+    CHECK(tags->getStringValue(Tag::TITLE) == "Sample title");
+    CHECK(tags->getStringValue(Tag::ARIST) == "Sample artist");
+    CHECK(tags->getStringValue(Tag::ALBUM) == "");
+
+    // head and tail windows plus one read per skipped-to frame header
+    CHECK(reader.total_bytes_read() < 16 * 1024);
+}
+
+TEST_CASE("MpegFileWithFrameFilterStopsAtEitherYearFrame")
+{
+    const std::vector<std::byte> cover_art(64 * 1024, std::byte{ 0x42 });
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_text_information_frame({ "TYER", 0 }, "1999");
+    for(int i = 0; i < 8; ++i)
+    {
+        id3v2_builder.add_frame({ "APIC", 0 }, cover_art);
+    }
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+    builder.write(std::byte{ 0xAA }, 10'000);
+
+    const auto data = builder.build();
+
+    // the tag has no TALB, so this parse walks every frame header
+    auto walk_reader = VectorReader{ data };
+    const MpegFile walk_file{ walk_reader, ID3v2::FrameFilter{ Tag::TITLE, Tag::ALBUM } };
+
+    // the tag has no TDRC, finding TYER satisfies YEAR without walking the pictures
+    auto reader = VectorReader{ data };
+    const MpegFile file{ reader, ID3v2::FrameFilter{ Tag::TITLE, Tag::YEAR } };
+
+    REQUIRE(file.id3v2());
+    CHECK(file.id3v2()->getFrames().size() == 2);
+    CHECK(file.id3v2()->getStringValue(Tag::YEAR) == "1999");
+    CHECK(reader.read_count() < walk_reader.read_count());
+}
+
+TEST_CASE("MpegFileWithFrameFilterById")
+{
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_text_information_frame({ "TCOM", 0 }, "Sample composer");
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+
+    const auto data = builder.build();
+
+    auto filter = ID3v2::FrameFilter{};
+    filter.add("TCOM");
+    filter.add("TXXX");
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader, filter };
+
+    REQUIRE(file.id3v2());
+    REQUIRE(file.id3v2()->getFrames().size() == 1);
+    const auto expected_id = std::array{
+        std::byte{ 'T' },
+        std::byte{ 'C' },
+        std::byte{ 'O' },
+        std::byte{ 'M' },
+    };
+    CHECK(file.id3v2()->getFrames()[0].id == expected_id);
+
+    CHECK_THROWS_AS(filter.add("TOOLONG"), std::invalid_argument);
+}
+
+TEST_CASE("MpegFileID3v2BulkStringValues")
+{
+    auto id3v2_builder = ID3v2Builder{};
+    for(int i = 0; i < 300; ++i)
+    {
+        id3v2_builder.add_text_information_frame({ "TXXX", 0 }, "user defined " + std::to_string(i));
+    }
+    id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Second title");
+    id3v2_builder.add_text_information_frame({ "TRCK", 0 }, u"7", Encoding::UTF16, std::endian::little);
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader };
+
+    const auto &tags = file.id3v2();
+    REQUIRE(tags);
+
+    const std::array requested{ Tag::TITLE, Tag::ARIST, Tag::TRACKNUMBER, Tag::ALBUM };
+    const auto values = tags->getStringValues(requested);
+    REQUIRE(values.size() == requested.size());
+    CHECK(values[0] == "Sample title");
+    CHECK(values[1] == "");
+    CHECK(values[2] == "7");
+    CHECK(values[3] == "Sample album");
+
+    std::vector<Tag> visited;
+    tags->visitStringValues(requested, [&visited](Tag tag, std::string_view value) {
+        CHECK_FALSE(value.empty());
+        visited.push_back(tag);
+    });
+    CHECK(visited == std::vector{ Tag::ALBUM, Tag::TITLE, Tag::TRACKNUMBER });
+
+    const auto *frame = tags->findFrame(ID3v2::to_frame_id("TXXX"));
+    REQUIRE(frame != nullptr);
+    CHECK(frame == &tags->getFrames().front());
+    CHECK(tags->findFrame(ID3v2::to_frame_id("APIC")) == nullptr);
+}
+
+TEST_CASE("MpegFileID3v2VisitBorrowsUtf8AndAsciiText")
+{
+    auto album = DataBuilder{};
+    album.write(std::byte{ 3 }, 1); // utf-8 encoding
+    album.write(std::string_view{ "Gr\xC3\xBC\xC3\x9F" });
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Caf\xE9");
+    id3v2_builder.add_frame({ "TALB", 0 }, album.build());
+    id3v2_builder.add_text_information_frame({ "TRCK", 0 }, u"7", Encoding::UTF16, std::endian::big);
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader };
+
+    const auto &tags = file.id3v2();
+    REQUIRE(tags);
+
+    const auto text_of = [&tags](const char *id) {
+        const auto *frame = tags->findFrame(ID3v2::to_frame_id(id));
+        REQUIRE(frame != nullptr);
+        return reinterpret_cast<const char *>(frame->data.data()) + 1;
+    };
+
+    const std::array requested{ Tag::TITLE, Tag::ARIST, Tag::ALBUM, Tag::TRACKNUMBER };
+    std::size_t visited{ 0 };
+    tags->visitStringValues(requested, [&](Tag tag, std::string_view value) {
+        ++visited;
+        switch(tag)
+        {
+        case Tag::TITLE:
+            CHECK(value == "Sample title");
+            CHECK(value.data() == text_of("TIT2"));
+            break;
+        case Tag::ARIST:
+            CHECK(value == "Caf\xC3\xA9");
+            break;
+        case Tag::ALBUM:
+            CHECK(value == "Gr\xC3\xBC\xC3\x9F");
+            CHECK(value.data() == text_of("TALB"));
+            break;
+        case Tag::TRACKNUMBER:
+            CHECK(value == "7");
+            break;
+        default:
+            break;
+        }
+    });
+    CHECK(visited == 4);
+}
+
+TEST_CASE("MpegFileID3v2VisitCopiesInflatedText")
+{
+    // zlib streams of UTF-8 text frames holding "Grüß compressed title" and
+    // "Compressed album été"
+    const std::vector<std::uint8_t> compressed_title{ 0x78, 0xDA, 0x63, 0x76, 0x2F, 0x3A, 0xBC,
+        0xE7, 0xF0, 0x7C, 0x85, 0xE4, 0xFC, 0xDC, 0x82, 0xA2, 0xD4, 0xE2, 0xE2, 0xD4, 0x14, 0x85,
+        0x92, 0xCC, 0x92, 0x9C, 0x54, 0x00, 0x82, 0xB7, 0x0A, 0x35 };
+    const std::vector<std::uint8_t> compressed_album{ 0x78, 0xDA, 0x63, 0x76, 0xCE, 0xCF, 0x2D,
+        0x28, 0x4A, 0x2D, 0x2E, 0x4E, 0x4D, 0x51, 0x48, 0xCC, 0x49, 0x2A, 0xCD, 0x55, 0x38, 0xBC,
+        0xB2, 0xE4, 0xF0, 0x4A, 0x00, 0x66, 0x03, 0x09, 0xB6 };
+
+    const auto compressed_frame = [](const std::vector<std::uint8_t> &stream,
+                                      std::uint32_t decompressed_size) {
+        auto payload = DataBuilder{};
+        payload.write_synch_safe(decompressed_size);
+        payload.write(stream);
+        return payload.build();
+    };
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_frame({ "TIT2", 0x0008 | 0x0001 }, compressed_frame(compressed_title, 24));
+    id3v2_builder.add_frame({ "TALB", 0x0008 | 0x0001 }, compressed_frame(compressed_album, 23));
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+
+    const auto data = builder.build();
+
+    auto reader = VectorReader{ data };
+    MpegFile file{ reader };
+
+    const auto &tags = file.id3v2();
+    REQUIRE(tags);
+
+#ifdef AUDIOTAG_HAS_ZLIB
+    // inflating the album while the title is held must leave the title intact
+    const std::array title{ Tag::TITLE };
+    const std::array album{ Tag::ALBUM };
+    std::size_t visited{ 0 };
+    tags->visitStringValues(title, [&](Tag, std::string_view value) {
+        ++visited;
+        tags->visitStringValues(album, [&](Tag, std::string_view nested) {
+            ++visited;
+            CHECK(nested == "Compressed album \xC3\xA9t\xC3\xA9");
+        });
+        CHECK(tags->getStringValue(Tag::ALBUM) == "Compressed album \xC3\xA9t\xC3\xA9");
+        CHECK(value == "Gr\xC3\xBC\xC3\x9F compressed title");
+    });
+    CHECK(visited == 2);
+#else
+    CHECK(tags->getStringValue(Tag::TITLE) == "");
+#endif
+}
+
+TEST_CASE("MpegFileWithUnsynchronizedID3v23Tag")
+{
+    const std::vector<std::byte> binary{ std::byte{ 0xFF }, std::byte{ 0xE0 }, std::byte{ 0x00 },
+        std::byte{ 0xFF }, std::byte{ 0x00 }, std::byte{ 0xFF } };
+
+    // frames stay below 128 bytes so synch safe and plain frame sizes agree
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_frame({ "PRIV", 0 }, binary);
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_text_information_frame({ "TPE1", 0 }, "Sample artist");
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto extended_header = DataBuilder{};
+    extended_header.write(std::uint32_t{ 6 }, std::endian::big); // size without itself
+    extended_header.write(std::byte{ 0 }, 6); // flags and padding size
+    auto body = extended_header.build();
+    body.insert(body.end(), id3v2_frames.begin(), id3v2_frames.end());
+    const auto unsynchronized_body = unsynchronize(body);
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 3 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0xC0 }, 1); // unsynchronization, extended header
+    builder.write_synch_safe(unsynchronized_body.size());
+    builder.write(unsynchronized_body);
+    builder.write(std::byte{ 0xAA }, 1'000);
+
+    const auto data = builder.build();
+
+    SUBCASE("Full parse")
+    {
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+
+        const auto &tags = file.id3v2();
+        REQUIRE(tags);
+        CHECK(tags->getHeader().unsynchronization);
+        CHECK(tags->getHeader().extended_header);
+
+        REQUIRE(tags->getFrames().size() == 3);
+        CHECK(std::ranges::equal(tags->getFrames()[0].data, binary));
+        CHECK(tags->getStringValue(Tag::TITLE) == "Sample title");
+        CHECK(tags->getStringValue(Tag::ARIST) == "Sample artist");
+    }
+
+    SUBCASE("Filtered parse")
+    {
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader, ID3v2::FrameFilter{ Tag::ARIST } };
+
+        const auto &tags = file.id3v2();
+        REQUIRE(tags);
+        REQUIRE(tags->getFrames().size() == 1);
+        CHECK(tags->getStringValue(Tag::ARIST) == "Sample artist");
+    }
+}
+
+TEST_CASE("MpegFileWithUnsynchronizedID3v24Frames")
+{
+    std::vector<std::byte> binary(300, std::byte{ 0x42 });
+    binary[0] = std::byte{ 0xFF };
+    binary[1] = std::byte{ 0x00 };
+    binary[150] = std::byte{ 0xFF };
+    binary[151] = std::byte{ 0xFB };
+    binary.back() = std::byte{ 0xFF };
+
+    constexpr std::uint16_t unsynchronization_flag{ 0x0002 };
+
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Sample title");
+    id3v2_builder.add_frame({ "PRIV", unsynchronization_flag }, unsynchronize(binary));
+    id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+    builder.write(std::byte{ 0xAA }, 1'000);
+
+    const auto data = builder.build();
+
+    auto selective_filter = ID3v2::FrameFilter{ Tag::ALBUM };
+    selective_filter.add("PRIV");
+
+    for(const auto &filter : { ID3v2::FrameFilter{}, selective_filter })
+    {
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader, filter };
+
+        const auto &tags = file.id3v2();
+        REQUIRE(tags);
+
+        const auto *priv = tags->findFrame(ID3v2::to_frame_id("PRIV"));
+        REQUIRE(priv);
+        CHECK(std::ranges::equal(priv->data, binary));
+        CHECK(tags->getStringValue(Tag::ALBUM) == "Sample album");
+    }
+}
+
+TEST_CASE("ID3v2FrameFlagsDependOnVersion")
+{
+    const auto v23 = ID3v2::decode_frame_flags(3, 0x8000 | 0x0080 | 0x0020);
+    CHECK(v23.tag_preservation);
+    CHECK(v23.compression);
+    CHECK(v23.grouping_identity);
+    CHECK_FALSE(v23.encryption);
+
+    const auto v24 = ID3v2::decode_frame_flags(4, 0x4000 | 0x0008 | 0x0004 | 0x0001);
+    CHECK(v24.tag_preservation);
+    CHECK(v24.compression);
+    CHECK(v24.encryption);
+    CHECK(v24.data_length_indicator);
+    CHECK_FALSE(v24.grouping_identity);
+    CHECK_FALSE(v24.unsynchronization);
+}
+
+TEST_CASE("MpegFileWithCompressedID3v2Frames")
+{
+    // zlib stream of a Latin-1 text frame holding "Compressed title " eight times
+    const std::vector<std::uint8_t> compressed{ 0x78, 0x9C, 0x63, 0x70, 0xCE, 0xCF, 0x2D, 0x28,
+        0x4A, 0x2D, 0x2E, 0x4E, 0x4D, 0x51, 0x28, 0xC9, 0x2C, 0xC9, 0x49, 0x55, 0x18, 0x20, 0x01,
+        0x00, 0xE7, 0xE8, 0x33, 0xB9 };
+    constexpr std::uint32_t decompressed_size{ 137 };
+
+    std::string expected_title;
+    for(int i = 0; i < 8; ++i)
+    {
+        expected_title += "Compressed title ";
+    }
+
+    // the same text forty times, which inflates to more than the smallest scratch buffer
+    const std::vector<std::uint8_t> long_compressed{ 0x78, 0xDA, 0x63, 0x70, 0xCE, 0xCF, 0x2D, 0x28,
+        0x4A, 0x2D, 0x2E, 0x4E, 0x4D, 0x51, 0x28, 0xC9, 0x2C, 0xC9, 0x49, 0x55, 0x18, 0x15, 0x18,
+        0x15, 0x18, 0x84, 0x02, 0x00, 0x59, 0x5D, 0x02, 0xA8 };
+
+    std::string long_title;
+    for(int i = 0; i < 40; ++i)
+    {
+        long_title += "Compressed title ";
+    }
+
+    const auto build_file = [&](std::uint8_t version, std::uint16_t flags, auto write_prefix,
+                                const std::vector<std::uint8_t> &stream) {
+        auto payload = DataBuilder{};
+        write_prefix(payload);
+        payload.write(stream);
+        const auto payload_data = payload.build();
+
+        auto id3v2_builder = ID3v2Builder{};
+        id3v2_builder.add_frame({ "TIT2", flags }, payload_data);
+        id3v2_builder.add_text_information_frame({ "TALB", 0 }, "Sample album");
+        const auto id3v2_frames = id3v2_builder.build();
+
+        auto builder = DataBuilder{};
+        builder.write(ID3v2::Identifier);
+        builder.write(std::byte{ version }, 1); // version major
+        builder.write(std::byte{ 0 }, 1); // version minor
+        builder.write(std::byte{ 0 }, 1); // flags
+        builder.write_synch_safe(id3v2_frames.size());
+        builder.write(id3v2_frames);
+        builder.write(std::byte{ 0xAA }, 1'000);
+        return builder.build();
+    };
+
+    SUBCASE("v2.3 with decompressed size")
+    {
+        const auto data = build_file(3, 0x0080, [&](DataBuilder &prefix) {
+            prefix.write(decompressed_size, std::endian::big);
+        }, compressed);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+
+        const auto *frame = file.id3v2()->findFrame(ID3v2::to_frame_id("TIT2"));
+        REQUIRE(frame);
+        CHECK(frame->data.size() == compressed.size());
+        CHECK(frame->data_length == decompressed_size);
+
+#ifdef AUDIOTAG_HAS_ZLIB
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == expected_title);
+        CHECK(file.id3v2()->getFrameData(*frame).size() == decompressed_size);
+
+        const auto tags = file.id3v2()->toTags();
+        CHECK(tags.getFrames()[0].compression);
+        CHECK(tags.getStringValue(Tag::TITLE) == expected_title);
+#else
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "");
+#endif
+        CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "Sample album");
+    }
+
+    SUBCASE("v2.4 with group and data length indicator")
+    {
+        const auto data = build_file(4, 0x0040 | 0x0008 | 0x0001, [&](DataBuilder &prefix) {
+            prefix.write(std::byte{ 0x01 }, 1); // group id
+            prefix.write_synch_safe(decompressed_size);
+        }, compressed);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader, ID3v2::FrameFilter{ Tag::TITLE } };
+        REQUIRE(file.id3v2());
+
+        const auto *frame = file.id3v2()->findFrame(ID3v2::to_frame_id("TIT2"));
+        REQUIRE(frame);
+        CHECK(frame->data.size() == compressed.size());
+        CHECK(frame->data_length == decompressed_size);
+
+#ifdef AUDIOTAG_HAS_ZLIB
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == expected_title);
+#else
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "");
+#endif
+    }
+
+    SUBCASE("v2.4 without data length indicator")
+    {
+        const auto data = build_file(4, 0x0008, [](DataBuilder &) {}, long_compressed);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+
+        const auto *frame = file.id3v2()->findFrame(ID3v2::to_frame_id("TIT2"));
+        REQUIRE(frame);
+        CHECK(frame->data_length == 0);
+
+#ifdef AUDIOTAG_HAS_ZLIB
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == long_title);
+#else
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "");
+#endif
+    }
+
+    SUBCASE("v2.3 claiming a huge decompressed size")
+    {
+        const auto data = build_file(3, 0x0080, [](DataBuilder &prefix) {
+            prefix.write(std::uint32_t{ 0xFFFF'FFFF }, std::endian::big);
+        }, long_compressed);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+
+#ifdef AUDIOTAG_HAS_ZLIB
+        // the claimed size only hints the buffer, the output decides how far it grows
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == long_title);
+        CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "Sample album");
+#else
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "");
+#endif
+    }
+
+    SUBCASE("Frames inflating past their declared size have no value")
+    {
+        // zlib stream of a Latin-1 text frame holding 65536 'A's
+        std::vector<std::uint8_t> bomb{ 0x78, 0xDA, 0xED, 0xC1, 0x01, 0x01, 0x00, 0x00, 0x00,
+            0x01, 0x20, 0xD7, 0xFC, 0x3F, 0xC5, 0x90, 0x2A, 0x05 };
+        bomb.insert(bomb.end(), 62, 0x00);
+        bomb.insert(bomb.end(), { 0x80, 0x1B, 0x1E, 0x88, 0x03, 0xD0 });
+
+        const auto declared = build_file(4, 0x0008 | 0x0001, [](DataBuilder &prefix) {
+            prefix.write_synch_safe(16);
+        }, bomb);
+
+        auto reader = VectorReader{ declared };
+        MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+
+        const auto *frame = file.id3v2()->findFrame(ID3v2::to_frame_id("TIT2"));
+        REQUIRE(frame);
+        CHECK(file.id3v2()->getFrameData(*frame).empty());
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "");
+        CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "Sample album");
+
+#ifdef AUDIOTAG_HAS_ZLIB
+        // without a declared size only the tag size limit applies
+        const auto undeclared = build_file(4, 0x0008, [](DataBuilder &) {}, bomb);
+
+        auto undeclared_reader = VectorReader{ undeclared };
+        MpegFile undeclared_file{ undeclared_reader };
+        REQUIRE(undeclared_file.id3v2());
+        CHECK(undeclared_file.id3v2()->getStringValue(Tag::TITLE) == std::string(65'536, 'A'));
+#endif
+    }
+
+    SUBCASE("Encrypted frames have no value")
+    {
+        const auto data = build_file(4, 0x0004, [&](DataBuilder &prefix) {
+            prefix.write(std::byte{ 0x80 }, 1); // encryption method
+        }, compressed);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+        REQUIRE(file.id3v2());
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "");
+        CHECK(file.id3v2()->getStringValue(Tag::ALBUM) == "Sample album");
+    }
+}
+
+namespace
+{
+// v2.4 tag with the given frames, closed by a footer when `with_footer` is set
+std::vector<std::byte> build_id3v24_tag(std::span<const std::byte> frames, bool with_footer)
+{
+    const auto flags = with_footer ? ID3v2::HeaderFlags::Footer : std::uint8_t{ 0 };
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ flags }, 1);
+    builder.write_synch_safe(frames.size());
+    builder.write(frames);
+
+    if(with_footer)
+    {
+        builder.write(ID3v2::FooterIdentifier);
+        builder.write(std::byte{ 4 }, 1); // version major
+        builder.write(std::byte{ 0 }, 1); // version minor
+        builder.write(std::byte{ flags }, 1);
+        builder.write_synch_safe(frames.size());
+    }
+
+    return builder.build();
+}
+} // namespace
+
+TEST_CASE("MpegFileWithAppendedID3v2Tag")
+{
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, "Appended title");
+    const auto appended_tag = build_id3v24_tag(id3v2_builder.build(), true);
+
+    const auto id3v1_tag = ID3v1Builder::build(ID3v1::Tags{
+        .title = "Sample title",
+        .artist = "",
+        .album = "",
+        .year = "",
+        .comment = "",
+        .track = 0,
+        .genre = 0,
+    });
+
+    for(const auto with_id3v1 : { false, true })
+    {
+        auto builder = DataBuilder{};
+        builder.write(std::byte{ 0xAA }, 4 * 1024 * 1024);
+        builder.write(appended_tag);
+        if(with_id3v1)
+        {
+            builder.write(id3v1_tag);
+        }
+        const auto data = builder.build();
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+
+        CHECK_FALSE(file.id3v2());
+        CHECK(file.id3v1().has_value() == with_id3v1);
+        REQUIRE(file.id3v2_appended());
+        CHECK(file.id3v2_appended()->getHeader().footer);
+        CHECK(file.id3v2_appended()->getStringValue(Tag::TITLE) == "Appended title");
+
+        // found from the tail window, the audio is never read
+        CHECK(reader.total_bytes_read() < 16 * 1024);
+    }
+}
+
+TEST_CASE("MpegFileFollowsID3v2SeekFrame")
+{
+    auto second_builder = ID3v2Builder{};
+    second_builder.add_text_information_frame({ "TALB", 0 }, "Album after seek");
+    const auto second_tag = build_id3v24_tag(second_builder.build(), false);
+
+    constexpr std::uint32_t audio_before_second_tag{ 64 * 1024 };
+
+    auto seek_offset = DataBuilder{};
+    seek_offset.write(audio_before_second_tag, std::endian::big);
+    // SEEK ahead of the title, where a parse filtered for TITLE passes it
+    auto leading_builder = ID3v2Builder{};
+    leading_builder.add_frame({ "SEEK", 0 }, seek_offset.build());
+    leading_builder.add_text_information_frame({ "TIT2", 0 }, "Leading title");
+    const auto leading_tag = build_id3v24_tag(leading_builder.build(), false);
+
+    const auto build_file = [&](std::size_t audio_after_second_tag) {
+        auto builder = DataBuilder{};
+        builder.write(leading_tag);
+        builder.write(std::byte{ 0xAA }, audio_before_second_tag);
+        builder.write(second_tag);
+        builder.write(std::byte{ 0xAA }, audio_after_second_tag);
+        return builder.build();
+    };
+
+    SUBCASE("Tag between audio frames")
+    {
+        const auto data = build_file(64 * 1024);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader };
+
+        REQUIRE(file.id3v2());
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "Leading title");
+        REQUIRE(file.id3v2_appended());
+        CHECK(file.id3v2_appended()->getStringValue(Tag::ALBUM) == "Album after seek");
+
+        // the audio following the tag keeps it inside the range
+        CHECK(file.audio_range().offset == leading_tag.size());
+        CHECK(file.audio_range().length == data.size() - leading_tag.size());
+    }
+
+    SUBCASE("Filtered parse")
+    {
+        const auto data = build_file(64 * 1024);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader, ID3v2::FrameFilter{ Tag::TITLE, Tag::ALBUM } };
+
+        REQUIRE(file.id3v2());
+        CHECK(file.id3v2()->getStringValue(Tag::TITLE) == "Leading title");
+        REQUIRE(file.id3v2_appended());
+        CHECK(file.id3v2_appended()->getStringValue(Tag::ALBUM) == "Album after seek");
+    }
+
+    SUBCASE("Tag ending the audio")
+    {
+        const auto data = build_file(0);
+
+        auto reader = VectorReader{ data };
+        MpegFile file{ reader, ID3v2::FrameFilter{ Tag::TITLE } };
+
+        REQUIRE(file.id3v2_appended());
+        CHECK(file.id3v2_appended()->getStringValue(Tag::ALBUM) == "");
+        CHECK(file.audio_range().offset == leading_tag.size());
+        CHECK(file.audio_range().length == audio_before_second_tag);
+    }
+}
@@ -0,0 +1,148 @@
+#include "data_builder.hpp"
+#include "id3v1_builder.hpp"
+#include "id3v2_builder.hpp"
+#include "vector_reader.hpp"
+
+#include <audiotag/mmap_reader.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/read_planner.hpp>
+#include <doctest/doctest.h>
+
+using namespace audiotag;
+
+namespace
+{
+std::vector<std::byte> build_file(std::size_t text_size, std::size_t audio_size)
+{
+    auto id3v2_builder = ID3v2Builder{};
+    id3v2_builder.add_text_information_frame({ "TIT2", 0 }, std::string(text_size, 't'));
+    const auto id3v2_frames = id3v2_builder.build();
+
+    auto builder = DataBuilder{};
+    builder.write(ID3v2::Identifier);
+    builder.write(std::byte{ 4 }, 1); // version major
+    builder.write(std::byte{ 0 }, 1); // version minor
+    builder.write(std::byte{ 0 }, 1); // flags
+    builder.write_synch_safe(id3v2_frames.size());
+    builder.write(id3v2_frames);
+    builder.write(std::byte{ 0xAA }, audio_size);
+    builder.write(ID3v1Builder::build({
+        .title = "Tail title",
+        .artist = "",
+        .album = "",
+        .year = "",
+        .comment = "",
+        .track = 1,
+        .genre = 0,
+    }));
+    return builder.build();
+}
+
+// Serves at most `limit` bytes per positional read, as a file truncated
+// between length() and the read would
+class ShortReader : public VectorReader
+{
+public:
+    ShortReader(const DataVec &data, std::size_t limit)
+    : VectorReader{ data }
+    , limit{ limit }
+    {
+    }
+
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override
+    {
+        return VectorReader::read_at(offset, buffer.first(std::min(buffer.size(), limit)));
+    }
+
+private:
+    std::size_t limit;
+};
+} // namespace
+
+TEST_CASE("ReadPlannerSmallFileIsReadOnce")
+{
+    const auto data = build_file(100, 1000);
+    const auto reader = VectorReader{ data };
+
+    ReadPlanner planner{ reader };
+    CHECK(planner.read_count() == 1);
+
+    const auto head = planner.read(0, 3);
+    const auto tail = planner.read(planner.length() - 128, 128);
+    REQUIRE(head.size() == 3);
+    REQUIRE(tail.size() == 128);
+    CHECK(head[0] == std::byte{ 'I' });
+    CHECK(tail[0] == std::byte{ 'T' });
+    CHECK(planner.read_count() == 1);
+}
+
+TEST_CASE("ReadPlannerServesHeadAndTailFromWindows")
+{
+    const auto data = build_file(100, 100'000);
+    auto reader = VectorReader{ data };
+
+    ReadPlanner planner{ reader };
+    CHECK(planner.read_count() == 2);
+
+    CHECK(planner.read(10, 100).size() == 100);
+    CHECK(planner.read(planner.length() - 128, 128).size() == 128);
+    CHECK(planner.read_count() == 2);
+
+    MpegFile file{ reader };
+    REQUIRE(file.id3v1());
+    REQUIRE(file.id3v2());
+    CHECK(file.id3v1()->title == "Tail title");
+    CHECK(file.id3v2()->getStringValue(Tag::TITLE) == std::string(100, 't'));
+}
+
+TEST_CASE("ReadPlannerFollowUpReadOnlyPastWindow")
+{
+    const auto data = build_file(5000, 100'000);
+    const auto reader = VectorReader{ data };
+
+    ReadPlanner planner{ reader };
+    const auto window = planner.window_size();
+
+    const auto span = planner.read(10, window + 100);
+    REQUIRE(span.size() == window + 100);
+    CHECK(std::equal(span.begin(), span.end(), data.begin() + 10));
+    CHECK(planner.read_count() == 3);
+
+    // range fully inside the follow-up window needs no further read
+    CHECK(planner.read(window, 50).size() == 50);
+    CHECK(planner.read_count() == 3);
+
+    CHECK(planner.read(planner.length() - 10, 100).size() == 10);
+    CHECK(planner.read(planner.length(), 1).empty());
+}
+
+TEST_CASE("ReadPlannerClampsShortReads")
+{
+    const auto data = build_file(5000, 100'000);
+    const auto reader = ShortReader{ data, 1000 };
+
+    ReadPlanner planner{ reader };
+    const auto window = planner.window_size();
+    REQUIRE(window > 1000);
+
+    // the head window itself came back short
+    const auto span = planner.read(990, 500);
+    REQUIRE(span.size() == 500);
+    CHECK(std::equal(span.begin(), span.end(), data.begin() + 990));
+
+    const auto short_span = planner.read(20'000, 2 * window);
+    REQUIRE(short_span.size() == 1000);
+    CHECK(std::equal(short_span.begin(), short_span.end(), data.begin() + 20'000));
+
+    std::vector<std::byte> buffer(2000);
+    CHECK(planner.read_into(30'000, buffer) == 1000);
+}
+
+TEST_CASE("ReadPlannerBorrowsFromMmapReader")
+{
+    MmapReader reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+
+    ReadPlanner planner{ reader };
+    CHECK(planner.read_count() == 0);
+    CHECK(planner.read(0, 10).data() == reader.view(0, 10).data());
+}
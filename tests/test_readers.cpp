@@ -0,0 +1,196 @@
+#include "test_files.hpp"
+
+#include <audiotag/content_hash.hpp>
+#include <audiotag/file_reader.hpp>
+#include <audiotag/mmap_reader.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/seeking_reader_adapter.hpp>
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+// Stream that can only seek and read, as readers written before read_at existed
+class SeekingStream
+{
+public:
+    explicit SeekingStream(std::vector<std::byte> data)
+    : data{ std::move(data) }
+    {
+    }
+
+    std::size_t length() const
+    {
+        return data.size();
+    }
+
+    std::size_t buffer_size() const
+    {
+        return 1024;
+    }
+
+    // Hands out at most 7 bytes per call, like a short-reading stream
+    std::size_t read(std::span<std::byte> buffer)
+    {
+        const auto count = std::min({ buffer.size(), data.size() - cursor, std::size_t{ 7 } });
+        std::copy_n(data.begin() + static_cast<long>(cursor), count, buffer.begin());
+        cursor += count;
+        return count;
+    }
+
+    bool seek(long offset)
+    {
+        if(offset < 0 || static_cast<std::size_t>(offset) > data.size())
+        {
+            return false;
+        }
+        cursor = offset;
+        return true;
+    }
+
+private:
+    std::vector<std::byte> data;
+    std::size_t cursor{ 0 };
+};
+} // namespace
+
+TEST_CASE("MmapReaderMatchesFileReader")
+{
+    FileReader file_reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+    MmapReader mmap_reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+
+    REQUIRE(mmap_reader.length() == file_reader.length());
+
+    std::vector<std::byte> expected(file_reader.length());
+    REQUIRE(file_reader.read(expected) == expected.size());
+
+    std::vector<std::byte> actual(mmap_reader.length());
+    REQUIRE(mmap_reader.read(actual) == actual.size());
+    CHECK(actual == expected);
+
+    const auto view = mmap_reader.view(0, mmap_reader.length());
+    REQUIRE(view.size() == expected.size());
+    CHECK(std::equal(view.begin(), view.end(), expected.begin()));
+}
+
+TEST_CASE("MmapReaderViewIsClampedToFileSize")
+{
+    MmapReader reader{ TEST_DATA_DIR "/no_tags.mp3" };
+
+    CHECK(reader.view(reader.length() - 4, 100).size() == 4);
+    CHECK(reader.view(reader.length(), 1).empty());
+
+    REQUIRE(reader.seek(reader.length() - 2));
+    std::byte buffer[8]{};
+    CHECK(reader.read(buffer) == 2);
+    CHECK_FALSE(reader.seek(reader.length() + 1));
+}
+
+TEST_CASE("MpegFileFromMmapReader")
+{
+    MmapReader reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+    MpegFile mpeg{ reader };
+
+    REQUIRE(mpeg.id3v1());
+
+    const auto id3v2 = mpeg.id3v2();
+    REQUIRE(id3v2);
+
+    CHECK(id3v2->getStringValue(Tag::TITLE) == "Sample title");
+    CHECK(id3v2->getStringValue(Tag::ARIST) == "Sample artist in UTF16");
+}
+
+TEST_CASE("FileReaderReadAtLeavesCursorUntouched")
+{
+    FileReader reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+
+    std::byte tail[3]{};
+    REQUIRE(reader.read_at(reader.length() - 128, tail) == 3);
+    CHECK(tail[0] == std::byte{ 'T' });
+
+    std::byte head[3]{};
+    REQUIRE(reader.read(head) == 3);
+    CHECK(head[0] == std::byte{ 'I' });
+
+    CHECK(reader.read_at(reader.length(), tail) == 0);
+}
+
+TEST_CASE("FileReaderSharedBetweenThreads")
+{
+    const FileReader reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+
+    std::vector<std::byte> expected(reader.length());
+    REQUIRE(reader.read_at(0, expected) == expected.size());
+
+    constexpr std::size_t thread_count{ 4 };
+    std::vector<std::vector<std::byte>> results(thread_count);
+    std::vector<std::thread> threads;
+
+    for(std::size_t i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&reader, &result = results[i]] {
+            result.resize(reader.length());
+
+            // read in small interleaved chunks to exercise concurrent positional reads
+            for(std::size_t offset = 0; offset < result.size(); offset += 100)
+            {
+                const auto chunk_size = std::min<std::size_t>(100, result.size() - offset);
+                const auto chunk = std::span(result).subspan(offset, chunk_size);
+                static_cast<void>(reader.read_at(offset, chunk));
+            }
+        });
+    }
+
+    for(auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    for(const auto &result : results)
+    {
+        CHECK(result == expected);
+    }
+}
+
+TEST_CASE("SeekingReaderAdapterGoesThroughSeekAndRead")
+{
+    const FileReader file_reader{ TEST_DATA_DIR "/id3v2_id3v1.mp3" };
+    std::vector<std::byte> data(file_reader.length());
+    REQUIRE(file_reader.read_at(0, data) == data.size());
+
+    SeekingStream stream{ data };
+    SeekingReaderAdapter reader{ stream };
+
+    std::byte tail[3]{};
+    REQUIRE(reader.read_at(reader.length() - 128, tail) == 3);
+    CHECK(tail[0] == std::byte{ 'T' });
+    CHECK(reader.read_at(reader.length() + 1, tail) == 0);
+
+    // positional reads leave the cursor of the adapter alone
+    REQUIRE(reader.read(tail) == 3);
+    CHECK(tail[0] == std::byte{ 'I' });
+
+    MpegFile mpeg{ reader };
+    REQUIRE(mpeg.id3v2());
+    CHECK(mpeg.id3v2()->getStringValue(Tag::TITLE) == "Sample title");
+    REQUIRE(mpeg.id3v1());
+}
+
+TEST_CASE("SeekingReaderAdapterIsSafeToCallConcurrently")
+{
+    std::mt19937 generator{ 7 };
+    SeekingStream stream{ random_bytes(generator, 2 * HashChunkSize + 1'000) };
+    const SeekingReaderAdapter reader{ stream };
+    const ReadPlanner::Range range{ 10, reader.length() - 10 };
+
+    // chunks are hashed through read_at from several threads at once
+    const auto expected = hash_range(reader, range, { .thread_count = 1 });
+    CHECK(hash_range(reader, range, { .thread_count = 4, .read_size = 64 * 1024 }) == expected);
+}
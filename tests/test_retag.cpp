@@ -0,0 +1,284 @@
+#include "data_builder.hpp"
+#include "test_files.hpp"
+
+#include <audiotag/content_hash.hpp>
+#include <audiotag/file_reader.hpp>
+#include <audiotag/mpeg/mpeg_file.hpp>
+#include <audiotag/retag.hpp>
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+std::string artist_of(const std::string &path)
+{
+    FileReader reader{ path };
+    MpegFile file{ reader };
+    return file.id3v2() ? file.id3v2()->getStringValue(Tag::ARIST) : "";
+}
+
+void write_record(DataBuilder &journal, const std::vector<std::byte> &payload)
+{
+    const auto checksum = Xxh64::hash(payload);
+    journal.write(static_cast<std::uint32_t>(payload.size()), std::endian::little);
+    journal.write(static_cast<std::uint32_t>(checksum), std::endian::little);
+    journal.write(static_cast<std::uint32_t>(checksum >> 32), std::endian::little);
+    journal.write(payload);
+}
+
+// Journal of a batch that stopped after syncing the begin record of one edit
+std::string write_journal(const std::string &path,
+    std::span<const std::byte> before,
+    std::span<const std::byte> after,
+    const std::string &temporary = {})
+{
+    auto payload = DataBuilder{};
+    payload.write(std::byte{ 1 }, 1); // begin
+    payload.write(std::uint32_t{ 0 }, std::endian::little);
+    payload.write(static_cast<std::uint32_t>(path.size()), std::endian::little);
+    payload.write(path);
+    payload.write(static_cast<std::uint32_t>(before.size()), std::endian::little);
+    payload.write(before);
+    payload.write(static_cast<std::uint32_t>(after.size()), std::endian::little);
+    payload.write(after);
+    payload.write(static_cast<std::uint32_t>(temporary.size()), std::endian::little);
+    payload.write(temporary);
+
+    auto journal = DataBuilder{};
+    journal.write(std::string_view{ "ATJ1" });
+    write_record(journal, payload.build());
+    journal.write(std::uint32_t{ 5 }, std::endian::little); // torn commit record
+    journal.write(std::byte{ 0 }, 3);
+    const auto data = journal.build();
+
+    const auto journal_path =
+        (std::filesystem::path(path).parent_path() / "recover.journal").string();
+    write_file(journal_path, data);
+    return journal_path;
+}
+
+bool rename_artist(std::size_t, std::uint8_t version, std::vector<ID3v2::TagFrame> &frames)
+{
+    std::erase_if(frames, [](const auto &frame) {
+        return ID3v2::to_frame_id(frame.id) == ID3v2::to_frame_id(Tag::ARIST);
+    });
+    frames.push_back(ID3v2::make_text_frame(Tag::ARIST, "Renamed artist", version));
+    return true;
+}
+} // namespace
+
+TEST_CASE("RetagAppliesEditsAndRemovesJournal")
+{
+    const TemporaryDirectory directory;
+
+    std::vector<std::string> paths;
+    for(int i = 0; i < 20; ++i)
+    {
+        paths.push_back(
+            directory.copy_test_file("id3v2_only.mp3", "tagged_" + std::to_string(i) + ".mp3"));
+    }
+    paths.push_back(directory.copy_test_file("no_tags.mp3", "untagged.mp3"));
+    paths.push_back(directory.file("does_not_exist.mp3"));
+
+    const auto journal_path = directory.file("batch.journal");
+
+    const auto options = RetagOptions{
+        .journal_path = journal_path, .threads_per_device = 3, .group_size = 4 };
+    const auto results = retag_files(paths, rename_artist, options);
+
+    REQUIRE(results.size() == paths.size());
+    for(std::size_t i = 0; i < 20; ++i)
+    {
+        CHECK_FALSE(results[i].error);
+        CHECK(results[i].changed);
+        CHECK(results[i].mode == ID3v2::WriteMode::InPlace);
+        CHECK(artist_of(paths[i]) == "Renamed artist");
+        CHECK(std::filesystem::file_size(paths[i]) == 1090 + 13870);
+    }
+
+    CHECK(results[20].changed);
+    CHECK(results[20].mode == ID3v2::WriteMode::Rewritten);
+    CHECK(artist_of(paths[20]) == "Renamed artist");
+
+    CHECK(results[21].error == std::errc::no_such_file_or_directory);
+    CHECK_FALSE(std::filesystem::exists(journal_path));
+    for(const auto &entry : std::filesystem::directory_iterator(directory.path()))
+    {
+        CHECK(entry.path().filename().string().find(".audiotag-") == std::string::npos);
+    }
+
+    // the edit already holds, nothing is written the second time
+    const auto again = retag_files(paths, rename_artist, options);
+    for(std::size_t i = 0; i < 21; ++i)
+    {
+        CHECK_FALSE(again[i].changed);
+    }
+}
+
+TEST_CASE("RetagStopsOnEditFailureAndKeepsJournal")
+{
+    const TemporaryDirectory directory;
+
+    const std::vector paths{
+        directory.copy_test_file("id3v2_only.mp3", "failing_0.mp3"),
+        directory.copy_test_file("id3v2_only.mp3", "failing_1.mp3"),
+    };
+
+    const auto journal_path = directory.file("failing.journal");
+
+    const auto edit = [](std::size_t index, std::uint8_t version, auto &frames) {
+        if(index == 1)
+        {
+            throw std::runtime_error("edit failed");
+        }
+        return rename_artist(index, version, frames);
+    };
+
+    const auto options =
+        RetagOptions{ .journal_path = journal_path, .threads_per_device = 1, .group_size = 1 };
+    CHECK_THROWS_AS(retag_files(paths, edit, options), std::runtime_error);
+    CHECK(artist_of(paths[0]) == "Renamed artist");
+    CHECK(std::filesystem::exists(journal_path));
+
+    // a journal left behind has to be recovered before the next batch
+    CHECK_THROWS_AS(retag_files(paths, rename_artist, options), std::system_error);
+
+    const auto report = recover_journal(journal_path, RecoveryMode::RollBack);
+    CHECK(report.replayed == 0);
+    CHECK(report.conflicts.empty());
+    CHECK_FALSE(std::filesystem::exists(journal_path));
+}
+
+TEST_CASE("RetagJournalsAbsolutePaths")
+{
+    const TemporaryDirectory directory;
+    directory.copy_test_file("id3v2_only.mp3", "relative_0.mp3");
+    directory.copy_test_file("id3v2_only.mp3", "relative_1.mp3");
+    const auto journal_path = directory.file("relative.journal");
+
+    const auto working_directory = std::filesystem::current_path();
+    std::filesystem::current_path(directory.path());
+
+    const std::vector<std::string> paths{ "relative_0.mp3", "relative_1.mp3" };
+    const auto edit = [](std::size_t index, std::uint8_t version, auto &frames) {
+        if(index == 1)
+        {
+            throw std::runtime_error("edit failed");
+        }
+        return rename_artist(index, version, frames);
+    };
+
+    const auto options =
+        RetagOptions{ .journal_path = journal_path, .threads_per_device = 1, .group_size = 1 };
+    CHECK_THROWS_AS(retag_files(paths, edit, options), std::runtime_error);
+    std::filesystem::current_path(working_directory);
+
+    // the journal left behind names the file so that it is found from anywhere
+    const auto journal = read_file(journal_path);
+    const auto journal_text =
+        std::string_view(reinterpret_cast<const char *>(journal.data()), journal.size());
+    CHECK(journal_text.find(directory.file("relative_0.mp3")) != std::string_view::npos);
+    CHECK(artist_of(directory.file("relative_0.mp3")) == "Renamed artist");
+
+    const auto report = recover_journal(journal_path, RecoveryMode::RollBack);
+    CHECK(report.conflicts.empty());
+}
+
+TEST_CASE("RecoveryReplaysInPlaceEdits")
+{
+    const TemporaryDirectory directory;
+
+    const auto path = directory.copy_test_file("id3v2_only.mp3", "recover_in_place.mp3");
+    const auto original = read_file(path);
+    const auto before = std::span(original).first(1090);
+
+    std::vector<ID3v2::TagFrame> frames;
+    rename_artist(0, 4, frames);
+    const auto after = ID3v2::serialize_tag(frames, 4, before.size());
+
+    const auto forward =
+        recover_journal(write_journal(path, before, after), RecoveryMode::RollForward);
+    CHECK(forward.replayed == 1);
+    CHECK(artist_of(path) == "Renamed artist");
+
+    const auto back =
+        recover_journal(write_journal(path, before, after), RecoveryMode::RollBack);
+    CHECK(back.replayed == 1);
+    CHECK(read_file(path) == original);
+
+    const auto repeated =
+        recover_journal(write_journal(path, before, after), RecoveryMode::RollBack);
+    CHECK(repeated.unchanged == 1);
+
+    // a torn write mixes both tags and is completed
+    auto torn = original;
+    std::copy(after.begin(), after.begin() + 20, torn.begin());
+    write_file(path, torn);
+    const auto completed =
+        recover_journal(write_journal(path, before, after), RecoveryMode::RollForward);
+    CHECK(completed.replayed == 1);
+    CHECK(artist_of(path) == "Renamed artist");
+
+    // a file edited after the crash holds bytes of neither tag and is left alone
+    auto edited = read_file(path);
+    REQUIRE(before.back() == after.back());
+    edited[before.size() - 1] = ~before.back();
+    write_file(path, edited);
+    const auto conflict =
+        recover_journal(write_journal(path, before, after), RecoveryMode::RollBack);
+    CHECK(conflict.replayed == 0);
+    REQUIRE(conflict.conflicts.size() == 1);
+    CHECK(conflict.conflicts[0] == path);
+    CHECK(read_file(path) == edited);
+}
+
+TEST_CASE("RecoveryReplaysRewrites")
+{
+    const TemporaryDirectory directory;
+
+    const auto path = directory.copy_test_file("id3v2_only.mp3", "recover_rewrite.mp3");
+    const auto original = read_file(path);
+    const auto before = std::span(original).first(1090);
+
+    std::vector<ID3v2::TagFrame> frames;
+    rename_artist(0, 4, frames);
+    const auto after = ID3v2::serialize_tag(frames, 4, 3000);
+
+    // temporary file of a rewrite that never got renamed, next to one of another writer
+    const auto temporary = path + ".audiotag-a1b2c3";
+    std::ofstream{ temporary } << "partial";
+    const auto concurrent = path + ".audiotag-d4e5f6";
+    std::ofstream{ concurrent } << "in progress";
+
+    const auto forward = recover_journal(
+        write_journal(path, before, after, temporary), RecoveryMode::RollForward);
+    CHECK(forward.replayed == 1);
+    CHECK_FALSE(std::filesystem::exists(temporary));
+    CHECK(std::filesystem::exists(concurrent));
+    std::filesystem::remove(concurrent);
+    CHECK(std::filesystem::file_size(path) == 3000 + 13870);
+    CHECK(artist_of(path) == "Renamed artist");
+
+    const auto back =
+        recover_journal(write_journal(path, before, after), RecoveryMode::RollBack);
+    CHECK(back.replayed == 1);
+    CHECK(read_file(path) == original);
+
+    // a file changed since the batch is left alone
+    auto other_frames = frames;
+    other_frames.push_back(ID3v2::make_text_frame(Tag::ALBUM, "Album"));
+    const auto other = ID3v2::serialize_tag(other_frames, 4, 2000);
+    const auto conflict =
+        recover_journal(write_journal(path, other, after), RecoveryMode::RollForward);
+    CHECK(conflict.replayed == 0);
+    REQUIRE(conflict.conflicts.size() == 1);
+    CHECK(conflict.conflicts[0] == path);
+    CHECK(read_file(path) == original);
+}
@@ -0,0 +1,150 @@
+#include "test_files.hpp"
+
+#include <audiotag/scanner.hpp>
+#include <audiotag/track_metadata.hpp>
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+// 3 artists with 4 albums of 5 tracks each, plus files the scan skips
+std::vector<std::string> create_library(const std::filesystem::path &library)
+{
+    std::vector<std::string> tracks;
+    for(int artist = 0; artist < 3; ++artist)
+    {
+        for(int album = 0; album < 4; ++album)
+        {
+            const auto directory =
+                library / ("artist " + std::to_string(artist)) / ("album " + std::to_string(album));
+            std::filesystem::create_directories(directory);
+
+            for(int track = 0; track < 5; ++track)
+            {
+                const auto extension = track == 0 ? ".MP3" : ".mp3";
+                const auto path = directory / (std::to_string(track) + extension);
+                std::filesystem::copy_file(TEST_DATA_DIR "/id3v2_id3v1.mp3", path);
+                tracks.push_back(path.string());
+            }
+
+            std::ofstream{ directory / "cover.jpg" } << "not audio";
+        }
+    }
+
+    std::filesystem::create_directory_symlink(library / "artist 0", library / "link");
+    std::sort(tracks.begin(), tracks.end());
+    return tracks;
+}
+
+std::vector<ScanResult> scan(const std::filesystem::path &library, const ScanOptions &options)
+{
+    std::mutex mutex;
+    std::vector<ScanResult> results;
+
+    const std::vector roots{ library.string() };
+    scan_directories(
+        roots,
+        [&](ScanResult &&result) {
+            const std::lock_guard lock{ mutex };
+            results.push_back(std::move(result));
+        },
+        options);
+
+    std::sort(results.begin(), results.end(),
+        [](const auto &a, const auto &b) { return a.path < b.path; });
+    return results;
+}
+} // namespace
+
+TEST_CASE("ScannerParsesEveryMatchingFile")
+{
+    const TemporaryDirectory directory;
+    const auto tracks = create_library(directory.path());
+
+    for(const auto thread_count : { 1u, 4u })
+    {
+        const auto results = scan(directory.path(), ScanOptions{ .thread_count = thread_count });
+
+        REQUIRE(results.size() == tracks.size());
+        for(std::size_t i = 0; i < tracks.size(); ++i)
+        {
+            CHECK(results[i].path == tracks[i]);
+            CHECK_FALSE(results[i].error);
+            REQUIRE(results[i].file);
+            CHECK(to_track_metadata(*results[i].file).title == "Sample title");
+        }
+    }
+}
+
+TEST_CASE("ScannerFollowsSymlinksOnRequest")
+{
+    const TemporaryDirectory directory;
+    const auto tracks = create_library(directory.path());
+
+    const auto results =
+        scan(directory.path(), ScanOptions{ .thread_count = 2, .follow_symlinks = true });
+    CHECK(results.size() == tracks.size() + 20);
+
+    const auto only_jpg =
+        scan(directory.path(), ScanOptions{ .thread_count = 2, .extensions = { ".JPG" } });
+    CHECK(only_jpg.size() == 12);
+}
+
+TEST_CASE("ScannerReportsMissingRootsAndSinkFailures")
+{
+    const TemporaryDirectory directory;
+
+    const std::vector roots{ directory.file("missing") };
+    std::vector<ScanResult> results;
+    scan_directories(roots, [&](ScanResult &&result) { results.push_back(std::move(result)); });
+
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].error == std::errc::no_such_file_or_directory);
+
+    create_library(directory.path());
+    const std::vector library_root{ directory.path().string() };
+    CHECK_THROWS_AS(scan_directories(library_root,
+                        [](ScanResult &&) { throw std::runtime_error("sink failed"); }),
+        std::runtime_error);
+}
+
+TEST_CASE("TrackMetadataPrefersID3v2OverID3v1")
+{
+    const TemporaryDirectory directory;
+    create_library(directory.path());
+
+    const auto results = scan(directory.path(), ScanOptions{ .thread_count = 1 });
+    REQUIRE_FALSE(results.empty());
+    REQUIRE(results[0].file);
+
+    const auto metadata = to_track_metadata(*results[0].file);
+    CHECK(metadata.title == "Sample title");
+    CHECK(metadata.duration_ms == 0);
+
+    CHECK(parse_number("5/12") == 5);
+    CHECK(parse_number("07") == 7);
+    CHECK(parse_number("") == 0);
+    CHECK(parse_number("A1") == 0);
+}
+
+TEST_CASE("ResolveGenre")
+{
+    CHECK(resolve_genre("Classical") == "Classical");
+    CHECK(resolve_genre("17") == "Rock");
+    CHECK(resolve_genre("(32)") == "Classical");
+    CHECK(resolve_genre("(4)Eurodisco") == "Eurodisco");
+    CHECK(resolve_genre("(RX)") == "Remix");
+    CHECK(resolve_genre("((Parenthesized)") == "(Parenthesized)");
+    CHECK(resolve_genre("255").empty());
+    CHECK(resolve_genre("1000") == "1000");
+    CHECK(ID3v1::genre_name(191) == "Psybient");
+}
@@ -0,0 +1,161 @@
+#include "test_files.hpp"
+
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/search_index.hpp>
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+
+namespace
+{
+using Documents = std::vector<std::uint32_t>;
+} // namespace
+
+TEST_CASE("FoldSearchText")
+{
+    CHECK(fold_search_text("Beyoncé") == "beyonce");
+    CHECK(fold_search_text("Motörhead") == "motorhead");
+    CHECK(fold_search_text("Sigur Rós - Ágætis byrjun") == "sigur ros agaetis byrjun");
+    CHECK(fold_search_text("Łódź, Kraków") == "lodz krakow");
+    CHECK(fold_search_text("Don't Stop") == "dont stop");
+    CHECK(fold_search_text("Cafe\xCC\x81") == "cafe");
+    CHECK(fold_search_text("  AC/DC  ") == "ac dc");
+    CHECK(fold_search_text("ΑΒΓ Кино") == "αβγ кино");
+    CHECK(fold_search_text("画家") == "画家");
+    CHECK(fold_search_text("bad \xFF byte") == "bad byte");
+}
+
+TEST_CASE("SearchIndexFindsPrefixesAndTokens")
+{
+    const TemporaryDirectory directory;
+
+    SearchIndexWriter writer;
+    writer.add(0, "Let It Be");
+    writer.add(0, "The Beatles");
+    writer.add(1, "Beat It");
+    writer.add(1, "Michael Jackson");
+    writer.add(2, "Beyoncé");
+    writer.add(3, "Let It Go");
+    // added out of order
+    writer.add(0, "Abbey Road");
+    CHECK(writer.term_count() == 12);
+
+    const auto path = directory.file("terms.index");
+    writer.write(path);
+    const SearchIndex index{ path };
+    REQUIRE(index.term_count() == 12);
+
+    const auto range = index.prefix_range("be");
+    CHECK(range.size() == 4);
+    CHECK(index.term(range.begin) == "be");
+    CHECK(index.term(range.end - 1) == "beyonce");
+    CHECK(index.prefix_range("zz").size() == 0);
+
+    CHECK(index.search("be") == Documents{ 0, 1, 2 });
+    CHECK(index.search("BEYONCÉ") == Documents{ 2 });
+    CHECK(index.search("let it") == Documents{ 0, 3 });
+    CHECK(index.search("it be") == Documents{ 0, 1 });
+    // a trailing space completes the last token
+    CHECK(index.search("it be ") == Documents{ 0 });
+    CHECK(index.search("beatles ab") == Documents{ 0 });
+    CHECK(index.search("be", 2) == Documents{ 0, 1 });
+    CHECK(index.search("jackson let").empty());
+    CHECK(index.search("unknown be").empty());
+    CHECK(index.search(" - ").empty());
+}
+
+TEST_CASE("SearchIndexOverMetadataCache")
+{
+    const TemporaryDirectory directory;
+
+    MetadataCacheWriter cache_writer;
+    for(std::uint64_t i = 0; i < 1000; ++i)
+    {
+        cache_writer.add(FileKey{ .device = 1, .inode = i, .size = 1, .mtime_ns = 0 },
+            "/music/" + std::to_string(i) + ".mp3",
+            TrackMetadata{
+                .title = "Track " + std::to_string(i),
+                .artist = i % 2 == 0 ? "Björk" : "Bon Iver",
+                .album = "Album " + std::to_string(i / 10),
+                .genre = "",
+                .track = 0,
+                .disc = 0,
+                .year = 0,
+                .duration_ms = 0,
+            });
+    }
+
+    const auto cache_path = directory.file("library.cache");
+    cache_writer.write(cache_path);
+    const MetadataCache cache{ cache_path };
+
+    // documents are rows of the cache
+    SearchIndexWriter writer;
+    for(std::size_t i = 0; i < cache.size(); ++i)
+    {
+        writer.add(static_cast<std::uint32_t>(i), cache[i]);
+    }
+
+    const auto path = directory.file("library.index");
+    writer.write(path);
+    const SearchIndex index{ path };
+
+    CHECK(index.search("bjork").size() == 500);
+    CHECK(index.search("bo").size() == 500);
+    CHECK(index.search("b").size() == 1000);
+
+    const auto results = index.search("bon track 99");
+    REQUIRE(results.size() == 6);
+    for(const auto document : results)
+    {
+        CHECK(cache[document].artist() == "Bon Iver");
+        CHECK(cache[document].title().starts_with("Track 99"));
+    }
+
+    // the rows of album 42 and track 42
+    CHECK(index.search("album 42 ").size() == 11);
+}
+
+TEST_CASE("SearchIndexRejectsOtherFiles")
+{
+    const TemporaryDirectory directory;
+
+    const auto path = directory.file("other.index");
+    SearchIndexWriter{}.write(path);
+    CHECK(SearchIndex{ path }.search("anything").empty());
+
+    std::ofstream{ path, std::ios::trunc } << std::string(100, 'x');
+    CHECK_THROWS_AS(SearchIndex{ path }, std::runtime_error);
+
+    std::filesystem::resize_file(path, 10);
+    CHECK_THROWS_AS(SearchIndex{ path }, std::runtime_error);
+}
+
+TEST_CASE("SearchIndexWriterRemovesAndRenumbersDocuments")
+{
+    const TemporaryDirectory directory;
+    const auto path = directory.file("terms.index");
+
+    SearchIndexWriter writer;
+    writer.add(0, "Let It Be");
+    writer.add(1, "Beat It");
+    writer.add(2, "Let It Go");
+    writer.remove(1, "Beat It");
+    CHECK(writer.term_count() == 4);
+
+    // document 2 is stored as 0, document 0 is left out
+    const Documents documents{ SearchIndexWriter::NoDocument, 7, 0 };
+    writer.write(path, documents);
+
+    const SearchIndex index{ path };
+    CHECK(index.term_count() == 3);
+    CHECK(index.search("let it") == Documents{ 0 });
+    CHECK(index.search("be").empty());
+    CHECK(index.search("beat").empty());
+}
@@ -0,0 +1,253 @@
+#include "test_files.hpp"
+
+#include <audiotag/track_metadata.hpp>
+#include <audiotag/watcher.hpp>
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace audiotag;
+using namespace std::chrono_literals;
+
+namespace
+{
+const auto sample = std::filesystem::path(TEST_DATA_DIR) / "id3v2_id3v1.mp3";
+
+std::filesystem::path create_library(const TemporaryDirectory &directory)
+{
+    const auto library = directory.path() / "library";
+    std::filesystem::create_directories(library / "artist" / "album");
+    return library;
+}
+
+// Polls until `count` events arrived or a second passed
+void poll_for(LibraryWatcher &watcher, const std::vector<WatchEvent> &events, std::size_t count)
+{
+    const auto deadline = std::chrono::steady_clock::now() + 1s;
+    while(events.size() < count && std::chrono::steady_clock::now() < deadline)
+    {
+        watcher.poll(10ms);
+    }
+}
+
+WatchOptions fast_options()
+{
+    return WatchOptions{ .debounce = 20ms };
+}
+} // namespace
+
+TEST_CASE("WatcherParsesFilesWrittenIntoTheLibrary")
+{
+    const TemporaryDirectory directory;
+    const auto library = create_library(directory);
+
+    std::vector<WatchEvent> events;
+    const std::vector roots{ library.string() };
+    LibraryWatcher watcher{ roots, [&](WatchEvent &&event) { events.push_back(std::move(event)); },
+        fast_options() };
+    CHECK(watcher.watch_count() == 3);
+
+    const auto path = library / "artist" / "album" / "01.mp3";
+    std::filesystem::copy_file(sample, path);
+    std::ofstream{ library / "artist" / "cover.jpg" } << "not audio";
+    poll_for(watcher, events, 1);
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == WatchEventKind::Updated);
+    CHECK(events[0].result.path == path.string());
+    CHECK(!events[0].result.error);
+    REQUIRE(events[0].result.file.has_value());
+    CHECK(to_track_metadata(*events[0].result.file).title == "Sample title");
+}
+
+TEST_CASE("WatcherDebouncesBurstsOfWrites")
+{
+    const TemporaryDirectory directory;
+    const auto library = create_library(directory);
+
+    std::vector<WatchEvent> events;
+    const std::vector roots{ library.string() };
+    LibraryWatcher watcher{ roots, [&](WatchEvent &&event) { events.push_back(std::move(event)); },
+        WatchOptions{ .debounce = 100ms } };
+
+    const auto path = library / "artist" / "01.mp3";
+    std::filesystem::copy_file(sample, path);
+    for(int i = 0; i < 5; ++i)
+    {
+        std::ofstream{ path, std::ios::app } << 'x';
+        watcher.poll(5ms);
+    }
+    CHECK(events.empty());
+
+    poll_for(watcher, events, 1);
+    watcher.poll(150ms);
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == WatchEventKind::Updated);
+
+    std::filesystem::remove(path);
+    poll_for(watcher, events, 2);
+
+    REQUIRE(events.size() == 2);
+    CHECK(events[1].kind == WatchEventKind::Removed);
+    CHECK(events[1].result.path == path.string());
+}
+
+TEST_CASE("WatcherFollowsNewAndRemovedDirectories")
+{
+    const TemporaryDirectory directory;
+    const auto library = create_library(directory);
+
+    std::vector<WatchEvent> events;
+    const std::vector roots{ library.string() };
+    LibraryWatcher watcher{ roots, [&](WatchEvent &&event) { events.push_back(std::move(event)); },
+        fast_options() };
+
+    // files already in a directory moved into the library are found by a scan
+    const auto staging = directory.path() / "staging";
+    std::filesystem::create_directories(staging);
+    std::filesystem::copy_file(sample, staging / "01.mp3");
+    std::filesystem::rename(staging, library / "new album");
+    poll_for(watcher, events, 1);
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == WatchEventKind::Updated);
+    CHECK(events[0].result.path == (library / "new album" / "01.mp3").string());
+    CHECK(watcher.watch_count() == 4);
+
+    // and the new directory is watched
+    std::filesystem::copy_file(sample, library / "new album" / "02.mp3");
+    poll_for(watcher, events, 2);
+
+    REQUIRE(events.size() == 2);
+    CHECK(events[1].result.path == (library / "new album" / "02.mp3").string());
+
+    std::filesystem::remove_all(library / "new album");
+    poll_for(watcher, events, 5);
+
+    // the removed files, then the directory
+    REQUIRE(events.size() == 5);
+    CHECK(events[4].kind == WatchEventKind::Removed);
+    CHECK(events[4].result.path == (library / "new album").string());
+}
+
+TEST_CASE("WatcherRescansSubtreesBeyondTheWatchLimit")
+{
+    const TemporaryDirectory directory;
+    const auto library = create_library(directory);
+    const auto album = library / "artist" / "album";
+    std::filesystem::copy_file(sample, album / "01.mp3");
+
+    std::vector<WatchEvent> events;
+    const std::vector roots{ library.string() };
+    LibraryWatcher watcher{ roots, [&](WatchEvent &&event) { events.push_back(std::move(event)); },
+        WatchOptions{ .debounce = 20ms, .max_watches = 1, .rescan_interval = 50ms } };
+
+    CHECK(watcher.watch_count() == 1);
+    CHECK(watcher.unwatched_count() == 1);
+
+    // files that were there from the start and did not change are not reported
+    watcher.poll(150ms);
+    CHECK(events.empty());
+
+    std::filesystem::copy_file(sample, album / "02.mp3");
+    poll_for(watcher, events, 1);
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == WatchEventKind::Updated);
+    CHECK(events[0].result.path == (album / "02.mp3").string());
+
+    watcher.poll(150ms);
+    CHECK(events.size() == 1);
+
+    std::ofstream{ album / "01.mp3", std::ios::app } << 'x';
+    std::filesystem::remove(album / "02.mp3");
+    poll_for(watcher, events, 3);
+
+    REQUIRE(events.size() == 3);
+    CHECK(events[1].kind == WatchEventKind::Removed);
+    CHECK(events[1].result.path == (album / "02.mp3").string());
+    CHECK(events[2].kind == WatchEventKind::Updated);
+    CHECK(events[2].result.path == (album / "01.mp3").string());
+}
+
+TEST_CASE("WatcherRescansAfterLosingEvents")
+{
+    const TemporaryDirectory directory;
+    const auto library = create_library(directory);
+    std::filesystem::copy_file(sample, library / "artist" / "album" / "01.mp3");
+    std::filesystem::copy_file(sample, library / "02.mp3");
+
+    std::vector<WatchEvent> events;
+    const std::vector roots{ library.string() };
+    LibraryWatcher watcher{ roots, [&](WatchEvent &&event) { events.push_back(std::move(event)); },
+        WatchOptions{ .debounce = 20ms, .max_watches = 1, .rescan_interval = 1h } };
+
+    // a removal nothing watches, then more events than the kernel queues
+    std::filesystem::remove(library / "artist" / "album" / "01.mp3");
+
+    std::size_t queued_events{ 16384 };
+    std::ifstream{ "/proc/sys/fs/inotify/max_queued_events" } >> queued_events;
+    for(std::size_t i = 0; i < queued_events / 2 + 100; ++i)
+    {
+        std::ofstream{ library / ("notes " + std::to_string(i) + ".txt") };
+    }
+    poll_for(watcher, events, 1);
+    watcher.poll(50ms);
+
+    // only the removal is reported and the watched root does not become unwatched
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == WatchEventKind::Removed);
+    CHECK(events[0].result.path == (library / "artist" / "album" / "01.mp3").string());
+    CHECK(watcher.watch_count() == 1);
+    CHECK(watcher.unwatched_count() == 1);
+}
+
+TEST_CASE("WatcherWatchesFollowedSymlinks")
+{
+    const TemporaryDirectory directory;
+    const auto library = create_library(directory);
+    const auto shared = directory.path() / "shared";
+    const auto other = directory.path() / "other";
+    std::filesystem::create_directories(shared / "album");
+    std::filesystem::create_directories(other);
+    std::filesystem::copy_file(sample, other / "01.mp3");
+    std::filesystem::create_directory_symlink(shared, library / "shared");
+    // a link back up the tree leads to directories watched already
+    std::filesystem::create_directory_symlink(library, library / "artist" / "loop");
+
+    std::vector<WatchEvent> events;
+    const std::vector roots{ library.string() };
+    auto options = fast_options();
+    options.scan_options.follow_symlinks = true;
+    LibraryWatcher watcher{ roots, [&](WatchEvent &&event) { events.push_back(std::move(event)); },
+        options };
+    CHECK(watcher.watch_count() == 5);
+
+    std::filesystem::copy_file(sample, shared / "album" / "02.mp3");
+    poll_for(watcher, events, 1);
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == WatchEventKind::Updated);
+    CHECK(events[0].result.path == (library / "shared" / "album" / "02.mp3").string());
+
+    // links created later are scanned and watched like new directories
+    std::filesystem::create_directory_symlink(other, library / "other");
+    poll_for(watcher, events, 2);
+
+    REQUIRE(events.size() == 2);
+    CHECK(events[1].result.path == (library / "other" / "01.mp3").string());
+    CHECK(watcher.watch_count() == 6);
+
+    std::filesystem::remove(library / "shared");
+    poll_for(watcher, events, 3);
+
+    REQUIRE(events.size() == 3);
+    CHECK(events[2].kind == WatchEventKind::Removed);
+    CHECK(events[2].result.path == (library / "shared").string());
+    CHECK(watcher.watch_count() == 4);
+}
@@ -2,6 +2,8 @@
 
 #include <audiotag/reader.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstring>
 #include <vector>
@@ -33,10 +35,7 @@ public:
 
     std::size_t read(std::span<std::byte> buffer) override
     {
-        const auto buffer_size = buffer.size();
-        const auto read_size = std::min(data.size() - cursor, cursor + buffer_size);
-
-        std::memcpy(buffer.data(), data.data() + cursor, read_size);
+        const auto read_size = read_at(cursor, buffer);
         cursor += read_size;
 
         return read_size;
@@ -48,8 +47,36 @@ public:
         return true;
     }
 
+    std::size_t read_at(std::size_t offset, std::span<std::byte> buffer) const override
+    {
+        if(offset >= data.size())
+        {
+            return 0;
+        }
+
+        const auto read_size = std::min(data.size() - offset, buffer.size());
+        std::memcpy(buffer.data(), data.data() + offset, read_size);
+        bytes_read.fetch_add(read_size, std::memory_order_relaxed);
+        reads.fetch_add(1, std::memory_order_relaxed);
+
+        return read_size;
+    }
+
+    std::size_t total_bytes_read() const
+    {
+        return bytes_read.load(std::memory_order_relaxed);
+    }
+
+    std::size_t read_count() const
+    {
+        return reads.load(std::memory_order_relaxed);
+    }
+
 private:
     const DataVec &data;
-    std::ptrdiff_t cursor{ 0 };
+    std::size_t cursor{ 0 };
+    // read_at may be called from several threads, e.g. by hash_range
+    mutable std::atomic<std::size_t> bytes_read{ 0 };
+    mutable std::atomic<std::size_t> reads{ 0 };
 };
 } // namespace audiotag
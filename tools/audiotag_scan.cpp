@@ -0,0 +1,331 @@
+#include <audiotag/columnar.hpp>
+#include <audiotag/metadata_cache.hpp>
+#include <audiotag/scanner.hpp>
+#include <audiotag/search_index.hpp>
+#include <audiotag/track_metadata.hpp>
+#include <utf8/cpp17.h>
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t FlushSize{ 256 * 1024 };
+
+void print_usage()
+{
+    std::fputs("usage: audiotag-scan [--threads N] [--properties] [--follow-symlinks]\n"
+               "                     [--extension .ext]... [--cache FILE [--index FILE]]\n"
+               "                     [--columns FILE] <directory>...\n"
+               "Prints one JSON object per parsed file. With --cache, unchanged files are\n"
+               "taken from FILE, which is then rewritten with the result of the scan;\n"
+               "--index writes a search index over the rows of the rewritten cache.\n"
+               "With --columns, the tags are also written to FILE as a columnar export.\n",
+        stderr);
+}
+
+void append_json_string(std::string &out, std::string_view value)
+{
+    // paths may hold any bytes and UTF-8 frames are not validated when read,
+    // invalid sequences become U+FFFD so every line stays valid JSON
+    std::string replaced;
+    if(!utf8::is_valid(value))
+    {
+        replaced = utf8::replace_invalid(value);
+        value = replaced;
+    }
+
+    out.push_back('"');
+    for(const char c : value)
+    {
+        switch(c)
+        {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+            {
+                constexpr char digits[] = "0123456789abcdef";
+                out.append("\\u00");
+                out.push_back(digits[c >> 4]);
+                out.push_back(digits[c & 0xF]);
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+void append_field(std::string &out, std::string_view key, std::string_view value)
+{
+    out.push_back(',');
+    append_json_string(out, key);
+    out.push_back(':');
+    append_json_string(out, value);
+}
+
+void append_field(std::string &out, std::string_view key, std::uint32_t value)
+{
+    char digits[16];
+    const auto end = std::to_chars(std::begin(digits), std::end(digits), value).ptr;
+
+    out.push_back(',');
+    append_json_string(out, key);
+    out.push_back(':');
+    out.append(digits, end);
+}
+
+void append_result(std::string &out,
+    const audiotag::ScanResult &result,
+    const audiotag::TrackMetadata &metadata,
+    bool duration)
+{
+    out.append("{\"path\":");
+    append_json_string(out, result.path);
+
+    if(result.error)
+    {
+        append_field(out, "error", result.error.message());
+    }
+    else
+    {
+        append_field(out, "title", metadata.title);
+        append_field(out, "artist", metadata.artist);
+        append_field(out, "album", metadata.album);
+        append_field(out, "genre", metadata.genre);
+        append_field(out, "track", metadata.track);
+        append_field(out, "disc", metadata.disc);
+        append_field(out, "year", metadata.year);
+        if(duration)
+        {
+            append_field(out, "duration_ms", metadata.duration_ms);
+        }
+    }
+
+    out.append("}\n");
+}
+
+// Lines are formatted on the workers and written in large blocks
+class Output
+{
+public:
+    Output(bool duration, bool cache, bool columns)
+    : duration{ duration }
+    , write_cache{ cache }
+    , export_columns{ columns }
+    {
+    }
+
+    ~Output()
+    {
+        flush();
+    }
+
+    void write(const audiotag::ScanResult &result)
+    {
+        audiotag::TrackMetadata metadata;
+        if(result.cached)
+        {
+            metadata = result.cached->to_track_metadata();
+        }
+        else if(result.file)
+        {
+            metadata = audiotag::to_track_metadata(*result.file);
+        }
+
+        thread_local std::string line;
+        line.clear();
+        append_result(line, result, metadata, duration);
+
+        const std::lock_guard lock{ mutex };
+        if(write_cache && !result.error)
+        {
+            cache.add(result.key, result.path, metadata);
+        }
+
+        if(export_columns && result.cached)
+        {
+            columns.add(result.path, *result.cached);
+        }
+        else if(export_columns && result.file)
+        {
+            columns.add(result.path, *result.file);
+        }
+
+        buffer.append(line);
+        if(buffer.size() >= FlushSize)
+        {
+            flush();
+        }
+    }
+
+    const audiotag::MetadataCacheWriter &cache_writer() const
+    {
+        return cache;
+    }
+
+    const audiotag::ColumnarWriter &columnar_writer() const
+    {
+        return columns;
+    }
+
+    void flush()
+    {
+        std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+        buffer.clear();
+    }
+
+private:
+    bool duration;
+    bool write_cache;
+    bool export_columns;
+    std::mutex mutex;
+    std::string buffer;
+    audiotag::MetadataCacheWriter cache;
+    audiotag::ColumnarWriter columns;
+};
+} // namespace
+
+int main(int argc, char **argv)
+{
+    audiotag::ScanOptions options;
+    std::vector<std::string> roots;
+    std::string cache_path;
+    std::string columns_path;
+    std::string index_path;
+    bool default_extensions{ true };
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string_view argument{ argv[i] };
+        const auto has_value = i + 1 < argc;
+
+        if(argument == "--threads" && has_value)
+        {
+            options.thread_count = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(argument == "--extension" && has_value)
+        {
+            if(std::exchange(default_extensions, false))
+            {
+                options.extensions.clear();
+            }
+            options.extensions.emplace_back(argv[++i]);
+        }
+        else if(argument == "--cache" && has_value)
+        {
+            cache_path = argv[++i];
+        }
+        else if(argument == "--index" && has_value)
+        {
+            index_path = argv[++i];
+        }
+        else if(argument == "--columns" && has_value)
+        {
+            columns_path = argv[++i];
+        }
+        else if(argument == "--properties")
+        {
+            options.read_options.audio_properties = true;
+        }
+        else if(argument == "--follow-symlinks")
+        {
+            options.follow_symlinks = true;
+        }
+        else if(argument == "--help" || argument.starts_with("--"))
+        {
+            print_usage();
+            return argument == "--help" ? 0 : 2;
+        }
+        else
+        {
+            roots.emplace_back(argument);
+        }
+    }
+
+    if(roots.empty() || (!index_path.empty() && cache_path.empty()))
+    {
+        print_usage();
+        return 2;
+    }
+
+    std::optional<audiotag::MetadataCache> cache;
+    if(!cache_path.empty() && std::filesystem::exists(cache_path))
+    {
+        try
+        {
+            cache.emplace(cache_path);
+            options.cache = &*cache;
+        }
+        catch(const std::runtime_error &error)
+        {
+            std::fprintf(stderr, "audiotag-scan: ignoring cache: %s\n", error.what());
+        }
+    }
+
+    Output output{
+        options.read_options.audio_properties, !cache_path.empty(), !columns_path.empty()
+    };
+    try
+    {
+        audiotag::scan_directories(
+            roots, [&output](audiotag::ScanResult &&result) { output.write(result); }, options);
+
+        if(!cache_path.empty())
+        {
+            output.cache_writer().write(cache_path);
+        }
+
+        if(!index_path.empty())
+        {
+            // documents are the rows of the cache just written
+            const audiotag::MetadataCache written{ cache_path };
+            audiotag::SearchIndexWriter index;
+            for(std::size_t i = 0; i < written.size(); ++i)
+            {
+                index.add(static_cast<std::uint32_t>(i), written[i]);
+            }
+            index.write(index_path);
+        }
+
+        if(!columns_path.empty())
+        {
+            output.columnar_writer().write(columns_path);
+        }
+    }
+    catch(const std::exception &error)
+    {
+        output.flush();
+        std::fprintf(stderr, "audiotag-scan: %s\n", error.what());
+        return 1;
+    }
+
+    return 0;
+}